@@ -0,0 +1,76 @@
+/**
+ * @file arena.h
+ * @brief Bump allocator for per-parse objects
+ */
+
+ #ifndef ARENA_H
+ #define ARENA_H
+
+ #include <stddef.h>
+
+ /**
+  * @brief One memory block of an arena
+  */
+ typedef struct ArenaBlock {
+     struct ArenaBlock* next;  // Next block in the chain
+     size_t size;              // Usable bytes in data
+     size_t used;              // Bytes handed out from data
+     max_align_t data[];       // Block memory, aligned for any object type
+ } ArenaBlock;
+
+ /**
+  * @brief Arena allocator
+  *
+  * Allocations are carved out of large blocks and are never freed
+  * individually; arena_reset or arena_free releases all of them at once.
+  */
+ typedef struct {
+     ArenaBlock* first;        // First block in the chain
+     ArenaBlock* current;      // Block allocations are taken from
+     size_t block_size;        // Default size of new blocks
+ } Arena;
+
+ /**
+  * @brief Create an arena
+  *
+  * @param block_size Size of each block in bytes (0 for the default)
+  * @return Arena* New arena
+  */
+ Arena* arena_create(size_t block_size);
+
+ /**
+  * @brief Free an arena and every allocation made from it
+  *
+  * @param arena Arena to free
+  */
+ void arena_free(Arena* arena);
+
+ /**
+  * @brief Release every allocation but keep the blocks for reuse
+  *
+  * Runs in constant time; blocks are recycled as they are reached again.
+  *
+  * @param arena Arena to reset
+  */
+ void arena_reset(Arena* arena);
+
+ /**
+  * @brief Allocate memory from the arena
+  *
+  * @param arena Arena
+  * @param size Number of bytes
+  * @return void* Memory aligned for any object type
+  */
+ void* arena_alloc(Arena* arena, size_t size);
+
+ /**
+  * @brief Copy a string of known length into the arena
+  *
+  * @param arena Arena
+  * @param text String to copy (need not be NUL-terminated)
+  * @param length Number of bytes to copy
+  * @return char* NUL-terminated copy
+  */
+ char* arena_strndup(Arena* arena, const char* text, size_t length);
+
+ #endif /* ARENA_H */
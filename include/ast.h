@@ -0,0 +1,133 @@
+/**
+ * @file ast.h
+ * @brief Syntax tree built during the parse in a flat node pool
+ */
+
+ #ifndef AST_H
+ #define AST_H
+
+ #include <stdio.h>
+ #include <stdint.h>
+ #include "token.h"
+ #include "stack.h"
+
+ // Node index meaning "no node" (no child, no sibling)
+ #define AST_NONE UINT32_MAX
+
+ /**
+  * @brief Tree node, children are linked through 32-bit pool indices
+  */
+ typedef struct {
+     uint16_t symbol;        // TokenType of a leaf, non-terminal of an inner node
+     uint16_t production;    // Production that built the node, 0 for a leaf
+     uint32_t first_child;   // First child or AST_NONE
+     uint32_t next_sibling;  // Next child of the same parent or AST_NONE
+     uint32_t lexeme;        // Offset of the leaf's lexeme in Ast.text
+     uint32_t length;        // Lexeme length (0 for inner nodes)
+     int32_t line;           // Line of the leaf token
+     int32_t position;       // Position of the leaf token in its line
+ } AstNode;
+
+ /**
+  * @brief Finished tree, header, nodes and text in one allocation
+  *
+  * Released with a single free (or ast_free).
+  */
+ typedef struct {
+     const AstNode* nodes;  // Node pool, children before their parents
+     uint32_t num_nodes;    // Nodes in the pool
+     uint32_t root;         // Index of the start symbol's node
+     const char* text;      // Leaf lexemes, each one NUL-terminated
+     uint32_t text_size;    // Bytes used in text
+ } Ast;
+
+ /**
+  * @brief Growable node and text pools used while a tree is built
+  *
+  * Kept by the parser and reused, so only the first parses grow it.
+  */
+ typedef struct {
+     AstNode* nodes;          // Node pool
+     uint32_t num_nodes;      // Nodes in use
+     uint32_t node_capacity;  // Allocated nodes
+     char* text;              // Lexeme pool
+     uint32_t text_size;      // Bytes in use
+     uint32_t text_capacity;  // Allocated bytes
+ } AstBuilder;
+
+ /**
+  * @brief Create an empty builder
+  *
+  * @return AstBuilder* New builder
+  */
+ AstBuilder* ast_builder_create(void);
+
+ /**
+  * @brief Free a builder and its pools
+  *
+  * @param builder Builder to free (may be NULL)
+  */
+ void ast_builder_free(AstBuilder* builder);
+
+ /**
+  * @brief Forget all nodes, keeping the pools for the next tree
+  *
+  * @param builder Builder
+  */
+ void ast_builder_clear(AstBuilder* builder);
+
+ /**
+  * @brief Add a leaf for a shifted token, its lexeme is copied
+  *
+  * @param builder Builder
+  * @param token Shifted token
+  * @return uint32_t Index of the new node
+  */
+ uint32_t ast_builder_leaf(AstBuilder* builder, const Token* token);
+
+ /**
+  * @brief Add the node of a reduction
+  *
+  * The children are the nodes held in the values (SemValue.node) of the
+  * stack entries base .. base + count - 1, in that order.
+  *
+  * @param builder Builder
+  * @param lhs Left-hand side non-terminal
+  * @param production Production number
+  * @param stack Parser stack, before the right-hand side is popped
+  * @param base Index of the first right-hand side entry
+  * @param count Length of the right-hand side
+  * @return uint32_t Index of the new node
+  */
+ uint32_t ast_builder_node(AstBuilder* builder, int lhs, int production,
+                           Stack* stack, int base, int count);
+
+ /**
+  * @brief Copy the pools into a standalone tree
+  *
+  * @param builder Builder holding the nodes
+  * @param root Index of the root node
+  * @return Ast* Tree in a single allocation
+  */
+ Ast* ast_builder_finish(const AstBuilder* builder, uint32_t root);
+
+ /**
+  * @brief Free a tree
+  *
+  * @param ast Tree to free (may be NULL)
+  */
+ void ast_free(Ast* ast);
+
+ /**
+  * @brief Print a tree, one node per line indented by depth
+  *
+  * Leaves are printed like the stack tokens of the trace, inner nodes
+  * by name and production.
+  *
+  * @param ast Tree to print
+  * @param non_terminal_names Names by non-terminal (NULL: get_non_terminal_name)
+  * @param out Output file
+  */
+ void ast_print(const Ast* ast, const char* const* non_terminal_names, FILE* out);
+
+ #endif /* AST_H */
@@ -0,0 +1,139 @@
+/**
+ * @file async_io.h
+ * @brief Background threads for reading the input and writing the trace
+ *
+ * Both directions go through a single-producer single-consumer byte ring.
+ * The indices are atomics, so neither side takes a lock while there is
+ * data or room; a mutex and condition variable are only used to sleep
+ * when the ring is empty or full.
+ */
+
+ #ifndef ASYNC_IO_H
+ #define ASYNC_IO_H
+
+ #include <stdio.h>
+ #include <stdbool.h>
+ #include <stddef.h>
+ #include <stdatomic.h>
+ #include <pthread.h>
+
+ // Bytes the reader thread asks fread for at once, the ring holds two
+ #define ASYNC_READ_CHUNK (64 * 1024)
+
+ // Bytes of trace text the writer ring holds before the parser waits
+ #define ASYNC_WRITE_RING (1 << 20)
+
+ // Bytes queued before the writer thread is woken to write them
+ #define ASYNC_WRITE_BATCH (64 * 1024)
+
+ /**
+  * @brief Single-producer single-consumer byte ring
+  */
+ typedef struct {
+     char* data;               // capacity bytes
+     size_t capacity;          // Power of two
+     _Atomic size_t head;      // Bytes produced so far
+     _Atomic size_t tail;      // Bytes consumed so far
+     _Atomic bool closed;      // The producer is done, nothing follows head
+     _Atomic bool stop;        // The consumer is done, the producer should stop
+     size_t data_batch;        // Bytes queued before a sleeping consumer is woken
+     size_t space_batch;       // Bytes free before a sleeping producer is woken
+     _Atomic int waiting;      // ASYNC_WAIT_* bits of the sides asleep
+     pthread_mutex_t lock;     // Held only around sleeping and waking
+     pthread_cond_t wake;      // Signalled when a sleeping side can go on
+ } ByteRing;
+
+ /**
+  * @brief Input file read ahead by a background thread
+  *
+  * The thread fills one half of the ring while the scanner consumes the
+  * other, so the scanner only waits when it is faster than the disk. A
+  * full ring wakes the thread only once a whole half is free again.
+  */
+ typedef struct AsyncReader {
+     ByteRing ring;       // Bytes read ahead
+     FILE* file;          // Input, owned by the caller
+     _Atomic bool failed; // A read error ended the input early, set before closed
+     pthread_t thread;    // Reader thread
+ } AsyncReader;
+
+ /**
+  * @brief Output file written by a background thread
+  *
+  * An idle thread is woken once ASYNC_WRITE_BATCH bytes are queued, not
+  * for every write, so steps cost a copy and no system call.
+  */
+ typedef struct AsyncWriter {
+     ByteRing ring;       // Bytes not written yet
+     FILE* file;          // Output, owned by the caller
+     _Atomic bool failed; // A write failed, the file is incomplete
+     pthread_t thread;    // Writer thread
+ } AsyncWriter;
+
+ /**
+  * @brief Start reading a file ahead in the background
+  *
+  * @param file Open input file, read only by the thread until async_reader_close
+  * @return AsyncReader* Reader, or NULL if the thread cannot be started
+  */
+ AsyncReader* async_reader_open(FILE* file);
+
+ /**
+  * @brief Read a line like fgets
+  *
+  * Waits only when the thread has not read that far yet.
+  *
+  * @param reader Reader
+  * @param buffer Receives the line with its newline and a terminator
+  * @param size Size of buffer
+  * @return char* buffer, or NULL at the end of the input
+  */
+ char* async_reader_gets(AsyncReader* reader, char* buffer, int size);
+
+ /**
+  * @brief Check whether the input ended with a read error, like ferror
+  *
+  * Only final once async_reader_gets has returned NULL.
+  *
+  * @param reader Reader
+  * @return bool True if the thread stopped on a read error
+  */
+ bool async_reader_failed(AsyncReader* reader);
+
+ /**
+  * @brief Stop the thread and free the reader (the file stays open)
+  *
+  * @param reader Reader (may be NULL)
+  */
+ void async_reader_close(AsyncReader* reader);
+
+ /**
+  * @brief Start writing a file in the background
+  *
+  * @param file Open output file, written only by the thread until async_writer_close
+  * @return AsyncWriter* Writer, or NULL if the thread cannot be started
+  */
+ AsyncWriter* async_writer_open(FILE* file);
+
+ /**
+  * @brief Queue bytes for the file
+  *
+  * Copies them into the ring, waiting only while it is full.
+  *
+  * @param writer Writer
+  * @param data Bytes to write
+  * @param length Number of bytes
+  */
+ void async_writer_write(AsyncWriter* writer, const void* data, size_t length);
+
+ /**
+  * @brief Write out everything queued, stop the thread and free the writer
+  *
+  * The file is flushed but stays open.
+  *
+  * @param writer Writer
+  * @return bool False if a write failed
+  */
+ bool async_writer_close(AsyncWriter* writer);
+
+ #endif /* ASYNC_IO_H */
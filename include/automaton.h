@@ -10,6 +10,9 @@
  
  /**
   * @brief Automaton action types
+  * 
+  * Action table entries are 16 bits: the action type in the low
+  * ACTION_TYPE_BITS bits and the state or production number above.
   */
  typedef enum {
      ACTION_SHIFT,   // Shift action
@@ -18,13 +21,105 @@
      ACTION_ERROR    // Parsing error
  } ActionType;
  
+ #define ACTION_TYPE_BITS 2
+ #define ACTION_TYPE_MASK 0x3
+
+ // Largest state or production number that fits in a packed entry
+ #define ACTION_VALUE_MAX ((1 << (16 - ACTION_TYPE_BITS)) - 1)
+ 
+ /**
+  * @brief Unchecked action lookup for the parse loop
+  * 
+  * Every TokenType has a column, so any scanned token is a valid index.
+  * Use get_action when state or token may be out of range.
+  */
+ static inline int tables_action(const ParsingTables* tables, int state, TokenType token) {
+     return tables->action_table[state * tables->num_terminals + token];
+ }
+ 
+ /**
+  * @brief Unchecked goto lookup for the parse loop
+  */
+ static inline int tables_goto(const ParsingTables* tables, int state, int non_terminal) {
+     return tables->goto_table[state * tables->num_non_terminals + non_terminal];
+ }
+ 
+ /**
+  * @brief Unchecked action type decoding
+  */
+ static inline ActionType action_type_of(int action) {
+     return (ActionType)(action & ACTION_TYPE_MASK);
+ }
+ 
+ /**
+  * @brief Unchecked action value decoding
+  */
+ static inline int action_value_of(int action) {
+     return action >> ACTION_TYPE_BITS;
+ }
+ 
+ /**
+  * @brief Terminals the state has an action for, one bit per TokenType
+  * 
+  * Computed when the tables are built (automaton_build_expected), so an
+  * error costs no scan of the action row.
+  */
+ static inline uint32_t tables_expected(const ParsingTables* tables, int state) {
+     return tables->expected[state];
+ }
+ 
+ /**
+  * @brief Static text naming the terminals expected in the state
+  * 
+  * "expected NUM" or "expected one of PLUS, RPAREN, EOF", owned by the
+  * tables.
+  */
+ static inline const char* tables_expected_message(const ParsingTables* tables, int state) {
+     return tables->expected_messages[state];
+ }
+ 
+ /**
+  * @brief Fill the expected-token masks and messages from the action table
+  * 
+  * Every builder of tables calls this once the action table is final;
+  * free_parsing_tables releases what it allocates.
+  * 
+  * @param tables Tables with their action table set
+  */
+ void automaton_build_expected(ParsingTables* tables);
+ 
  /**
   * @brief Initialize automaton with grammar rules
   * 
+  * Builds a private heap copy of the tables at run time; the build uses
+  * this to generate the static tables returned by automaton_builtin.
+  * 
   * @return ParsingTables* Created parsing tables
   */
  ParsingTables* automaton_init();
  
+ /**
+  * @brief Get the compile-time tables for the built-in expression grammar
+  * 
+  * The tables are static read-only data shared by every parser.
+  * 
+  * @return const ParsingTables* Built-in parsing tables
+  */
+ const ParsingTables* automaton_builtin();
+ 
+ /**
+  * @brief Check whether two sets of tables have the same productions
+  * 
+  * Compares the left-hand side and the right-hand side symbols of every
+  * production by number, which is what actions indexed by production
+  * number depend on (see semantic_expr_actions).
+  * 
+  * @param tables Tables to check
+  * @param reference Tables with the expected productions
+  * @return true If every production matches in the same order
+  */
+ bool automaton_same_productions(const ParsingTables* tables, const ParsingTables* reference);
+ 
  /**
   * @brief Decode action from action table entry
   * 
@@ -45,8 +140,8 @@
   * @brief Create action value for table
   * 
   * @param type Action type
-  * @param value State or production number
-  * @return int Encoded action value
+  * @param value State or production number, 0 to ACTION_VALUE_MAX
+  * @return int Encoded action value (ACTION_ERROR if value is out of range)
   */
  int automaton_create_action(ActionType type, int value);
  
@@ -57,6 +152,15 @@
   * @param tables Parsing tables for production lookup
   * @return char* String representation (must be freed by caller)
   */
- char* automaton_action_to_string(int action_value, ParsingTables* tables);
+ char* automaton_action_to_string(int action_value, const ParsingTables* tables);
+ 
+ /**
+  * @brief Append the string representation of an action to a builder
+  * 
+  * @param out Builder
+  * @param action_value Action value from table
+  * @param tables Parsing tables for production lookup
+  */
+ void automaton_append_action(StrBuf* out, int action_value, const ParsingTables* tables);
  
  #endif /* AUTOMATON_H */
\ No newline at end of file
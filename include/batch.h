@@ -0,0 +1,62 @@
+/**
+ * @file batch.h
+ * @brief Batch mode: parse many input files with one parser per thread
+ */
+
+ #ifndef BATCH_H
+ #define BATCH_H
+
+ #include <stdio.h>
+ #include "parser.h"
+
+ /**
+  * @brief Totals of a batch run
+  */
+ typedef struct {
+     int files;       // Inputs parsed
+     int accepted;    // Inputs accepted
+     int failed;      // Inputs rejected or not readable
+     double seconds;  // Wall-clock time of the whole batch
+     int threads;     // Worker threads used
+     ParseStats* stats; // Counters added up over all inputs (NULL unless the parser collects them, caller frees)
+ } BatchSummary;
+
+ /**
+  * @brief Parse a list of inputs with one parser per worker thread
+  *
+  * Each path is a .cscn file or a directory, whose .cscn files are parsed
+  * in name order. When count is 0 the paths are read from manifest, one
+  * per line. The calling thread is the first worker and uses parser,
+  * the others get their own parser sharing parser's tables. One result
+  * line per file is written to out in input order once all are done:
+  *
+  *     <path> ACCEPT steps=<n> [value=<v>] [nodes=<n>]
+  *     <path> ERROR steps=<n> [errors=<e>] line=<l> position=<p>: <message>
+  *
+  * With error recovery the ERROR line shows the first error and, when
+  * there are more, their number.
+  *
+  * A debug file per input (see generate_output_filename) is only written
+  * when the parser's trace level asks for one. With Parser.collect_stats
+  * set the counters of every parse are added up in the summary; the
+  * phase times are summed over the threads.
+  *
+  * @param parser Parser of the first worker, its tables and flags are shared
+  * @param paths Files or directories to parse
+  * @param count Number of paths, 0 to read them from manifest
+  * @param manifest Path list used when count is 0 (may be NULL)
+  * @param out Receives the per-file result lines
+  * @param jobs Number of worker threads (1 parses in the calling thread only)
+  * @return BatchSummary Totals and elapsed time
+  */
+ BatchSummary batch_run(Parser* parser, const char* const* paths, int count, FILE* manifest,
+                        FILE* out, int jobs);
+
+ /**
+  * @brief Default number of batch workers
+  *
+  * @return int Number of online processors, at least 1
+  */
+ int batch_default_jobs(void);
+
+ #endif /* BATCH_H */
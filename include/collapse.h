@@ -0,0 +1,48 @@
+/**
+ * @file collapse.h
+ * @brief Unit production elimination on parsing tables
+ */
+
+ #ifndef COLLAPSE_H
+ #define COLLAPSE_H
+
+ #include "parser.h"
+ #include "semantic.h"
+
+ /**
+  * @brief Summary of a collapse
+  */
+ typedef struct {
+     int units_removed;  // Unit productions no longer reduced by any state
+     int states_before;  // States of the original tables
+     int states_after;   // States of the collapsed tables
+ } CollapseReport;
+
+ /**
+  * @brief Build tables that skip the reductions by unit productions
+  *
+  * A production with a single symbol on the right, like t → f or f → NUM,
+  * only relabels the entry on top of the stack. Every shift or goto into
+  * a state that reduces by one is pointed at a state that does on each
+  * lookahead what the parse does after following such reductions through
+  * (f → NUM, t → f, e → t up to the first shift, accept or longer
+  * reduction). Those states are split by the state below them where the
+  * gotos differ, and states no longer reachable are dropped. The parse
+  * accepts and rejects the same inputs at the same tokens in fewer steps;
+  * the entry left on the stack keeps the symbol that was shifted or
+  * reduced (NUM or f where the full parse has t or e). Error recovery
+  * may resume at other tokens, the states on the stack differ.
+  *
+  * A production is collapsed only if actions is NULL or its action is
+  * semantic_copy, so the values are the same. A syntax tree would lose
+  * the skipped nodes, collapsed tables are not meant for AstBuilder.
+  *
+  * @param tables Tables to collapse (not modified)
+  * @param actions Reduce actions the tables will be used with (may be NULL)
+  * @param report Receives the summary (may be NULL)
+  * @return ParsingTables* New tables (free with free_parsing_tables)
+  */
+ ParsingTables* collapse_unit_productions(const ParsingTables* tables, const SemanticAction* actions,
+                                          CollapseReport* report);
+
+ #endif /* COLLAPSE_H */
@@ -0,0 +1,60 @@
+/**
+ * @file engine.h
+ * @brief Parse loop generated for the built-in grammar
+ */
+
+ #ifndef ENGINE_H
+ #define ENGINE_H
+
+ #include <stdint.h>
+ #include <stdbool.h>
+ #include "parser.h"
+
+ // Entries of the state stack allocated by the first parse
+ #define ENGINE_INITIAL_CAPACITY 256
+
+ /**
+  * @brief Outcome of a run of the generated engine
+  */
+ typedef enum {
+     ENGINE_ACCEPTED,  // The input is a sentence of the grammar
+     ENGINE_REJECTED,  // Syntax error at error_token
+     ENGINE_FAILED     // The tables have no goto for a reduction (not a valid automaton)
+ } EngineStatus;
+
+ /**
+  * @brief State of a run of the generated engine
+  *
+  * Only states are stacked: the engine recognizes the input without
+  * semantic values, syntax tree or trace, and stops at the first error.
+  */
+ typedef struct {
+     TokenStream* input;   // Input positioned at its first token
+     uint16_t* states;     // State stack storage, grown as needed and kept by the caller
+     int capacity;         // Entries in states
+     int steps;            // Parse steps, counted like the table-driven loop
+     Token* error_token;   // Token rejected (ENGINE_REJECTED)
+     int error_state;      // State that rejected it
+ } EngineRun;
+
+ /**
+  * @brief Check whether the generated engine implements these tables
+  *
+  * @param tables Parsing tables
+  * @return true For the built-in tables the engine was generated from
+  */
+ bool engine_supports(const ParsingTables* tables);
+
+ /**
+  * @brief Parse the input with the generated engine
+  *
+  * Makes no function call per step besides reading the next token after
+  * a shift. run->states may be NULL with a capacity of 0; it is grown on
+  * demand and the caller frees it.
+  *
+  * @param run Input and state stack, receives the step count and error token
+  * @return EngineStatus Outcome of the parse
+  */
+ EngineStatus engine_run(EngineRun* run);
+
+ #endif /* ENGINE_H */
@@ -0,0 +1,97 @@
+/**
+ * @file grammar.h
+ * @brief BNF grammar descriptions for the table generator
+ */
+
+ #ifndef GRAMMAR_H
+ #define GRAMMAR_H
+
+ #include <stdbool.h>
+ #include "token.h"
+
+ // Terminals are the TokenType values up to and including TOKEN_EOF
+ #define GRAMMAR_TERMINALS (TOKEN_EOF + 1)
+
+ // Symbol encoding in GrammarRule::rhs: terminals are their TokenType
+ // value, non-terminal i is GRAMMAR_NT(i)
+ #define GRAMMAR_NT(index)       (GRAMMAR_TERMINALS + (index))
+ #define GRAMMAR_IS_NT(symbol)   ((symbol) >= GRAMMAR_TERMINALS)
+ #define GRAMMAR_NT_INDEX(symbol) ((symbol) - GRAMMAR_TERMINALS)
+
+ /**
+  * @brief One alternative of a grammar rule
+  */
+ typedef struct {
+     int lhs;         // Non-terminal index
+     int* rhs;        // Right-hand side symbols (GRAMMAR_NT encoding)
+     int rhs_length;  // Number of symbols, 0 for an empty alternative
+     int line;        // Line of the alternative in the grammar source
+ } GrammarRule;
+
+ /**
+  * @brief Grammar read from a BNF description
+  *
+  * Rules are numbered from 1 in source order; the first rule's
+  * left-hand side is the start symbol.
+  */
+ typedef struct {
+     char** names;           // Non-terminal names, interned by index
+     int num_non_terminals;  // Number of non-terminals
+     GrammarRule* rules;     // Rules, index 0 unused
+     int num_rules;          // Number of rules
+     int capacity;           // Allocated entries in rules
+ } Grammar;
+
+ /**
+  * @brief Read a grammar from BNF source text
+  *
+  * Format, one rule per non-terminal with '|' separated alternatives:
+  *
+  *     # comment
+  *     e : e PLUS t
+  *       | t ;
+  *
+  * Upper-case names of TokenType values (NUM, PLUS, ...) are terminals,
+  * every other name is a non-terminal and must have a rule. EOF is
+  * implicit and may not be used. Errors are reported with log_error.
+  *
+  * @param source NUL-terminated grammar text
+  * @param source_name Name used in error messages
+  * @return Grammar* Parsed grammar or NULL on error
+  */
+ Grammar* grammar_parse(const char* source, const char* source_name);
+
+ /**
+  * @brief Read a grammar from a file
+  *
+  * @param filename Grammar file
+  * @return Grammar* Parsed grammar or NULL on error
+  */
+ Grammar* grammar_load(const char* filename);
+
+ /**
+  * @brief Read a whole file into a NUL-terminated heap buffer
+  *
+  * @param filename File to read
+  * @param length Receives the file length (may be NULL)
+  * @return char* File contents (must be freed by caller) or NULL on error
+  */
+ char* grammar_read_file(const char* filename, size_t* length);
+
+ /**
+  * @brief Free a grammar
+  *
+  * @param grammar Grammar to free
+  */
+ void grammar_free(Grammar* grammar);
+
+ /**
+  * @brief Display name of a grammar symbol
+  *
+  * @param grammar Grammar
+  * @param symbol Symbol in GRAMMAR_NT encoding
+  * @return const char* Terminal or non-terminal name
+  */
+ const char* grammar_symbol_name(const Grammar* grammar, int symbol);
+
+ #endif /* GRAMMAR_H */
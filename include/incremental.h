@@ -0,0 +1,108 @@
+/**
+ * @file incremental.h
+ * @brief Incremental reparsing of an edited token sequence
+ */
+
+ #ifndef INCREMENTAL_H
+ #define INCREMENTAL_H
+
+ #include <stdint.h>
+ #include <stdbool.h>
+ #include "token.h"
+ #include "parser.h"
+
+ // Node index meaning "no node" (below the bottom of the stack)
+ #define INCREMENTAL_NONE UINT32_MAX
+
+ /**
+  * @brief Entry of the persistent state stack
+  *
+  * Entries are never changed once pushed, a pop only moves to the
+  * parent, so the stacks of all snapshots share their common bottom.
+  */
+ typedef struct {
+     int32_t state;    // Parser state
+     uint32_t parent;  // Entry below this one or INCREMENTAL_NONE
+     uint32_t depth;   // Number of entries below this one
+ } IncrementalNode;
+
+ /**
+  * @brief Token sequence with the parse state at every token boundary
+  */
+ typedef struct {
+     const ParsingTables* tables; // Tables used for every parse (not owned)
+     TokenStream* input;     // Owns the loaded and inserted tokens
+     Token** tokens;         // Current token sequence, without the final EOF
+     int num_tokens;         // Tokens in the sequence
+     int token_capacity;     // Allocated entries of tokens/snapshots
+     Token* eof;             // EOF token ending the sequence
+     uint32_t* snapshots;    // [i]: stack top before token i is shifted (num_tokens + 1 entries)
+     int valid_snapshots;    // Snapshots 0 .. valid_snapshots - 1 are set (fewer after an error)
+     IncrementalNode* nodes; // Pool of the persistent stack, node 0 is the initial state
+     uint32_t num_nodes;     // Nodes in use
+     uint32_t node_capacity; // Allocated nodes
+     bool success;           // The current sequence is accepted
+     int error_token;        // Index of the rejected token (num_tokens: the EOF)
+     int last_resumed;       // Token index the last parse started from
+     int last_shifted;       // Tokens shifted by the last parse
+     bool last_converged;    // The last parse stopped early, joining the previous one
+ } IncrementalParse;
+
+ /**
+  * @brief Create an empty incremental parse
+  *
+  * @param tables Parsing tables, must outlive the parse
+  * @return IncrementalParse* New parse without tokens
+  */
+ IncrementalParse* incremental_create(const ParsingTables* tables);
+
+ /**
+  * @brief Free an incremental parse and all its tokens
+  *
+  * @param parse Parse to free (may be NULL)
+  */
+ void incremental_free(IncrementalParse* parse);
+
+ /**
+  * @brief Read every token of a file and parse them from the start
+  *
+  * @param parse Parse without tokens
+  * @param input_file Input file path
+  * @param flags TOKEN_STREAM_* flags (streaming is ignored, every token is kept)
+  * @return bool False if the file cannot be read
+  */
+ bool incremental_load(IncrementalParse* parse, const char* input_file, unsigned flags);
+
+ /**
+  * @brief Replace a range of tokens and reparse
+  *
+  * Tokens start .. start + removed - 1 are replaced by the count tokens
+  * of inserted (copied, lexemes included). The parse resumes from the
+  * snapshot at start, which only depends on the tokens before it, and
+  * after every shifted token past the edit compares its stack with the
+  * previous parse's snapshot at the same token. Once they match, the
+  * rest of the previous parse is kept, so the work depends on the size
+  * of the edit and how far its effect reaches rather than the length of
+  * the input.
+  * A rejected sequence has no snapshots past its error, so the edit that
+  * fixes it parses the rest of the input again.
+  *
+  * @param parse Loaded parse
+  * @param start Index of the first replaced token
+  * @param removed Number of tokens removed
+  * @param inserted Tokens inserted in their place (may be NULL when count is 0)
+  * @param count Number of tokens inserted
+  * @return bool False if the range or a token type is invalid
+  */
+ bool incremental_edit(IncrementalParse* parse, int start, int removed,
+                       const Token* inserted, int count);
+
+ /**
+  * @brief Token rejected by the current parse
+  *
+  * @param parse Parse
+  * @return Token* Rejected token, NULL if the sequence is accepted
+  */
+ Token* incremental_error_token(const IncrementalParse* parse);
+
+ #endif /* INCREMENTAL_H */
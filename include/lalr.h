@@ -0,0 +1,48 @@
+/**
+ * @file lalr.h
+ * @brief LALR(1) parsing table generator
+ */
+
+ #ifndef LALR_H
+ #define LALR_H
+
+ #include <stdio.h>
+ #include "parser.h"
+ #include "grammar.h"
+
+ /**
+  * @brief Summary of a table build
+  */
+ typedef struct {
+     int num_states;     // States in the LALR(1) automaton
+     int shift_reduce;   // Shift/reduce conflicts, resolved as shift
+     int reduce_reduce;  // Reduce/reduce conflicts, resolved to the earlier rule
+ } LalrReport;
+
+ /**
+  * @brief Build LALR(1) parsing tables for a grammar
+  *
+  * Computes the LR(0) item sets, FIRST/FOLLOW and the LALR(1) lookaheads
+  * (by propagation through the LR(0) kernels). If the first rule is a
+  * single unit alternative whose left-hand side is not used elsewhere
+  * (like s → e) it is the accepting rule, otherwise an augmented rule
+  * $accept → start is added as production 0. Every conflict is reported
+  * with log_error and resolved the way yacc does.
+  *
+  * @param grammar Grammar to build tables for
+  * @param report Receives the build summary (may be NULL)
+  * @param listing Receives the sets and states in readable form (may be NULL)
+  * @return ParsingTables* New tables (free with free_parsing_tables) or NULL on error
+  */
+ ParsingTables* lalr_build(const Grammar* grammar, LalrReport* report, FILE* listing);
+
+ /**
+  * @brief Read a grammar file and build its LALR(1) tables
+  *
+  * @param filename Grammar file
+  * @param report Receives the build summary (may be NULL)
+  * @return ParsingTables* New tables or NULL on error
+  */
+ ParsingTables* lalr_build_from_file(const char* filename, LalrReport* report);
+
+ #endif /* LALR_H */
@@ -7,33 +7,57 @@
  #define PARSER_H
  
  #include <stdio.h>
+ #include <stdint.h>
  #include <stdbool.h>
  #include "token.h"
  #include "stack.h"
+ #include "semantic.h"
+ #include "ast.h"
+ #include "trace.h"
+ #include "stats.h"
  
  /**
   * @brief Grammar production rule
   */
  typedef struct {
-     int lhs;            // Left-hand side non-terminal
-     int* rhs;           // Right-hand side symbols
-     int rhs_length;     // Length of right-hand side
-     char* rule_string;  // String representation for debugging
+     int lhs;                 // Left-hand side non-terminal
+     const int* rhs;          // Right-hand side symbols
+     int rhs_length;          // Length of right-hand side
+     const char* rule_string; // String representation for debugging
  } Production;
  
  /**
   * @brief Parsing tables for LR parser
   */
  typedef struct {
-     int** action_table;       // Action table [state][token]
-     int** goto_table;         // Goto table [state][non-terminal]
+     const uint16_t* action_table; // Packed actions [state * num_terminals + token]
+     const int16_t* goto_table;    // Goto states [state * num_non_terminals + non-terminal]
      int num_states;           // Total number of states
-     int num_terminals;        // Number of terminal symbols
+     int num_terminals;        // Number of action table columns (one per TokenType)
      int num_non_terminals;    // Number of non-terminal symbols
-     Production* productions;  // Array of production rules
+     const char* const* non_terminal_names; // Names for the trace (NULL: get_non_terminal_name)
+     const uint32_t* expected;  // Terminals with an action in each state, bit 1 << TokenType
+     const char* const* expected_messages; // "expected ..." text of each state, from expected
+     const Production* productions; // Array of production rules
      int num_productions;      // Number of productions
+     bool is_static;           // Compile-time tables shared by all parsers, never freed
+     const char* cache_map;    // Cache file the arrays and strings point into (table_cache.h), or NULL
+     size_t cache_size;        // Bytes mapped at cache_map
  } ParsingTables;
  
+ /**
+  * @brief Trace output level for parsing
+  */
+ typedef enum {
+     TRACE_OFF,      // No trace output, no per-step string building (see Parser.binary_trace)
+     TRACE_SUMMARY,  // Only a final summary line in the debug file
+     TRACE_FILE,     // Full step trace to the debug file
+     TRACE_CONSOLE   // Full step trace to the debug file and console
+ } TraceLevel;
+ 
+ // Input tokens shown in the "Input Position" line of the step trace
+ #define TRACE_INPUT_TOKENS 5
+ 
  /**
   * @brief Debug information during parsing
   */
@@ -45,15 +69,36 @@
      char* action_taken;    // Details of action taken
  } DebugInfo;
  
+ // Errors collected by --recover when no limit is given
+ #define PARSER_DEFAULT_MAX_ERRORS 100
+ 
+ /**
+  * @brief One syntax error found during the parse
+  */
+ typedef struct {
+     int line;        // Line of the unexpected token
+     int position;    // Position of the unexpected token in its line
+     uint32_t expected; // Tokens the state had an action for, bit 1 << TokenType
+     char* message;   // Error description
+ } ParseError;
+ 
  /**
   * @brief Parse result structure
   */
  typedef struct {
      bool success;           // Overall success/failure
      int error_line;         // Line number if error
+     int error_position;     // Position in the line if error
      char* error_message;    // Error description
      DebugInfo* debug_trace; // Debug information
      int steps_taken;        // Number of parse steps
+     bool has_value;         // value holds the result of the reduce actions
+     SemValue value;         // Semantic value of the accepted input
+     Ast* ast;               // Tree of the accepted input (NULL unless Parser.ast_builder is set)
+     ParseError* errors;     // Every syntax error found, in input order (the first one is also in error_*)
+     int error_count;        // Entries in errors
+     int error_capacity;     // Entries allocated in errors
+     ParseStats* stats;      // Performance counters (NULL unless Parser.collect_stats is set)
  } ParseResult;
  
  /**
@@ -62,20 +107,54 @@
  typedef struct {
      Stack* stack;          // Parser stack
      TokenStream* input;    // Input token stream
-     ParsingTables* tables; // Action and goto tables
-     bool debug_mode;       // Debug output control
+     unsigned input_flags;  // TOKEN_STREAM_* flags used to open the input
+     const ParsingTables* tables; // Action and goto tables (read-only, may be shared)
+     bool owns_tables;      // Free the tables with the parser (false when borrowed)
+     const SemanticAction* actions; // Reduce actions by production (NULL: no semantic values)
+     AstBuilder* ast_builder; // Node pool for the syntax tree (NULL: no tree, overrides actions)
+     TraceLevel trace_level; // Trace output control
      FILE* debug_file;      // Debug output file
+     bool async_trace;      // Write the text trace to debug_file on a background thread
+     struct AsyncWriter* trace_pipe; // Writer thread of debug_file (NULL: written in place)
+     bool binary_trace;     // Write output_file as a binary trace (trace.h) instead of text
+     const char* grammar_file; // Grammar file of the tables, recorded in binary traces (NULL: built-in)
+     TraceWriter* trace_writer; // Binary trace of the current parse
+     uint32_t token_index;  // Index of the current input token
      int current_state;     // Current parser state
-     int error_count;       // Number of errors encountered
+     int error_count;       // Syntax errors found by the current parse
+     int max_errors;        // Syntax errors collected before giving up (1: stop at the first)
+     bool recovering;       // Nothing shifted since the last recovery, further errors are not reported
+     int step_number;       // Step counter for the trace of the current parse
+     StrBuf trace_text;     // Text of the current trace step, reused by every step
+     StrBuf trace_action;   // Action column of the current trace step
+     bool collect_stats;    // Fill ParseResult.stats (reads the clock around every scan and trace write)
+     ParseStats* stats;     // Counters of the current parse (NULL when not collected)
+     bool fast_engine;      // Run the generated engine when the parse allows it (see parser_uses_engine)
+     uint16_t* engine_states; // State stack of the generated engine, kept between parses
+     int engine_capacity;   // Entries in engine_states
+     TokenStream* buffer_input; // Stream reused by parser_parse_buffer (NULL before the first)
+     Token bottom_token;    // "$" symbol at the bottom of the stack
  } Parser;
  
  /**
   * @brief Initialize the parser
   * 
-  * @param debug_mode Enable/disable debugging
+  * @param trace_level Amount of trace output to produce
   * @return Parser* Initialized parser or NULL on failure
   */
- Parser* parser_create(bool debug_mode);
+ Parser* parser_create(TraceLevel trace_level);
+ 
+ /**
+  * @brief Create a parser with the tables and options of another
+  * 
+  * The tables and reduce actions are shared, not owned; the new parser
+  * gets its own stack and, if parser builds syntax trees, its own
+  * AstBuilder. Each thread parsing with the same setup needs one.
+  * 
+  * @param parser Parser to copy the setup from
+  * @return Parser* New parser (free with parser_free before the tables)
+  */
+ Parser* parser_create_worker(const Parser* parser);
  
  /**
   * @brief Clean up parser resources
@@ -87,13 +166,85 @@
  /**
   * @brief Parse input file
   * 
+  * The parser can be reused for any number of inputs, each parse starts
+  * from the initial state. With max_errors above 1, a syntax error does
+  * not end the parse: input tokens are skipped until one that a state on
+  * the stack has an action for, such as ')' or the end of input, and the
+  * stack is popped down to that state (panic mode). Errors until the next
+  * shift are not reported again. Such a parse never succeeds but lists
+  * every error it found. Release the result with parse_result_free.
+  * 
   * @param parser Initialized parser
   * @param input_file Input file path
-  * @param output_file Output debug file path (can be NULL)
+  * @param output_file Output debug file path, or binary trace path when binary_trace is set (can be NULL)
   * @return ParseResult Parse result
   */
  ParseResult parser_parse(Parser* parser, const char* input_file, const char* output_file);
  
+ /**
+  * @brief Parse the tokens of an already open stream
+  * 
+  * Same as parser_parse without the debug file: the console trace is
+  * still printed at TRACE_CONSOLE. Line numbers of errors are those of
+  * the stream's tokens.
+  * 
+  * @param parser Initialized parser
+  * @param input Token stream, left open for the caller to free
+  * @return ParseResult Parse result
+  */
+ ParseResult parser_parse_stream(Parser* parser, TokenStream* input);
+ 
+ /**
+  * @brief Parse tokens held in memory, reusing the parser's stream
+  * 
+  * The first call opens a buffer stream (token_stream_open_buffer) that
+  * the parser keeps; later calls point it at the new data, so its arena
+  * and struct are reused along with the stack. Once they have grown to
+  * the inputs' size, a parse that is accepted without a syntax tree or
+  * counters makes no heap allocation at all. Lines are numbered from 1,
+  * no debug file is written and the console trace is printed as by
+  * parser_parse_stream. data only has to last for the call.
+  * 
+  * @param parser Initialized parser
+  * @param data Token text (not NUL-terminated)
+  * @param size Bytes of token text
+  * @return ParseResult Parse result
+  */
+ ParseResult parser_parse_buffer(Parser* parser, const char* data, size_t size);
+ 
+ /**
+  * @brief Return the parser to its initial state, keeping its memory
+  * 
+  * Pops the stack back to state 0 without shrinking it and clears the
+  * error, token and step counters, the trace buffers and the syntax tree
+  * pool. Every parse starts with this, so calling it is only needed to
+  * drop what a finished parse left on the stack before the next one.
+  * 
+  * @param parser Parser (may be NULL)
+  */
+ void parser_reset(Parser* parser);
+ 
+ /**
+  * @brief Check whether parser_parse runs the generated engine
+  * 
+  * With fast_engine set, the built-in tables are parsed by the loop the
+  * build generated for them (engine.h) unless something needs the
+  * table-driven loop: a step trace, semantic actions, a syntax tree,
+  * error recovery or the performance counters. Both give the same
+  * result and step count.
+  * 
+  * @param parser Initialized parser
+  * @return true If the next parse runs the generated engine
+  */
+ bool parser_uses_engine(const Parser* parser);
+ 
+ /**
+  * @brief Free everything held by a parse result
+  * 
+  * @param result Result of parser_parse
+  */
+ void parse_result_free(ParseResult* result);
+ 
  /**
   * @brief Create production rules for grammar
   * 
@@ -102,11 +253,11 @@
  ParsingTables* create_parsing_tables();
  
  /**
-  * @brief Free parsing tables
+  * @brief Free parsing tables (does nothing for static tables)
   * 
   * @param tables Tables to free
   */
- void free_parsing_tables(ParsingTables* tables);
+ void free_parsing_tables(const ParsingTables* tables);
  
  /**
   * @brief Perform shift operation
@@ -128,7 +279,7 @@
  bool perform_reduce(Parser* parser, int production_num);
  
  /**
-  * @brief Write debug information
+  * @brief Write debug information (no-op below TRACE_FILE)
   * 
   * @param parser Parser
   * @param operation Operation name
@@ -144,7 +295,7 @@
   * @param token_type Token type
   * @return int Action value
   */
- int get_action(ParsingTables* tables, int state, TokenType token_type);
+ int get_action(const ParsingTables* tables, int state, TokenType token_type);
  
  /**
   * @brief Get goto state from parsing table
@@ -154,6 +305,6 @@
   * @param non_terminal Non-terminal symbol
   * @return int Next state
   */
- int get_goto_state(ParsingTables* tables, int state, int non_terminal);
+ int get_goto_state(const ParsingTables* tables, int state, int non_terminal);
  
  #endif /* PARSER_H */
\ No newline at end of file
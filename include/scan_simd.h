@@ -0,0 +1,57 @@
+/**
+ * @file scan_simd.h
+ * @brief Vectorized byte scanning primitives for the token scanner
+ */
+
+ #ifndef SCAN_SIMD_H
+ #define SCAN_SIMD_H
+
+ /**
+  * @brief Line bookkeeping for scan_skip_space
+  */
+ typedef struct {
+     int newlines;           // Number of '\n' bytes skipped
+     const char* line_start; // Byte after the last skipped '\n' (NULL if none)
+ } ScanLines;
+
+ /**
+  * @brief Skip whitespace (as isspace in the C locale)
+  *
+  * @param pos Start of the range
+  * @param end End of the range
+  * @param lines Receives the newlines crossed while skipping
+  * @return const char* First non-whitespace byte or end
+  */
+ const char* scan_skip_space(const char* pos, const char* end, ScanLines* lines);
+
+ /**
+  * @brief Find the first byte equal to a or b
+  *
+  * @param pos Start of the range
+  * @param end End of the range
+  * @param a First byte to look for
+  * @param b Second byte to look for
+  * @return const char* First match or end
+  */
+ const char* scan_find2(const char* pos, const char* end, char a, char b);
+
+ /**
+  * @brief Find the first byte equal to a, b or c
+  *
+  * @param pos Start of the range
+  * @param end End of the range
+  * @param a First byte to look for
+  * @param b Second byte to look for
+  * @param c Third byte to look for
+  * @return const char* First match or end
+  */
+ const char* scan_find3(const char* pos, const char* end, char a, char b, char c);
+
+ /**
+  * @brief Name of the implementation selected at build/run time
+  *
+  * @return const char* "avx2", "sse2", "neon" or "scalar"
+  */
+ const char* scan_backend_name(void);
+
+ #endif /* SCAN_SIMD_H */
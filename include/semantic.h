@@ -0,0 +1,46 @@
+/**
+ * @file semantic.h
+ * @brief Reduce actions computing semantic values during the parse
+ */
+
+ #ifndef SEMANTIC_H
+ #define SEMANTIC_H
+
+ #include "stack.h"
+
+ /**
+  * @brief Reduce action for one production
+  *
+  * Called before the right-hand side is popped: its symbols and values
+  * are the stack entries base .. base + rhs_length - 1.
+  *
+  * @param stack Parser stack
+  * @param base Index of the first right-hand side entry
+  * @return SemValue Value of the left-hand side
+  */
+ typedef SemValue (*SemanticAction)(Stack* stack, int base);
+
+ /**
+  * @brief Reduce action of a unit production: the value of its only symbol
+  *
+  * Unit productions with this action can be collapsed (see collapse.h).
+  *
+  * @param stack Parser stack
+  * @param base Index of the right-hand side entry
+  * @return SemValue Value of that entry
+  */
+ SemValue semantic_copy(Stack* stack, int base);
+
+ /**
+  * @brief Reduce actions evaluating the built-in expression grammar
+  *
+  * Indexed by production number (entry 0 unused). Also valid for tables
+  * whose productions are those of the built-in ones in the same order,
+  * such as the tables of grammars/expr.bnf; check with
+  * automaton_same_productions before using them with other tables.
+  *
+  * @return const SemanticAction* Actions for productions 0..7
+  */
+ const SemanticAction* semantic_expr_actions(void);
+
+ #endif /* SEMANTIC_H */
@@ -0,0 +1,56 @@
+/**
+ * @file split.h
+ * @brief Split mode: parse the independent expressions of one file in parallel
+ */
+
+ #ifndef SPLIT_H
+ #define SPLIT_H
+
+ #include <stdio.h>
+ #include "parser.h"
+
+ /**
+  * @brief Totals of a split run
+  */
+ typedef struct {
+     int expressions; // Expressions parsed
+     int accepted;    // Expressions accepted
+     int failed;      // Expressions rejected, or 1 if the file is not readable
+     double seconds;  // Wall-clock time of the whole run
+     int threads;     // Worker threads used
+     ParseStats* stats; // Counters added up over all expressions (NULL unless the parser collects them, caller frees)
+ } SplitSummary;
+
+ /**
+  * @brief Parse every expression of one input with one parser per worker thread
+  *
+  * The file is mapped and cut into expressions without scanning them:
+  * with delimiter NULL every line is one expression, otherwise the
+  * tokens between two tokens of the category delimiter are (for "SEMI",
+  * the tokens around each <;, SEMI>), the delimiters belonging to
+  * neither. Blank expressions are skipped. Each expression is scanned in
+  * place by its own stream that numbers lines and positions as in the
+  * whole file. The calling thread is the first worker and uses parser,
+  * the others get their own parser sharing parser's tables; they take
+  * blocks of consecutive expressions from a shared counter. No debug
+  * file is written. One result line per expression is written to out in
+  * input order once all are done:
+  *
+  *     <path>:<line> ACCEPT steps=<n> [value=<v>] [nodes=<n>]
+  *     <path>:<line> ERROR steps=<n> [errors=<e>] line=<l> position=<p>: <message>
+  *
+  * where the first line is that of the expression's first token. With
+  * Parser.collect_stats set the counters of every parse are added up in
+  * the summary; the phase times are summed over the threads.
+  *
+  * @param parser Parser of the first worker, its tables and flags are shared
+  * @param input_file File of expressions
+  * @param delimiter Category of the delimiter token, NULL for one expression per line
+  * @param out Receives the per-expression result lines
+  * @param jobs Number of worker threads (1 parses in the calling thread only)
+  * @return SplitSummary Totals and elapsed time
+  */
+ SplitSummary split_run(Parser* parser, const char* input_file, const char* delimiter,
+                        FILE* out, int jobs);
+
+ #endif /* SPLIT_H */
@@ -7,25 +7,53 @@
  #define STACK_H
  
  #include <stdbool.h>
+ #include <stdint.h>
  #include "token.h"
  
+ /**
+  * @brief Semantic value attached to a stack entry
+  */
+ typedef union {
+     double number;  // Value of an evaluated expression
+     uint32_t node;  // Syntax tree node of the symbol (see ast.h)
+ } SemValue;
+ 
  /**
   * @brief Stack element structure for parsing
   */
  typedef struct StackElement {
      int state;                  // Current parsing state
      Token* symbol;              // Current symbol
+     SemValue value;             // Semantic value (set by stack_push_value)
      struct StackElement* next;  // Next stack element
  } StackElement;
  
+ #ifdef STACK_IMPL_LINKED
+ 
  /**
-  * @brief Stack structure for parser
+  * @brief Stack structure for parser (linked list of elements)
   */
  typedef struct {
      StackElement* top;  // Top of the stack
      int size;           // Current stack size
  } Stack;
  
+ #else
+ 
+ /**
+  * @brief Stack structure for parser (parallel contiguous arrays)
+  */
+ typedef struct {
+     int* states;        // States, bottom of the stack at index 0
+     Token** symbols;    // Symbols, parallel to states
+     SemValue* values;   // Semantic values, allocated by the first stack_push_value
+     int size;           // Current stack size
+     int capacity;       // Allocated slots in states/symbols
+     StackElement view;  // Element returned by stack_peek
+ } Stack;
+ 
+ #endif /* STACK_IMPL_LINKED */
+ 
  /**
   * @brief Create a new stack
   * 
@@ -51,6 +79,18 @@
   */
  bool stack_push(Stack* stack, int state, Token* symbol);
  
+ /**
+  * @brief Push state, symbol and semantic value onto stack
+  * 
+  * @param stack Stack
+  * @param state State to push
+  * @param symbol Symbol to push (not copied)
+  * @param value Semantic value of the symbol
+  * @return true If push successful
+  * @return false If push failed
+  */
+ bool stack_push_value(Stack* stack, int state, Token* symbol, SemValue value);
+ 
  /**
   * @brief Pop top element from stack
   * 
@@ -59,14 +99,93 @@
   */
  StackElement* stack_pop(Stack* stack);
  
+ /**
+  * @brief Pop several elements at once without returning them
+  * 
+  * @param stack Stack
+  * @param count Number of elements to drop
+  * @return true If count elements were removed
+  * @return false If the stack holds fewer than count elements (stack unchanged)
+  */
+ bool stack_pop_n(Stack* stack, int count);
+ 
+ /**
+  * @brief Pop several elements, passing the symbol of each to a function first
+  * 
+  * Visits the elements once from the top, so the cost is linear in count
+  * for both stack implementations.
+  * 
+  * @param stack Stack
+  * @param count Number of elements to drop
+  * @param visit Called with the symbol of every dropped element and context
+  * @param context Passed to visit
+  * @return true If count elements were removed
+  * @return false If the stack holds fewer than count elements (stack unchanged)
+  */
+ bool stack_pop_n_visit(Stack* stack, int count, void (*visit)(Token* symbol, void* context),
+                        void* context);
+ 
  /**
   * @brief Peek at top element without removing
   * 
+  * The returned element is only valid until the next stack operation.
+  * 
   * @param stack Stack
   * @return StackElement* Top element or NULL if stack empty
   */
  StackElement* stack_peek(Stack* stack);
  
+ /**
+  * @brief Get the state on top of the stack
+  * 
+  * @param stack Stack
+  * @return int Top state or -1 if stack empty
+  */
+ int stack_top_state(Stack* stack);
+ 
+ /**
+  * @brief Get the state at a given depth
+  * 
+  * @param stack Stack
+  * @param index Element index, 0 is the bottom of the stack
+  * @return int State or -1 if index out of range
+  */
+ int stack_state_at(Stack* stack, int index);
+ 
+ /**
+  * @brief Find the topmost state satisfying a predicate
+  * 
+  * Walks the stack once from the top, unlike repeated stack_state_at
+  * calls, which the linked stack answers by walking from the top each time.
+  * 
+  * @param stack Stack
+  * @param predicate Called with each state and context, from the top down
+  * @param context Passed to predicate
+  * @return int Index of the element (0 is the bottom), -1 if no state matches
+  */
+ int stack_find_top_state(Stack* stack, bool (*predicate)(int state, const void* context),
+                          const void* context);
+ 
+ /**
+  * @brief Get the symbol at a given depth
+  * 
+  * @param stack Stack
+  * @param index Element index, 0 is the bottom of the stack
+  * @return Token* Symbol or NULL if index out of range
+  */
+ Token* stack_symbol_at(Stack* stack, int index);
+ 
+ /**
+  * @brief Get the semantic value at a given depth
+  * 
+  * Only entries pushed with stack_push_value have a defined value.
+  * 
+  * @param stack Stack
+  * @param index Element index, 0 is the bottom of the stack
+  * @return SemValue Value (zero if index out of range)
+  */
+ SemValue stack_value_at(Stack* stack, int index);
+ 
  /**
   * @brief Check if stack is empty
   * 
@@ -92,4 +211,14 @@
   */
  char* stack_to_string(Stack* stack);
  
+ /**
+  * @brief Append the string representation of the stack to a builder
+  * 
+  * Same text as stack_to_string, rendered in one pass from the bottom.
+  * 
+  * @param stack Stack (NULL renders as [])
+  * @param out Builder
+  */
+ void stack_append_string(Stack* stack, StrBuf* out);
+ 
  #endif /* STACK_H */
\ No newline at end of file
@@ -0,0 +1,73 @@
+/**
+ * @file stats.h
+ * @brief Performance counters of a parse
+ */
+
+ #ifndef STATS_H
+ #define STATS_H
+
+ #include <stdio.h>
+ #include <stdint.h>
+
+ /**
+  * @brief Counters and phase times of one parse (or totals of several)
+  *
+  * The times come from a monotonic clock. scan_ns covers opening the
+  * input and reading tokens, trace_ns rendering and writing the trace,
+  * and dispatch_ns the rest of the parse loop: table lookups, shifts,
+  * reduces and their semantic actions.
+  */
+ typedef struct {
+     uint64_t parses;              // Parses counted (1 unless totals were added up)
+     uint64_t steps;               // Parse steps
+     uint64_t shifts;              // Tokens shifted
+     uint64_t reduces;             // Reductions
+     uint64_t* production_reduces; // Reductions by production, index 1 .. num_productions
+     int num_productions;          // Productions of the tables
+     int max_stack_depth;          // Most entries on the stack at once
+     uint64_t tokens_scanned;      // Tokens read from the input, EOF included
+     uint64_t bytes_read;          // Input bytes consumed by the scanner
+     uint64_t allocations;         // Heap allocations, see allocation_count
+     uint64_t scan_ns;             // Time opening the input and scanning tokens
+     uint64_t dispatch_ns;         // Time in the table lookups and parser actions
+     uint64_t trace_ns;            // Time producing the trace
+     uint64_t total_ns;            // Time of the whole parse
+ } ParseStats;
+
+ /**
+  * @brief Create zeroed counters
+  *
+  * @param num_productions Productions of the tables the parse uses
+  * @return ParseStats* New counters
+  */
+ ParseStats* parse_stats_create(int num_productions);
+
+ /**
+  * @brief Free counters
+  *
+  * @param stats Counters to free (may be NULL)
+  */
+ void parse_stats_free(ParseStats* stats);
+
+ /**
+  * @brief Add the counters of a parse to a total
+  *
+  * Counts and times are summed, the stack depth is the largest of both.
+  *
+  * @param total Totals, with at least as many productions as stats
+  * @param stats Counters to add
+  */
+ void parse_stats_add(ParseStats* total, const ParseStats* stats);
+
+ /**
+  * @brief Write the counters as one JSON object
+  *
+  * Times are in nanoseconds; "reduces_by_production" lists the
+  * reductions of rule 1, 2, ... in order.
+  *
+  * @param stats Counters
+  * @param out Output stream
+  */
+ void parse_stats_print_json(const ParseStats* stats, FILE* out);
+
+ #endif /* STATS_H */
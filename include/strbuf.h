@@ -0,0 +1,105 @@
+/**
+ * @file strbuf.h
+ * @brief Growable string builder
+ */
+
+ #ifndef STRBUF_H
+ #define STRBUF_H
+
+ #include <stddef.h>
+
+ /**
+  * @brief String under construction
+  *
+  * Tracks its length and capacity so appending costs the length of the
+  * appended text only. The capacity grows geometrically and is kept by
+  * strbuf_clear, so a builder reused for every step stops allocating once
+  * it has reached the longest text. data is NUL-terminated whenever it
+  * is not NULL.
+  */
+ typedef struct {
+     char* data;       // Text, NULL until the first append
+     size_t length;    // Bytes of text, without the terminator
+     size_t capacity;  // Allocated bytes of data
+ } StrBuf;
+
+ /**
+  * @brief Initialize an empty builder (allocates nothing)
+  *
+  * @param buf Builder
+  */
+ void strbuf_init(StrBuf* buf);
+
+ /**
+  * @brief Free the text of a builder and leave it empty
+  *
+  * @param buf Builder
+  */
+ void strbuf_free(StrBuf* buf);
+
+ /**
+  * @brief Empty the builder but keep its memory
+  *
+  * @param buf Builder
+  */
+ void strbuf_clear(StrBuf* buf);
+
+ /**
+  * @brief Make room for more bytes
+  *
+  * @param buf Builder
+  * @param extra Bytes that will be appended
+  */
+ void strbuf_reserve(StrBuf* buf, size_t extra);
+
+ /**
+  * @brief Append bytes of known length
+  *
+  * @param buf Builder
+  * @param text Bytes to append (need not be NUL-terminated)
+  * @param length Number of bytes
+  */
+ void strbuf_append(StrBuf* buf, const char* text, size_t length);
+
+ /**
+  * @brief Append a NUL-terminated string
+  *
+  * @param buf Builder
+  * @param text String to append
+  */
+ void strbuf_append_str(StrBuf* buf, const char* text);
+
+ /**
+  * @brief Append one character
+  *
+  * @param buf Builder
+  * @param c Character
+  */
+ void strbuf_append_char(StrBuf* buf, char c);
+
+ /**
+  * @brief Append an integer in decimal
+  *
+  * @param buf Builder
+  * @param value Integer
+  */
+ void strbuf_append_int(StrBuf* buf, long value);
+
+ /**
+  * @brief Append printf-style formatted text
+  *
+  * @param buf Builder
+  * @param format Format string
+  * @param ... Additional arguments
+  */
+ void strbuf_appendf(StrBuf* buf, const char* format, ...);
+
+ /**
+  * @brief Take the text out of the builder
+  *
+  * @param buf Builder, left empty
+  * @return char* NUL-terminated text (must be freed by caller)
+  */
+ char* strbuf_detach(StrBuf* buf);
+
+ #endif /* STRBUF_H */
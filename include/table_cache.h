@@ -0,0 +1,105 @@
+/**
+ * @file table_cache.h
+ * @brief Binary cache of the parsing tables built from a grammar file
+ *
+ * The file holds the tables in the layout ParsingTables uses, so loading
+ * it maps the file and points the tables into the mapping: the action,
+ * goto and expected-token arrays and every string are used in place,
+ * only the Production records and the string pointer arrays are built.
+ * Processes loading the same cache share its pages through the page
+ * cache. Layout, all numbers in host byte order:
+ *
+ *     header (TableCacheHeader in table_cache.c)
+ *     uint16_t actions[num_states * num_terminals]
+ *     int16_t  gotos[num_states * num_non_terminals]
+ *     uint32_t expected[num_states]
+ *     productions[num_productions + 1]  (lhs, rhs length, rhs start, rule string)
+ *     int32_t  rhs[]                    (the right-hand sides, one after another)
+ *     uint32_t names[num_non_terminals], messages[num_states] (string offsets)
+ *     strings                           (NUL-terminated)
+ *
+ * every section starting at a multiple of 8. The header records a format
+ * version, the byte order, a hash of the grammar source and an FNV-1a
+ * checksum of everything after it; a file that differs in any of them is
+ * not used.
+ */
+
+ #ifndef TABLE_CACHE_H
+ #define TABLE_CACHE_H
+
+ #include <stdint.h>
+ #include <stdbool.h>
+ #include <stddef.h>
+ #include "parser.h"
+ #include "lalr.h"
+
+ // Bumped whenever the layout or the meaning of the tables changes
+ #define TABLE_CACHE_VERSION 1
+
+ /**
+  * @brief Outcome of loading a cache file
+  */
+ typedef enum {
+     TABLE_CACHE_LOADED,   // Tables mapped from the file
+     TABLE_CACHE_MISSING,  // No cache file yet
+     TABLE_CACHE_STALE,    // Written for another grammar source or format version
+     TABLE_CACHE_INVALID   // Truncated, corrupted or from another platform
+ } TableCacheStatus;
+
+ /**
+  * @brief 64-bit FNV-1a hash
+  *
+  * @param data Bytes to hash
+  * @param size Number of bytes
+  * @return uint64_t Hash
+  */
+ uint64_t table_cache_hash(const void* data, size_t size);
+
+ /**
+  * @brief Write tables to a cache file
+  *
+  * The file is written under a temporary name and renamed into place, so
+  * a process loading it never sees it half written.
+  *
+  * @param tables Tables to save
+  * @param path Cache file
+  * @param source_hash table_cache_hash of the grammar source
+  * @param report Conflict counts of the build, stored for later loads (may be NULL)
+  * @return bool False if the file cannot be written
+  */
+ bool table_cache_save(const ParsingTables* tables, const char* path, uint64_t source_hash,
+                       const LalrReport* report);
+
+ /**
+  * @brief Map tables from a cache file
+  *
+  * Checks the header and checksum and that every index and state in the
+  * tables is in range before using them.
+  *
+  * @param path Cache file
+  * @param source_hash table_cache_hash of the grammar source the tables must be built from
+  * @param report Receives the stored build summary (may be NULL)
+  * @param status Receives why nothing was loaded (may be NULL)
+  * @return ParsingTables* Tables (free with free_parsing_tables, which unmaps them) or NULL
+  */
+ ParsingTables* table_cache_load(const char* path, uint64_t source_hash, LalrReport* report,
+                                 TableCacheStatus* status);
+
+ /**
+  * @brief Tables of a grammar file, from the cache when it is up to date
+  *
+  * Hashes the grammar file and maps the cache if it was written for that
+  * source; otherwise builds the tables with lalr_build_from_file and
+  * rewrites the cache (a write failure is logged, the tables are still
+  * returned).
+  *
+  * @param grammar_file Grammar file
+  * @param cache_file Cache file of its tables
+  * @param report Receives the build summary (may be NULL)
+  * @param status Receives how the cache was found (may be NULL)
+  * @return ParsingTables* Tables (free with free_parsing_tables) or NULL on error
+  */
+ ParsingTables* table_cache_build(const char* grammar_file, const char* cache_file,
+                                  LalrReport* report, TableCacheStatus* status);
+
+ #endif /* TABLE_CACHE_H */
@@ -10,6 +10,8 @@
  #include <stdio.h>
  #include <stdlib.h>
  #include <stdbool.h>
+ #include "arena.h"
+ #include "strbuf.h"
  
  /**
   * @brief Token types for the parser
@@ -30,20 +32,62 @@
   */
  typedef struct Token {
      TokenType type;      // Token type
-     char* lexeme;        // Actual string content of token
+     const char* lexeme;  // Actual string content of token (not always NUL-terminated)
+     int length;          // Length of lexeme in bytes
+     bool owns_lexeme;    // True if lexeme is a heap copy freed with the token
      int line_number;     // Source code line number
      int position;        // Position in line
      struct Token* next;  // For token list management
  } Token;
  
+ // Initial size of the scanner line buffer, longer lines are read in parts
+ // and the buffer grows for a token that does not fit
+ #define TOKEN_LINE_BUFFER_SIZE 1024
+ 
+ // TokenStream mode flags
+ #define TOKEN_STREAM_MMAP    0x1  // Map the whole file and scan it in place
+ #define TOKEN_STREAM_VERBOSE 0x2  // Print scanner progress to stdout
+ #define TOKEN_STREAM_STREAMING 0x4 // Do not retain consumed tokens, recycle released ones
+ #define TOKEN_STREAM_PREFETCH 0x8 // Read the file ahead on a background thread (not with MMAP)
+ 
+ // Lexemes up to this length are stored inside a recycled token slot
+ #define TOKEN_INLINE_LEXEME 16
+ 
+ struct TokenSlot;
+ struct AsyncReader;
+ 
  /**
   * @brief TokenStream structure for token iteration
   */
  typedef struct TokenStream {
      Token* current;     // Current token being processed
-     Token* head;        // Start of token list
+     Token* head;        // Start of token list (oldest retained token)
      FILE* input_file;   // Source file
-     int token_count;    // Total tokens processed
+     struct AsyncReader* prefetch; // Reads input_file ahead (TOKEN_STREAM_PREFETCH)
+     int token_count;    // Tokens scanned from the input, EOF included
+     size_t bytes_read;  // Input bytes consumed by the scanner
+     bool read_failed;   // A read error ended the input early
+     unsigned flags;     // TOKEN_STREAM_* mode flags
+     Arena* arena;       // Holds every token and copied lexeme of the stream
+     
+     // Token recycling (TOKEN_STREAM_STREAMING)
+     struct TokenSlot* free_slots; // Released tokens ready for reuse
+     struct TokenSlot* all_slots;  // Every slot allocated by the stream
+     
+     // Scanner state, one per stream so streams are independent
+     char* buffer;       // Current input line (NULL for mapped input)
+     size_t buffer_size; // Bytes allocated in buffer
+     char* current_pos;  // Scan position inside buffer
+     char* line_end;     // End of the data in buffer
+     int line;           // Current line number
+     int position;       // Current position in line
+     
+     // Mapped input (TOKEN_STREAM_MMAP or a buffer), lexemes are views into it
+     const char* map_data; // File contents
+     size_t map_size;      // File size in bytes
+     const char* map_pos;  // Scan position inside map_data
+     bool owns_map;        // map_data is a mapping of the stream (false: borrowed buffer)
+     
      bool (*has_next)(struct TokenStream*);   // Function to check if more tokens exist
      Token* (*peek_next)(struct TokenStream*); // Function to peek at next token
  } TokenStream;
@@ -56,6 +100,15 @@
   */
  TokenType token_type_from_string(const char* type_str);
  
+ /**
+  * @brief Convert a token type name of known length to the enum value
+  * 
+  * @param text Start of the type name (need not be NUL-terminated)
+  * @param length Length of the type name
+  * @return TokenType The corresponding token type enum value
+  */
+ TokenType token_type_from_text(const char* text, int length);
+ 
  /**
   * @brief Create a new token
   * 
@@ -67,9 +120,54 @@
   */
  Token* token_create(TokenType type, const char* lexeme, int line, int position);
  
+ /**
+  * @brief Create a token whose lexeme points into existing memory
+  * 
+  * The lexeme is not copied and must outlive the token.
+  * 
+  * @param type Token type
+  * @param text Start of the lexeme
+  * @param length Length of the lexeme
+  * @param line Line number
+  * @param position Position in line
+  * @return Token* New token
+  */
+ Token* token_create_view(TokenType type, const char* text, int length, int line, int position);
+ 
+ /**
+  * @brief Create a token owned by a token stream
+  * 
+  * The token lives in the stream's arena and is released together with
+  * the stream; it must not be passed to token_free.
+  * 
+  * @param stream Token stream that owns the token
+  * @param type Token type
+  * @param text Start of the lexeme
+  * @param length Length of the lexeme
+  * @param line Line number
+  * @param position Position in line
+  * @param copy True to copy the lexeme into the arena, false to reference it
+  * @return Token* New token
+  */
+ Token* token_stream_new_token(TokenStream* stream, TokenType type, const char* text, int length,
+                               int line, int position, bool copy);
+ 
+ /**
+  * @brief Hand a token back to its stream once nothing references it
+  * 
+  * In streaming mode the token is recycled for a later scan or reduce;
+  * otherwise this does nothing and the token lives until the stream is freed.
+  * 
+  * @param stream Token stream that owns the token
+  * @param token Token no longer referenced by the caller
+  */
+ void token_stream_release(TokenStream* stream, Token* token);
+ 
  /**
   * @brief Free token memory
   * 
+  * Only for tokens made by token_create or token_create_view.
+  * 
   * @param token Token to free
   */
  void token_free(Token* token);
@@ -98,6 +196,14 @@
   */
  char* token_to_string(Token* token);
  
+ /**
+  * @brief Append the string representation of a token to a builder
+  * 
+  * @param out Builder
+  * @param token Token (may be NULL)
+  */
+ void token_append_string(StrBuf* out, const Token* token);
+ 
  /**
   * @brief Initialize a token stream from an input file
   * 
@@ -107,7 +213,69 @@
  TokenStream* token_stream_create(const char* filename);
  
  /**
-  * @brief Free a token stream and all its tokens
+  * @brief Initialize a token stream with explicit mode flags
+  * 
+  * @param filename Input file name
+  * @param flags Combination of TOKEN_STREAM_* flags
+  * @return TokenStream* Initialized token stream or NULL on failure
+  */
+ TokenStream* token_stream_open(const char* filename, unsigned flags);
+ 
+ /**
+  * @brief Initialize a token stream over tokens already in memory
+  * 
+  * The buffer is scanned in place like a mapped file (TOKEN_STREAM_MMAP is
+  * implied) and must outlive the stream. Line and position numbering
+  * starts at the given values, so a slice of a file reports the same
+  * positions as the whole file.
+  * 
+  * @param data Token text (not NUL-terminated)
+  * @param size Bytes of token text
+  * @param line Line number of the first byte
+  * @param position Position in the line of the first byte
+  * @param flags Combination of TOKEN_STREAM_* flags
+  * @return TokenStream* Initialized token stream
+  */
+ TokenStream* token_stream_open_buffer(const char* data, size_t size, int line, int position,
+                                       unsigned flags);
+ 
+ /**
+  * @brief Point a stream opened by token_stream_open_buffer at other tokens
+  * 
+  * The tokens of the previous buffer are dropped and the stream starts
+  * over as if just opened with the same flags, keeping its arena blocks
+  * and struct: once the arena is as large as an input needs, scanning
+  * it allocates nothing.
+  * 
+  * @param stream Stream opened by token_stream_open_buffer
+  * @param data Token text (not NUL-terminated, must outlive the stream's use of it)
+  * @param size Bytes of token text
+  * @param line Line number of the first byte
+  * @param position Position in the line of the first byte
+  */
+ void token_stream_reset_buffer(TokenStream* stream, const char* data, size_t size, int line,
+                                int position);
+ 
+ /**
+  * @brief Map a whole file read-only (read into memory where there is no mmap)
+  * 
+  * @param filename File to map
+  * @param data Receives the contents (NULL for an empty file)
+  * @param size Receives the size in bytes
+  * @return bool False if the file cannot be opened or mapped
+  */
+ bool token_map_file(const char* filename, const char** data, size_t* size);
+ 
+ /**
+  * @brief Release a mapping made by token_map_file
+  * 
+  * @param data Contents returned by token_map_file (may be NULL)
+  * @param size Size returned by token_map_file
+  */
+ void token_unmap_file(const char* data, size_t size);
+ 
+ /**
+  * @brief Free a token stream and all its tokens (one arena release)
   * 
   * @param stream Token stream to free
   */
@@ -116,11 +284,27 @@
  /**
   * @brief Get next token from stream
   * 
+  * Returns the current token and advances. In streaming mode the returned
+  * token is detached from the stream and must eventually be released with
+  * token_stream_release.
+  * 
   * @param stream Token stream
   * @return Token* Next token or NULL if no more tokens
   */
  Token* get_next_token(TokenStream* stream);
  
+ /**
+  * @brief Append the current token and the ones already read after it
+  * 
+  * Tokens are separated by spaces; an exhausted stream renders as
+  * "End of Input".
+  * 
+  * @param out Builder
+  * @param stream Token stream (may be NULL)
+  * @param max_tokens Number of tokens shown at most
+  */
+ void token_stream_append_position(StrBuf* out, TokenStream* stream, int max_tokens);
+ 
  /**
   * @brief Check if token stream has more tokens
   * 
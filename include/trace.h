@@ -0,0 +1,133 @@
+/**
+ * @file trace.h
+ * @brief Compact binary step trace
+ *
+ * A trace file is a header followed by one fixed-size record per step.
+ * Records hold the stack change of the step instead of the whole stack,
+ * so the file grows linearly with the number of steps. tools/p3trace.c
+ * renders it as the usual text trace.
+ *
+ * Layout, all integers little-endian:
+ *
+ *     "P3TRACE\0"  magic
+ *     u32          version (TRACE_VERSION)
+ *     u32          record size (TRACE_RECORD_SIZE)
+ *     u32 + bytes  input file path
+ *     u32 + bytes  grammar file path (empty: built-in tables)
+ *     records      TRACE_RECORD_SIZE bytes each, in step order
+ */
+
+ #ifndef TRACE_H
+ #define TRACE_H
+
+ #include <stdio.h>
+ #include <stdint.h>
+ #include <stdbool.h>
+
+ #define TRACE_MAGIC "P3TRACE"
+ #define TRACE_VERSION 1
+ #define TRACE_RECORD_SIZE 20
+
+ // Bytes collected before they are written to the file
+ #define TRACE_BUFFER_SIZE (1 << 20)
+
+ /**
+  * @brief Operation of a traced step
+  */
+ typedef enum {
+     TRACE_SHIFT,    // param: target state
+     TRACE_REDUCE,   // param: production
+     TRACE_ACCEPT,   // Input accepted
+     TRACE_ERROR,    // Syntax error at the current token
+     TRACE_RECOVER   // param: skipped tokens; state, token and stack are after the recovery
+ } TraceOperation;
+
+ /**
+  * @brief One parse step
+  *
+  * Except for TRACE_RECOVER, state and token are the ones the step
+  * starts from and the stack change is applied after it.
+  */
+ typedef struct {
+     uint32_t step;        // Step number, from 1
+     uint32_t token;       // Index of the current input token, from 0
+     uint32_t popped;      // Stack entries popped
+     uint16_t state;       // Current state
+     uint16_t next_state;  // State of the entry pushed (when pushed is 1)
+     uint16_t param;       // Operation parameter, see TraceOperation
+     uint8_t operation;    // TraceOperation
+     uint8_t pushed;       // Stack entries pushed (0 or 1)
+ } TraceRecord;
+
+ /**
+  * @brief Buffered writer of a trace file
+  */
+ typedef struct {
+     FILE* file;             // Trace file
+     unsigned char* buffer;  // Pending bytes
+     size_t used;            // Bytes in buffer
+     uint32_t steps;         // Records written so far
+     bool failed;            // A write failed, the file is incomplete
+ } TraceWriter;
+
+ /**
+  * @brief Create a trace file and write its header
+  *
+  * @param path Trace file path
+  * @param input_file Input file the trace belongs to
+  * @param grammar_file Grammar file of the tables, NULL for the built-in ones
+  * @return TraceWriter* Writer or NULL if the file cannot be created
+  */
+ TraceWriter* trace_writer_open(const char* path, const char* input_file, const char* grammar_file);
+
+ /**
+  * @brief Append a record, numbering it as the next step
+  *
+  * @param writer Trace writer
+  * @param record Step to append (its step field is set by the writer)
+  */
+ void trace_writer_add(TraceWriter* writer, TraceRecord* record);
+
+ /**
+  * @brief Flush the buffer and close the file
+  *
+  * @param writer Writer to close (may be NULL)
+  * @return bool False if any write failed
+  */
+ bool trace_writer_close(TraceWriter* writer);
+
+ /**
+  * @brief Reader of a trace file
+  */
+ typedef struct {
+     FILE* file;          // Trace file
+     char* input_file;    // Input path from the header
+     char* grammar_file;  // Grammar path from the header (NULL: built-in tables)
+     bool truncated;      // The file ends inside a record
+ } TraceReader;
+
+ /**
+  * @brief Open a trace file and read its header
+  *
+  * @param path Trace file path
+  * @return TraceReader* Reader or NULL if the file is missing or not a trace
+  */
+ TraceReader* trace_reader_open(const char* path);
+
+ /**
+  * @brief Read the next record
+  *
+  * @param reader Trace reader
+  * @param record Receives the record
+  * @return bool False at the end of the file (truncated is set if a record was cut off)
+  */
+ bool trace_reader_next(TraceReader* reader, TraceRecord* record);
+
+ /**
+  * @brief Close a trace reader
+  *
+  * @param reader Reader to close (may be NULL)
+  */
+ void trace_reader_close(TraceReader* reader);
+
+ #endif /* TRACE_H */
@@ -9,6 +9,7 @@
  #include <stdio.h>
  #include <stdlib.h>
  #include <stdbool.h>
+ #include <stdint.h>
  #include "../include/parser.h"
  
  /**
@@ -36,8 +37,106 @@
   */
  void* safe_realloc(void* ptr, size_t size);
  
+ // Log levels, from the most verbose
+ #define LOG_LEVEL_DEBUG 0  // Diagnostics such as the scanner's progress
+ #define LOG_LEVEL_INFO  1  // Notable events
+ #define LOG_LEVEL_WARN  2  // Something unexpected that does not stop the run
+ #define LOG_LEVEL_ERROR 3  // Failures
+ #define LOG_LEVEL_OFF   4  // Nothing (as a threshold only)
+ 
+ // Least severe level compiled in, "make LOG_LEVEL=INFO" drops the debug
+ // messages from the build: their arguments are not even evaluated
+ #ifndef LOG_COMPILE_LEVEL
+ #define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+ #endif
+ 
+ // Errors are always compiled in, otherwise a failing run would exit
+ // without a reason; only --log-level=off silences them
+ #if LOG_COMPILE_LEVEL > LOG_LEVEL_ERROR
+ #undef LOG_COMPILE_LEVEL
+ #define LOG_COMPILE_LEVEL LOG_LEVEL_ERROR
+ #endif
+ 
+ /**
+  * @brief Destination of the log messages
+  * 
+  * Called once per message with the formatted text (no newline), from
+  * whichever thread logs it, so it must be thread-safe.
+  * 
+  * @param level LOG_LEVEL_* of the message
+  * @param message Formatted message
+  * @param context Pointer given to log_set_sink
+  */
+ typedef void (*LogSink)(int level, const char* message, void* context);
+ 
+ /**
+  * @brief Set the least severe level logged at run time (default LOG_LEVEL_INFO)
+  * 
+  * @param level LOG_LEVEL_* threshold
+  */
+ void log_set_level(int level);
+ 
+ /**
+  * @brief Least severe level logged at run time
+  * 
+  * @return int LOG_LEVEL_* threshold
+  */
+ int log_get_level(void);
+ 
+ /**
+  * @brief Parse a level name: debug, info, warn, error or off
+  * 
+  * @param name Level name
+  * @param level Receives the LOG_LEVEL_* value
+  * @return bool False if the name is not recognised
+  */
+ bool log_level_from_name(const char* name, int* level);
+ 
+ /**
+  * @brief Send the log messages somewhere else
+  * 
+  * Not synchronized, set it before other threads start logging.
+  * 
+  * @param sink Destination, NULL for the default (stderr with a level prefix)
+  * @param context Passed to every call of sink
+  */
+ void log_set_sink(LogSink sink, void* context);
+ 
+ /**
+  * @brief Sink writing "LEVEL: message" lines to the FILE* context
+  */
+ void log_file_sink(int level, const char* message, void* context);
+ 
+ /**
+  * @brief Check whether a message of this level would be logged
+  * 
+  * @param level LOG_LEVEL_* of the message
+  * @return bool True if compiled in and at or above the run-time level
+  */
+ bool log_enabled(int level);
+ 
  /**
-  * @brief Log error message to stderr
+  * @brief Format a message and pass it to the sink, use the LOG_* macros
+  * 
+  * @param level LOG_LEVEL_* of the message
+  * @param format Format string
+  * @param ... Additional arguments
+  */
+ void log_message(int level, const char* format, ...);
+ 
+ // Log at a level, nothing is formatted or evaluated when it is off
+ #define LOG_AT(level, ...) do { \
+         if ((level) >= LOG_COMPILE_LEVEL && log_enabled(level)) { \
+             log_message((level), __VA_ARGS__); \
+         } \
+     } while (0)
+ 
+ #define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+ #define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+ #define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+ 
+ /**
+  * @brief Log an error message (LOG_LEVEL_ERROR)
   * 
   * @param format Format string
   * @param ... Additional arguments
@@ -45,7 +144,9 @@
  void log_error(const char* format, ...);
  
  /**
-  * @brief Log debug message if debug mode enabled
+  * @brief Log a debug message if debug mode is enabled (LOG_LEVEL_DEBUG)
+  * 
+  * Prefer LOG_DEBUG, which skips the call when debug messages are off.
   * 
   * @param debug_mode Whether debug mode is enabled
   * @param format Format string
@@ -71,4 +172,42 @@
   */
  char* string_append(char* original, const char* append);
  
+ /**
+  * @brief Generate the debug output filename for an input file
+  * 
+  * Follows the format <input_basename>_p3dbg.txt, in the current directory.
+  * 
+  * @param input_file Input file path
+  * @return char* Output filename (must be freed by caller)
+  */
+ char* generate_output_filename(const char* input_file);
+ 
+ /**
+  * @brief Generate the binary trace filename for an input file
+  * 
+  * Follows the format <input_basename>_p3dbg.bin, in the current directory.
+  * 
+  * @param input_file Input file path
+  * @return char* Trace filename (must be freed by caller)
+  */
+ char* generate_trace_filename(const char* input_file);
+ 
+ /**
+  * @brief Heap allocations made by the calling thread
+  * 
+  * Counts every successful safe_malloc, safe_realloc and safe_strdup;
+  * the counter is per thread, so parses on different threads do not
+  * disturb each other's difference of two readings.
+  * 
+  * @return uint64_t Allocations so far
+  */
+ uint64_t allocation_count(void);
+ 
+ /**
+  * @brief Nanoseconds from a monotonic clock
+  * 
+  * @return uint64_t Current time, only differences are meaningful
+  */
+ uint64_t monotonic_ns(void);
+ 
  #endif /* UTILS_H */
\ No newline at end of file
@@ -0,0 +1,93 @@
+/**
+ * @file workers.h
+ * @brief Worker threads and per-input results shared by batch and split mode
+ */
+
+ #ifndef WORKERS_H
+ #define WORKERS_H
+
+ #include <stdio.h>
+ #include <stdbool.h>
+ #include <pthread.h>
+ #include "parser.h"
+
+ /**
+  * @brief Outcome of one parse, kept until the result lines are written
+  */
+ typedef struct {
+     bool success;   // Input accepted
+     int steps;      // Steps taken
+     int line;       // Error line
+     int position;   // Error position
+     char* message;  // Error message (NULL on success, freed by the owner of the slot)
+     bool has_value; // value is set
+     double value;   // Value computed by the reduce actions
+     int nodes;      // Syntax tree nodes (-1 when no tree is built)
+     int errors;     // Syntax errors found
+ } WorkerResult;
+
+ /**
+  * @brief One worker with its own parser
+  */
+ typedef struct WorkerThread {
+     void* shared;       // State of the run, the same for every worker
+     int index;          // Worker number, 0 is the calling thread
+     Parser* parser;     // Parser of the worker (the caller's for worker 0)
+     ParseStats* stats;  // Counters of the worker's parses (NULL when not collected)
+     pthread_t thread;
+ } WorkerThread;
+
+ /**
+  * @brief Loop of a worker, returns when no work is left
+  */
+ typedef void (*WorkerLoop)(WorkerThread* worker);
+
+ /**
+  * @brief Run a loop on a number of workers
+  *
+  * Worker 0 is the calling thread with parser, the others are threads
+  * with a parser from parser_create_worker. When every thread is joined
+  * worker 0 runs the loop once more, so work left behind by a thread
+  * that could not be started is still done. With totals set each worker
+  * collects its own counters, which are added to totals at the end.
+  *
+  * @param parser Parser of worker 0, its tables and flags are shared
+  * @param jobs Number of workers, at least 1
+  * @param name Mode named in the message when a thread cannot be started
+  * @param loop Loop run by every worker
+  * @param shared Stored in WorkerThread.shared of every worker
+  * @param totals Receives the counters of all workers (may be NULL)
+  */
+ void worker_run(Parser* parser, int jobs, const char* name, WorkerLoop loop, void* shared,
+                 ParseStats* totals);
+
+ /**
+  * @brief Move the outcome of a parse into its result slot
+  *
+  * The error message is handed to the slot and result is freed.
+  *
+  * @param slot Receives the outcome
+  * @param result Result of the parse, freed
+  * @param totals Receives the counters of the parse (may be NULL)
+  */
+ void worker_result_store(WorkerResult* slot, ParseResult* result, ParseStats* totals);
+
+ /**
+  * @brief Write the rest of a result line after the name of its input
+  *
+  *     ACCEPT steps=<n> [value=<v>] [nodes=<n>]
+  *     ERROR steps=<n> [errors=<e>] line=<l> position=<p>: <message>
+  *
+  * @param out Receives the line
+  * @param result Outcome to write
+  */
+ void worker_result_print(FILE* out, const WorkerResult* result);
+
+ /**
+  * @brief Seconds from a monotonic clock
+  *
+  * @return double Seconds since an arbitrary start
+  */
+ double worker_now_seconds(void);
+
+ #endif /* WORKERS_H */
@@ -0,0 +1,107 @@
+/**
+ * @file arena.c
+ * @brief Implementation of the bump allocator
+ * @members: Group
+ */
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/arena.h"
+ #include "../include/utils.h"
+
+ // Default block size, room for well over a thousand tokens
+ #define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+ // Alignment of every allocation
+ #define ARENA_ALIGNMENT sizeof(max_align_t)
+
+ /**
+  * Allocate a new block with at least size usable bytes
+  */
+ static ArenaBlock* arena_block_create(size_t size) {
+     ArenaBlock* block = (ArenaBlock*)safe_malloc(sizeof(ArenaBlock) + size);
+     block->next = NULL;
+     block->size = size;
+     block->used = 0;
+     return block;
+ }
+
+ /**
+  * Create an arena
+  */
+ Arena* arena_create(size_t block_size) {
+     Arena* arena = (Arena*)safe_malloc(sizeof(Arena));
+     arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+     arena->first = arena_block_create(arena->block_size);
+     arena->current = arena->first;
+     return arena;
+ }
+
+ /**
+  * Free an arena and all of its blocks
+  */
+ void arena_free(Arena* arena) {
+     if (!arena) {
+         return;
+     }
+
+     ArenaBlock* block = arena->first;
+     while (block) {
+         ArenaBlock* next = block->next;
+         free(block);
+         block = next;
+     }
+
+     free(arena);
+ }
+
+ /**
+  * Reset the arena, blocks after the first are emptied lazily
+  */
+ void arena_reset(Arena* arena) {
+     if (!arena) {
+         return;
+     }
+
+     arena->current = arena->first;
+     arena->first->used = 0;
+ }
+
+ /**
+  * Allocate from the current block, moving to the next one when full
+  */
+ void* arena_alloc(Arena* arena, size_t size) {
+     size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+     ArenaBlock* block = arena->current;
+     while (block->used + size > block->size) {
+         if (!block->next) {
+             // Oversized requests get a block of their own
+             size_t block_size = size > arena->block_size ? size : arena->block_size;
+             block->next = arena_block_create(block_size);
+         } else if (block->next->size < size) {
+             // Recycled block too small for this request, insert a new one
+             ArenaBlock* inserted = arena_block_create(size);
+             inserted->next = block->next;
+             block->next = inserted;
+         }
+
+         block = block->next;
+         block->used = 0;
+     }
+
+     arena->current = block;
+     void* memory = (char*)block->data + block->used;
+     block->used += size;
+     return memory;
+ }
+
+ /**
+  * Copy a string into the arena
+  */
+ char* arena_strndup(Arena* arena, const char* text, size_t length) {
+     char* copy = (char*)arena_alloc(arena, length + 1);
+     memcpy(copy, text, length);
+     copy[length] = '\0';
+     return copy;
+ }
@@ -0,0 +1,214 @@
+/**
+ * @file ast.c
+ * @brief Syntax tree construction in a flat node pool
+ * @members: Group
+ *
+ * Leaves are added when a token is shifted and inner nodes when a
+ * production is reduced, so the tree is complete when the input is
+ * accepted. The node of every stack entry is kept in its semantic value;
+ * a reduction links the nodes of its right-hand side as the children of
+ * the new node. Nodes refer to each other by index, so the pools can grow
+ * with realloc and the finished tree is copied into one block.
+ */
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/ast.h"
+ #include "../include/utils.h"
+
+ // Initial pool sizes of a new builder
+ #define AST_INITIAL_NODES 256
+ #define AST_INITIAL_TEXT 1024
+
+ /**
+  * Create an empty builder
+  */
+ AstBuilder* ast_builder_create(void) {
+     AstBuilder* builder = (AstBuilder*)safe_malloc(sizeof(AstBuilder));
+     builder->node_capacity = AST_INITIAL_NODES;
+     builder->nodes = (AstNode*)safe_malloc(sizeof(AstNode) * builder->node_capacity);
+     builder->num_nodes = 0;
+     builder->text_capacity = AST_INITIAL_TEXT;
+     builder->text = (char*)safe_malloc(builder->text_capacity);
+     builder->text_size = 0;
+     return builder;
+ }
+
+ /**
+  * Free a builder and its pools
+  */
+ void ast_builder_free(AstBuilder* builder) {
+     if (!builder) {
+         return;
+     }
+     free(builder->nodes);
+     free(builder->text);
+     free(builder);
+ }
+
+ /**
+  * Forget all nodes, keeping the pools
+  */
+ void ast_builder_clear(AstBuilder* builder) {
+     builder->num_nodes = 0;
+     builder->text_size = 0;
+ }
+
+ /**
+  * Take the next node of the pool, growing it when full
+  */
+ static uint32_t new_node(AstBuilder* builder) {
+     if (builder->num_nodes == builder->node_capacity) {
+         if (builder->node_capacity >= AST_NONE / 2) {
+             log_error("Syntax tree too large");
+             exit(EXIT_FAILURE);
+         }
+         builder->node_capacity *= 2;
+         builder->nodes = (AstNode*)safe_realloc(builder->nodes, sizeof(AstNode) * builder->node_capacity);
+     }
+     return builder->num_nodes++;
+ }
+
+ /**
+  * Add a leaf for a shifted token
+  */
+ uint32_t ast_builder_leaf(AstBuilder* builder, const Token* token) {
+     // The token may be recycled before the parse ends, keep a copy
+     uint32_t length = token->length > 0 ? (uint32_t)token->length : 0;
+     if ((size_t)builder->text_size + length + 1 > builder->text_capacity) {
+         size_t capacity = builder->text_capacity;
+         while (capacity < (size_t)builder->text_size + length + 1) {
+             capacity *= 2;
+         }
+         if (capacity > UINT32_MAX) {
+             log_error("Syntax tree too large");
+             exit(EXIT_FAILURE);
+         }
+         builder->text_capacity = (uint32_t)capacity;
+         builder->text = (char*)safe_realloc(builder->text, builder->text_capacity);
+     }
+     uint32_t offset = builder->text_size;
+     memcpy(builder->text + offset, token->lexeme, length);
+     builder->text[offset + length] = '\0';
+     builder->text_size += length + 1;
+
+     uint32_t index = new_node(builder);
+     AstNode* node = &builder->nodes[index];
+     node->symbol = (uint16_t)token->type;
+     node->production = 0;
+     node->first_child = AST_NONE;
+     node->next_sibling = AST_NONE;
+     node->lexeme = offset;
+     node->length = length;
+     node->line = token->line_number;
+     node->position = token->position;
+     return index;
+ }
+
+ /**
+  * Add the node of a reduction, its children are on the stack
+  */
+ uint32_t ast_builder_node(AstBuilder* builder, int lhs, int production,
+                           Stack* stack, int base, int count) {
+     uint32_t index = new_node(builder);
+
+     // Chain the right-hand side in order, each child is a subtree root
+     // so its sibling link is still free
+     uint32_t first = AST_NONE;
+     uint32_t previous = AST_NONE;
+     for (int i = base; i < base + count; i++) {
+         uint32_t child = stack_value_at(stack, i).node;
+         if (previous == AST_NONE) {
+             first = child;
+         } else {
+             builder->nodes[previous].next_sibling = child;
+         }
+         previous = child;
+     }
+
+     AstNode* node = &builder->nodes[index];
+     node->symbol = (uint16_t)lhs;
+     node->production = (uint16_t)production;
+     node->first_child = first;
+     node->next_sibling = AST_NONE;
+     node->lexeme = 0;
+     node->length = 0;
+     node->line = 0;
+     node->position = 0;
+     return index;
+ }
+
+ /**
+  * Copy the pools into one block
+  */
+ Ast* ast_builder_finish(const AstBuilder* builder, uint32_t root) {
+     size_t nodes_size = sizeof(AstNode) * builder->num_nodes;
+     char* block = (char*)safe_malloc(sizeof(Ast) + nodes_size + builder->text_size);
+
+     AstNode* nodes = (AstNode*)(block + sizeof(Ast));
+     char* text = block + sizeof(Ast) + nodes_size;
+     memcpy(nodes, builder->nodes, nodes_size);
+     memcpy(text, builder->text, builder->text_size);
+
+     Ast* ast = (Ast*)block;
+     ast->nodes = nodes;
+     ast->num_nodes = builder->num_nodes;
+     ast->root = root;
+     ast->text = text;
+     ast->text_size = builder->text_size;
+     return ast;
+ }
+
+ /**
+  * Free a tree
+  */
+ void ast_free(Ast* ast) {
+     free(ast);
+ }
+
+ /**
+  * Print a tree in preorder
+  */
+ void ast_print(const Ast* ast, const char* const* non_terminal_names, FILE* out) {
+     if (!ast || ast->root == AST_NONE) {
+         return;
+     }
+
+     // Explicit stack, left-recursive rules make trees as deep as the input
+     typedef struct {
+         uint32_t node;
+         int depth;
+     } Pending;
+     int capacity = 64;
+     int count = 0;
+     Pending* pending = (Pending*)safe_malloc(sizeof(Pending) * capacity);
+     pending[count++] = (Pending){ ast->root, 0 };
+
+     while (count > 0) {
+         Pending item = pending[--count];
+         const AstNode* node = &ast->nodes[item.node];
+
+         fprintf(out, "%*s", item.depth * 2, "");
+         if (node->production == 0) {
+             fprintf(out, "<%s, \"%s\", %d, %d>\n", token_type_to_string((TokenType)node->symbol),
+                     ast->text + node->lexeme, node->line, node->position);
+         } else {
+             const char* name = non_terminal_names ? non_terminal_names[node->symbol]
+                                                   : get_non_terminal_name(node->symbol);
+             fprintf(out, "%s (rule %d)\n", name, node->production);
+         }
+
+         // Sibling below the first child, so the whole subtree comes first
+         if (count + 2 > capacity) {
+             capacity *= 2;
+             pending = (Pending*)safe_realloc(pending, sizeof(Pending) * capacity);
+         }
+         if (item.node != ast->root && node->next_sibling != AST_NONE) {
+             pending[count++] = (Pending){ node->next_sibling, item.depth };
+         }
+         if (node->first_child != AST_NONE) {
+             pending[count++] = (Pending){ node->first_child, item.depth + 1 };
+         }
+     }
+     free(pending);
+ }
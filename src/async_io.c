@@ -0,0 +1,330 @@
+/**
+ * @file async_io.c
+ * @brief Background threads for reading the input and writing the trace
+ * @members: Group
+ *
+ * Each side owns one index of the ring: it reads the other side's index
+ * with acquire semantics and publishes its own after copying. A side
+ * that finds the ring empty (or full) sets its bit in waiting and sleeps
+ * after checking again under the lock; the other side reads waiting
+ * after publishing and only then takes the lock to wake it. Both steps
+ * are sequentially consistent, so one of them always sees the other.
+ */
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/async_io.h"
+ #include "../include/utils.h"
+
+ // Bits of ByteRing.waiting
+ #define ASYNC_WAIT_DATA  0x1  // The consumer sleeps until there is data or the producer is done
+ #define ASYNC_WAIT_SPACE 0x2  // The producer sleeps until there is room or the consumer is done
+
+ // Forward declarations
+ static void ring_init(ByteRing* ring, size_t capacity, size_t data_batch, size_t space_batch);
+ static void ring_destroy(ByteRing* ring);
+ static bool ring_ready(ByteRing* ring, int side);
+ static void ring_wait(ByteRing* ring, int side);
+ static void ring_notify(ByteRing* ring, int side);
+ static void ring_wake_all(ByteRing* ring);
+ static void* reader_main(void* arg);
+ static void* writer_main(void* arg);
+
+ /**
+  * Start reading a file ahead in the background
+  */
+ AsyncReader* async_reader_open(FILE* file) {
+     AsyncReader* reader = (AsyncReader*)safe_malloc(sizeof(AsyncReader));
+     ring_init(&reader->ring, 2 * ASYNC_READ_CHUNK, 1, ASYNC_READ_CHUNK);
+     reader->file = file;
+     atomic_init(&reader->failed, false);
+
+     if (pthread_create(&reader->thread, NULL, reader_main, reader) != 0) {
+         ring_destroy(&reader->ring);
+         free(reader);
+         return NULL;
+     }
+     return reader;
+ }
+
+ /**
+  * Read a line like fgets
+  */
+ char* async_reader_gets(AsyncReader* reader, char* buffer, int size) {
+     ByteRing* ring = &reader->ring;
+     size_t length = 0;
+
+     while (length + 1 < (size_t)size) {
+         size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+         size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+         if (head == tail) {
+             if (!atomic_load(&ring->closed)) {
+                 ring_wait(ring, ASYNC_WAIT_DATA);
+                 continue;
+             }
+             // Closed after its last bytes were published
+             if (atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+                 break;
+             }
+             continue;
+         }
+
+         // Up to the newline, the end of the data or the wrap of the ring
+         size_t offset = tail & (ring->capacity - 1);
+         size_t count = head - tail;
+         if (count > ring->capacity - offset) {
+             count = ring->capacity - offset;
+         }
+         if (count > (size_t)size - 1 - length) {
+             count = (size_t)size - 1 - length;
+         }
+         const char* start = ring->data + offset;
+         const char* newline = (const char*)memchr(start, '\n', count);
+         if (newline) {
+             count = (size_t)(newline - start) + 1;
+         }
+
+         memcpy(buffer + length, start, count);
+         length += count;
+         atomic_store(&ring->tail, tail + count);
+         ring_notify(ring, ASYNC_WAIT_SPACE);
+         if (newline) {
+             break;
+         }
+     }
+
+     if (length == 0) {
+         return NULL;
+     }
+     buffer[length] = '\0';
+     return buffer;
+ }
+
+ /**
+  * Check whether the input ended with a read error
+  */
+ bool async_reader_failed(AsyncReader* reader) {
+     return atomic_load(&reader->failed);
+ }
+
+ /**
+  * Stop the thread and free the reader
+  */
+ void async_reader_close(AsyncReader* reader) {
+     if (!reader) {
+         return;
+     }
+     atomic_store(&reader->ring.stop, true);
+     ring_wake_all(&reader->ring);
+     pthread_join(reader->thread, NULL);
+     ring_destroy(&reader->ring);
+     free(reader);
+ }
+
+ /**
+  * Start writing a file in the background
+  */
+ AsyncWriter* async_writer_open(FILE* file) {
+     AsyncWriter* writer = (AsyncWriter*)safe_malloc(sizeof(AsyncWriter));
+     ring_init(&writer->ring, ASYNC_WRITE_RING, ASYNC_WRITE_BATCH, 1);
+     writer->file = file;
+     atomic_init(&writer->failed, false);
+
+     if (pthread_create(&writer->thread, NULL, writer_main, writer) != 0) {
+         ring_destroy(&writer->ring);
+         free(writer);
+         return NULL;
+     }
+     return writer;
+ }
+
+ /**
+  * Queue bytes for the file
+  */
+ void async_writer_write(AsyncWriter* writer, const void* data, size_t length) {
+     ByteRing* ring = &writer->ring;
+     const char* bytes = (const char*)data;
+
+     while (length > 0) {
+         size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+         size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+         size_t room = ring->capacity - (head - tail);
+         if (room == 0) {
+             ring_wait(ring, ASYNC_WAIT_SPACE);
+             continue;
+         }
+
+         size_t offset = head & (ring->capacity - 1);
+         size_t count = length < room ? length : room;
+         if (count > ring->capacity - offset) {
+             count = ring->capacity - offset;
+         }
+         memcpy(ring->data + offset, bytes, count);
+         atomic_store(&ring->head, head + count);
+         ring_notify(ring, ASYNC_WAIT_DATA);
+         bytes += count;
+         length -= count;
+     }
+ }
+
+ /**
+  * Write out everything queued, stop the thread and free the writer
+  */
+ bool async_writer_close(AsyncWriter* writer) {
+     atomic_store(&writer->ring.closed, true);
+     ring_wake_all(&writer->ring);
+     pthread_join(writer->thread, NULL);
+
+     bool ok = !atomic_load(&writer->failed);
+     ring_destroy(&writer->ring);
+     free(writer);
+     return ok;
+ }
+
+ /* Internal function implementations */
+
+ /**
+  * Empty ring of capacity bytes (a power of two)
+  */
+ static void ring_init(ByteRing* ring, size_t capacity, size_t data_batch, size_t space_batch) {
+     ring->data = (char*)safe_malloc(capacity);
+     ring->capacity = capacity;
+     ring->data_batch = data_batch;
+     ring->space_batch = space_batch;
+     atomic_init(&ring->head, 0);
+     atomic_init(&ring->tail, 0);
+     atomic_init(&ring->closed, false);
+     atomic_init(&ring->stop, false);
+     atomic_init(&ring->waiting, 0);
+     pthread_mutex_init(&ring->lock, NULL);
+     pthread_cond_init(&ring->wake, NULL);
+ }
+
+ /**
+  * Free a ring nobody uses any more
+  */
+ static void ring_destroy(ByteRing* ring) {
+     pthread_cond_destroy(&ring->wake);
+     pthread_mutex_destroy(&ring->lock);
+     free(ring->data);
+ }
+
+ /**
+  * Whether a side waiting for data or room can go on
+  */
+ static bool ring_ready(ByteRing* ring, int side) {
+     size_t used = atomic_load(&ring->head) - atomic_load(&ring->tail);
+     if (side == ASYNC_WAIT_DATA) {
+         return used >= ring->data_batch || atomic_load(&ring->closed);
+     }
+     return ring->capacity - used >= ring->space_batch || atomic_load(&ring->stop);
+ }
+
+ /**
+  * Sleep until the other side makes the ring ready for this one
+  */
+ static void ring_wait(ByteRing* ring, int side) {
+     pthread_mutex_lock(&ring->lock);
+     atomic_fetch_or(&ring->waiting, side);
+     while (!ring_ready(ring, side)) {
+         pthread_cond_wait(&ring->wake, &ring->lock);
+     }
+     atomic_fetch_and(&ring->waiting, ~side);
+     pthread_mutex_unlock(&ring->lock);
+ }
+
+ /**
+  * Wake the other side if it sleeps and can go on, called after publishing an index
+  */
+ static void ring_notify(ByteRing* ring, int side) {
+     if ((atomic_load(&ring->waiting) & side) && ring_ready(ring, side)) {
+         ring_wake_all(ring);
+     }
+ }
+
+ /**
+  * Wake whoever sleeps on the ring
+  */
+ static void ring_wake_all(ByteRing* ring) {
+     pthread_mutex_lock(&ring->lock);
+     pthread_cond_broadcast(&ring->wake);
+     pthread_mutex_unlock(&ring->lock);
+ }
+
+ /**
+  * Reader thread: fill the free half of the ring a chunk at a time
+  */
+ static void* reader_main(void* arg) {
+     AsyncReader* reader = (AsyncReader*)arg;
+     ByteRing* ring = &reader->ring;
+
+     while (!atomic_load(&ring->stop)) {
+         size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+         size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+         size_t room = ring->capacity - (head - tail);
+         if (room < ASYNC_READ_CHUNK) {
+             ring_wait(ring, ASYNC_WAIT_SPACE);
+             continue;
+         }
+
+         // Reads are whole chunks until the end, so they never wrap
+         size_t offset = head & (ring->capacity - 1);
+         size_t count = ASYNC_READ_CHUNK;
+         size_t read = fread(ring->data + offset, 1, count, reader->file);
+         if (read > 0) {
+             atomic_store(&ring->head, head + read);
+             ring_notify(ring, ASYNC_WAIT_DATA);
+         }
+         if (read < count) {
+             atomic_store(&reader->failed, ferror(reader->file) != 0);
+             break;
+         }
+     }
+
+     atomic_store(&ring->closed, true);
+     ring_wake_all(ring);
+     return NULL;
+ }
+
+ /**
+  * Writer thread: write out whatever is queued until closed and drained
+  */
+ static void* writer_main(void* arg) {
+     AsyncWriter* writer = (AsyncWriter*)arg;
+     ByteRing* ring = &writer->ring;
+
+     for (;;) {
+         size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+         size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+         if (head == tail) {
+             if (!atomic_load(&ring->closed)) {
+                 ring_wait(ring, ASYNC_WAIT_DATA);
+                 continue;
+             }
+             if (atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+                 break;
+             }
+             continue;
+         }
+
+         size_t offset = tail & (ring->capacity - 1);
+         size_t count = head - tail;
+         if (count > ring->capacity - offset) {
+             count = ring->capacity - offset;
+         }
+         // After a failure keep draining so the parser never blocks
+         if (!atomic_load_explicit(&writer->failed, memory_order_relaxed) &&
+             fwrite(ring->data + offset, 1, count, writer->file) != count) {
+             atomic_store(&writer->failed, true);
+         }
+         atomic_store(&ring->tail, tail + count);
+         ring_notify(ring, ASYNC_WAIT_SPACE);
+     }
+
+     if (fflush(writer->file) != 0) {
+         atomic_store(&writer->failed, true);
+     }
+     return NULL;
+ }
@@ -10,14 +10,6 @@
  #include "../include/automaton.h"
  #include "../include/utils.h"
  
- // Constants for coding action values
- #define ACTION_SHIFT_BIT  0x10000
- #define ACTION_REDUCE_BIT 0x20000
- #define ACTION_ACCEPT_BIT 0x30000
- #define ACTION_ERROR_BIT  0x40000
- #define ACTION_MASK       0xF0000
- #define VALUE_MASK        0x0FFFF
- 
  // Non-terminal symbols
  #define NON_TERMINAL_S 0
  #define NON_TERMINAL_E 1
@@ -25,7 +17,9 @@
  #define NON_TERMINAL_F 3
  
  // Number of symbols and states
- #define NUM_TERMINALS      6  // NUM, PLUS, STAR, LPAREN, RPAREN, EOF
+ // NUM, PLUS, STAR, LPAREN, RPAREN, EOF plus always-error columns for
+ // INVALID and NON_TERMINAL, so the parse loop can index without checks
+ #define NUM_TERMINALS      (TOKEN_NON_TERMINAL + 1)
  #define NUM_NON_TERMINALS  4  // S, E, T, F
  #define NUM_STATES         12 // States 0-10
  #define NUM_PRODUCTIONS    7  // Productions 1-7
@@ -56,8 +50,12 @@
      {NON_TERMINAL_F, (int[]){TOKEN_NUM}, 1, "f → NUM"}
  };
  
+ // Flat table accessors used while building the tables
+ #define ACTION(state, token) actions[(state) * NUM_TERMINALS + (token)]
+ #define GOTO(state, nt)      gotos[(state) * NUM_NON_TERMINALS + (nt)]
+ 
  // Forward declarations
- static void init_parsing_tables(ParsingTables* tables);
+ static void init_parsing_tables(uint16_t* actions, int16_t* gotos);
  static void setup_productions(ParsingTables* tables);
  
  /**
@@ -70,37 +68,33 @@
      tables->num_states = NUM_STATES;
      tables->num_terminals = NUM_TERMINALS;
      tables->num_non_terminals = NUM_NON_TERMINALS;
+     tables->non_terminal_names = NULL;
      tables->num_productions = NUM_PRODUCTIONS;
+     tables->is_static = false;
+     tables->cache_map = NULL;
+     tables->cache_size = 0;
      
-     // Allocate action table
-     tables->action_table = (int**)safe_malloc(sizeof(int*) * NUM_STATES);
+     // Allocate both tables as single contiguous arrays
+     uint16_t* actions = (uint16_t*)safe_malloc(sizeof(uint16_t) * NUM_STATES * NUM_TERMINALS);
+     int16_t* gotos = (int16_t*)safe_malloc(sizeof(int16_t) * NUM_STATES * NUM_NON_TERMINALS);
      
-     for (int i = 0; i < NUM_STATES; i++) {
-         tables->action_table[i] = (int*)safe_malloc(sizeof(int) * NUM_TERMINALS);
-         // Initialize with error actions
-         for (int j = 0; j < NUM_TERMINALS; j++) {
-             tables->action_table[i][j] = automaton_create_action(ACTION_ERROR, 0);
-         }
+     // Initialize with error actions and -1 (error) gotos
+     for (int i = 0; i < NUM_STATES * NUM_TERMINALS; i++) {
+         actions[i] = (uint16_t)automaton_create_action(ACTION_ERROR, 0);
      }
-     
-     // Allocate goto table
-     tables->goto_table = (int**)safe_malloc(sizeof(int*) * NUM_STATES);
-     for (int i = 0; i < NUM_STATES; i++) {
-         tables->goto_table[i] = (int*)safe_malloc(sizeof(int) * NUM_NON_TERMINALS);
-         // Initialize with -1 (error)
-         for (int j = 0; j < NUM_NON_TERMINALS; j++) {
-             tables->goto_table[i][j] = -1;
-         }
+     for (int i = 0; i < NUM_STATES * NUM_NON_TERMINALS; i++) {
+         gotos[i] = -1;
      }
      
      // Setup productions
      setup_productions(tables);
      
-     
      // Initialize parsing tables based on the automaton
-     init_parsing_tables(tables);
-
+     init_parsing_tables(actions, gotos);
      
+     tables->action_table = actions;
+     tables->goto_table = gotos;
+     automaton_build_expected(tables);
 
      return tables;
  }
@@ -109,75 +103,192 @@
   * Get action type from action value
   */
  ActionType automaton_get_action_type(int action) {
-     int type_bits = action & ACTION_MASK;
-     
-     switch (type_bits) {
-         case ACTION_SHIFT_BIT:
-             return ACTION_SHIFT;
-         case ACTION_REDUCE_BIT:
-             return ACTION_REDUCE;
-         case ACTION_ACCEPT_BIT:
-             return ACTION_ACCEPT;
-         default:
-             return ACTION_ERROR;
-     }
+     return action_type_of(action);
  }
  
  /**
   * Get action value (state or production number)
   */
  int automaton_get_action_value(int action) {
-     return action & VALUE_MASK;
+     return action_value_of(action);
  }
  
  /**
   * Create an action value for parsing table
   */
  int automaton_create_action(ActionType type, int value) {
-     int action = 0;
-     
      switch (type) {
          case ACTION_SHIFT:
-             action = ACTION_SHIFT_BIT | (value & VALUE_MASK);
-             break;
          case ACTION_REDUCE:
-             action = ACTION_REDUCE_BIT | (value & VALUE_MASK);
-             break;
+             // Masking would turn it into another state or production
+             if (value < 0 || value > ACTION_VALUE_MAX) {
+                 log_error("Action value %d out of range, at most %d fits in a table entry",
+                           value, ACTION_VALUE_MAX);
+                 return ACTION_ERROR;
+             }
+             return (value << ACTION_TYPE_BITS) | type;
          case ACTION_ACCEPT:
-             action = ACTION_ACCEPT_BIT;
-             break;
+             return ACTION_ACCEPT;
          case ACTION_ERROR:
          default:
-             action = ACTION_ERROR_BIT;
-             break;
+             return ACTION_ERROR;
      }
-     
-     return action;
  }
  
  /**
   * Convert action value to string representation for debugging
   */
- char* automaton_action_to_string(int action_value, ParsingTables* tables) {
+ char* automaton_action_to_string(int action_value, const ParsingTables* tables) {
+     StrBuf out;
+     strbuf_init(&out);
+     automaton_append_action(&out, action_value, tables);
+     return strbuf_detach(&out);
+ }
+ 
+ /**
+  * Append the string representation of an action
+  */
+ void automaton_append_action(StrBuf* out, int action_value, const ParsingTables* tables) {
      ActionType type = automaton_get_action_type(action_value);
      int value = automaton_get_action_value(action_value);
      
      switch (type) {
          case ACTION_SHIFT:
-             return string_format("Shift to state %d", value);
+             strbuf_append_str(out, "Shift to state ");
+             strbuf_append_int(out, value);
+             break;
          case ACTION_REDUCE:
              if (value >= 1 && value <= tables->num_productions) {
-                 return string_format("Reduce by rule %d: %s", 
-                                     value, 
-                                     tables->productions[value].rule_string);
+                 strbuf_append_str(out, "Reduce by rule ");
+                 strbuf_append_int(out, value);
+                 strbuf_append(out, ": ", 2);
+                 strbuf_append_str(out, tables->productions[value].rule_string);
+             } else {
+                 strbuf_append_str(out, "Reduce by unknown rule ");
+                 strbuf_append_int(out, value);
              }
-             return string_format("Reduce by unknown rule %d", value);
+             break;
          case ACTION_ACCEPT:
-             return safe_strdup("Accept");
+             strbuf_append_str(out, "Accept");
+             break;
          case ACTION_ERROR:
          default:
-             return safe_strdup("Error");
+             strbuf_append_str(out, "Error");
+             break;
+     }
+ }
+ 
+ /**
+  * Check whether two sets of tables have the same productions
+  */
+ bool automaton_same_productions(const ParsingTables* tables, const ParsingTables* reference) {
+     if (tables->num_productions != reference->num_productions) {
+         return false;
+     }
+     
+     // Production 0 is the accepting rule or a placeholder, it is never reduced
+     for (int i = 1; i <= tables->num_productions; i++) {
+         const Production* production = &tables->productions[i];
+         const Production* expected = &reference->productions[i];
+         if (production->lhs != expected->lhs || production->rhs_length != expected->rhs_length) {
+             return false;
+         }
+         for (int j = 0; j < production->rhs_length; j++) {
+             if (production->rhs[j] != expected->rhs[j]) {
+                 return false;
+             }
+         }
+     }
+     return true;
+ }
+ 
+ /**
+  * Fill the expected-token masks and messages of every state
+  */
+ void automaton_build_expected(ParsingTables* tables) {
+     uint32_t* expected = (uint32_t*)safe_malloc(sizeof(uint32_t) * tables->num_states);
+     const char** messages = (const char**)safe_malloc(sizeof(char*) * tables->num_states);
+     StrBuf text;
+     strbuf_init(&text);
+     
+     for (int state = 0; state < tables->num_states; state++) {
+         // INVALID and NON_TERMINAL are never valid, their columns are all errors
+         uint32_t mask = 0;
+         int count = 0;
+         for (int token = 0; token < tables->num_terminals && token < 32; token++) {
+             if (action_type_of(tables_action(tables, state, (TokenType)token)) != ACTION_ERROR) {
+                 mask |= 1u << token;
+                 count++;
+             }
+         }
+         expected[state] = mask;
+         
+         strbuf_clear(&text);
+         strbuf_append_str(&text, count == 0 ? "no token expected"
+                                  : count == 1 ? "expected " : "expected one of ");
+         for (int token = 0, listed = 0; token < 32; token++) {
+             if (mask & (1u << token)) {
+                 if (listed++ > 0) {
+                     strbuf_append(&text, ", ", 2);
+                 }
+                 strbuf_append_str(&text, token_type_to_string((TokenType)token));
+             }
+         }
+         messages[state] = safe_strdup(text.data);
+     }
+     
+     strbuf_free(&text);
+     tables->expected = expected;
+     tables->expected_messages = messages;
+ }
+ 
+ /**
+  * Free parsing tables resources
+  */
+ void free_parsing_tables(const ParsingTables* tables) {
+     if (!tables || tables->is_static) {
+         return;
      }
+     
+     // Loaded from a cache, only the pointer arrays are not part of the mapping
+     if (tables->cache_map) {
+         free((Production*)tables->productions);
+         free((char**)tables->non_terminal_names);
+         free((char**)tables->expected_messages);
+         token_unmap_file(tables->cache_map, tables->cache_size);
+         free((ParsingTables*)tables);
+         return;
+     }
+     
+     // Free action and goto tables
+     free((uint16_t*)tables->action_table);
+     free((int16_t*)tables->goto_table);
+     
+     // Free the expected-token sets
+     if (tables->expected_messages) {
+         for (int i = 0; i < tables->num_states; i++) {
+             free((char*)tables->expected_messages[i]);
+         }
+         free((char**)tables->expected_messages);
+     }
+     free((uint32_t*)tables->expected);
+     
+     // Free productions
+     for (int i = 0; i <= tables->num_productions; i++) {
+         free((int*)tables->productions[i].rhs);
+         free((char*)tables->productions[i].rule_string);
+     }
+     free((Production*)tables->productions);
+     
+     // Free non-terminal names of generated tables
+     if (tables->non_terminal_names) {
+         for (int i = 0; i < tables->num_non_terminals; i++) {
+             free((char*)tables->non_terminal_names[i]);
+         }
+         free((char**)tables->non_terminal_names);
+     }
+     
+     free((ParsingTables*)tables);
  }
  
  /* Internal function implementations */
@@ -187,100 +298,102 @@
   */
  static void setup_productions(ParsingTables* tables) {
      // Allocate memory for productions
-     tables->productions = (Production*)safe_malloc(sizeof(Production) * (NUM_PRODUCTIONS + 1));
+     Production* productions = (Production*)safe_malloc(sizeof(Production) * (NUM_PRODUCTIONS + 1));
      
      // Copy production rules
      for (int i = 0; i <= NUM_PRODUCTIONS; i++) {
-         tables->productions[i].lhs = grammar_productions[i].lhs;
-         tables->productions[i].rhs_length = grammar_productions[i].rhs_length;
+         productions[i].lhs = grammar_productions[i].lhs;
+         productions[i].rhs_length = grammar_productions[i].rhs_length;
          
          if (grammar_productions[i].rhs_length > 0) {
-             tables->productions[i].rhs = (int*)safe_malloc(sizeof(int) * grammar_productions[i].rhs_length);
-             memcpy(tables->productions[i].rhs, grammar_productions[i].rhs, 
-                   sizeof(int) * grammar_productions[i].rhs_length);
+             int* rhs = (int*)safe_malloc(sizeof(int) * grammar_productions[i].rhs_length);
+             memcpy(rhs, grammar_productions[i].rhs, sizeof(int) * grammar_productions[i].rhs_length);
+             productions[i].rhs = rhs;
          } else {
-             tables->productions[i].rhs = NULL;
+             productions[i].rhs = NULL;
          }
          
-         tables->productions[i].rule_string = safe_strdup(grammar_productions[i].rule_string ? 
-                                                         grammar_productions[i].rule_string : "");
+         productions[i].rule_string = safe_strdup(grammar_productions[i].rule_string ? 
+                                                  grammar_productions[i].rule_string : "");
      }
+     
+     tables->productions = productions;
  }
  
  /**
   * Initialize parsing tables with shift/reduce automaton
   */
- static void init_parsing_tables(ParsingTables* tables) {
+ static void init_parsing_tables(uint16_t* actions, int16_t* gotos) {
      // LR(0) parsing table for the grammar
      // This is a hardcoded version of the table based on the automaton in the design doc
      
      // State 0
-     tables->goto_table[0][NON_TERMINAL_E] = 1;     // goto(0,E) = 1
-     tables->goto_table[0][NON_TERMINAL_T] = 2;     // goto(0,T) = 2
-     tables->goto_table[0][NON_TERMINAL_F] = 3;     // goto(0,F) = 3
-     tables->action_table[0][TOKEN_NUM] = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
-     tables->action_table[0][TOKEN_LPAREN] = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
+     GOTO(0, NON_TERMINAL_E) = 1;     // goto(0,E) = 1
+     GOTO(0, NON_TERMINAL_T) = 2;     // goto(0,T) = 2
+     GOTO(0, NON_TERMINAL_F) = 3;     // goto(0,F) = 3
+     ACTION(0, TOKEN_NUM) = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
+     ACTION(0, TOKEN_LPAREN) = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
      
      // State 1
-     tables->action_table[1][TOKEN_PLUS] = automaton_create_action(ACTION_SHIFT, 6);     // shift to state 6
-     tables->action_table[1][TOKEN_EOF] = automaton_create_action(ACTION_ACCEPT, 0);     // accept input
+     ACTION(1, TOKEN_PLUS) = automaton_create_action(ACTION_SHIFT, 6);     // shift to state 6
+     ACTION(1, TOKEN_EOF) = automaton_create_action(ACTION_ACCEPT, 0);     // accept input
      
      // State 2
-     tables->action_table[2][TOKEN_STAR] = automaton_create_action(ACTION_SHIFT, 7);     // shift to state 7
-     tables->action_table[2][TOKEN_PLUS] = automaton_create_action(ACTION_REDUCE, 3);    // reduce using rule 3
-     tables->action_table[2][TOKEN_RPAREN] = automaton_create_action(ACTION_REDUCE, 3);  // reduce using rule 3
-     tables->action_table[2][TOKEN_EOF] = automaton_create_action(ACTION_REDUCE, 3);     // reduce using rule 3
+     ACTION(2, TOKEN_STAR) = automaton_create_action(ACTION_SHIFT, 7);     // shift to state 7
+     ACTION(2, TOKEN_PLUS) = automaton_create_action(ACTION_REDUCE, 3);    // reduce using rule 3
+     ACTION(2, TOKEN_RPAREN) = automaton_create_action(ACTION_REDUCE, 3);  // reduce using rule 3
+     ACTION(2, TOKEN_EOF) = automaton_create_action(ACTION_REDUCE, 3);     // reduce using rule 3
      
      // State 3
-     tables->action_table[3][TOKEN_PLUS] = automaton_create_action(ACTION_REDUCE, 5);    // reduce using rule 5
-     tables->action_table[3][TOKEN_STAR] = automaton_create_action(ACTION_REDUCE, 5);    // reduce using rule 5
-     tables->action_table[3][TOKEN_RPAREN] = automaton_create_action(ACTION_REDUCE, 5);  // reduce using rule 5
-     tables->action_table[3][TOKEN_EOF] = automaton_create_action(ACTION_REDUCE, 5);     // reduce using rule 5
+     ACTION(3, TOKEN_PLUS) = automaton_create_action(ACTION_REDUCE, 5);    // reduce using rule 5
+     ACTION(3, TOKEN_STAR) = automaton_create_action(ACTION_REDUCE, 5);    // reduce using rule 5
+     ACTION(3, TOKEN_RPAREN) = automaton_create_action(ACTION_REDUCE, 5);  // reduce using rule 5
+     ACTION(3, TOKEN_EOF) = automaton_create_action(ACTION_REDUCE, 5);     // reduce using rule 5
      
      // State 4
-     tables->goto_table[4][NON_TERMINAL_E] = 8;     // goto(4,E) = 8
-     tables->goto_table[4][NON_TERMINAL_T] = 2;     // goto(4,T) = 2
-     tables->goto_table[4][NON_TERMINAL_F] = 3;     // goto(4,F) = 3
-     tables->action_table[4][TOKEN_NUM] = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
-     tables->action_table[4][TOKEN_LPAREN] = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
+     GOTO(4, NON_TERMINAL_E) = 8;     // goto(4,E) = 8
+     GOTO(4, NON_TERMINAL_T) = 2;     // goto(4,T) = 2
+     GOTO(4, NON_TERMINAL_F) = 3;     // goto(4,F) = 3
+     ACTION(4, TOKEN_NUM) = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
+     ACTION(4, TOKEN_LPAREN) = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
      
      // State 5
-     tables->action_table[5][TOKEN_PLUS] = automaton_create_action(ACTION_REDUCE, 7);    // reduce using rule 7
-     tables->action_table[5][TOKEN_STAR] = automaton_create_action(ACTION_REDUCE, 7);    // reduce using rule 7
-     tables->action_table[5][TOKEN_RPAREN] = automaton_create_action(ACTION_REDUCE, 7);  // reduce using rule 7
-     tables->action_table[5][TOKEN_EOF] = automaton_create_action(ACTION_REDUCE, 7);     // reduce using rule 7
+     ACTION(5, TOKEN_PLUS) = automaton_create_action(ACTION_REDUCE, 7);    // reduce using rule 7
+     ACTION(5, TOKEN_STAR) = automaton_create_action(ACTION_REDUCE, 7);    // reduce using rule 7
+     ACTION(5, TOKEN_RPAREN) = automaton_create_action(ACTION_REDUCE, 7);  // reduce using rule 7
+     ACTION(5, TOKEN_EOF) = automaton_create_action(ACTION_REDUCE, 7);     // reduce using rule 7
      
      // State 6
-     tables->goto_table[6][NON_TERMINAL_T] = 9;     // goto(6,T) = 9
-     tables->goto_table[6][NON_TERMINAL_F] = 3;     // goto(6,F) = 3
-     tables->action_table[6][TOKEN_NUM] = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
-     tables->action_table[6][TOKEN_LPAREN] = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
+     GOTO(6, NON_TERMINAL_T) = 9;     // goto(6,T) = 9
+     GOTO(6, NON_TERMINAL_F) = 3;     // goto(6,F) = 3
+     ACTION(6, TOKEN_NUM) = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
+     ACTION(6, TOKEN_LPAREN) = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
      
      // State 7
-     tables->goto_table[7][NON_TERMINAL_F] = 10;    // goto(7,F) = 10
-     tables->action_table[7][TOKEN_NUM] = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
-     tables->action_table[7][TOKEN_LPAREN] = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
+     GOTO(7, NON_TERMINAL_F) = 10;    // goto(7,F) = 10
+     ACTION(7, TOKEN_NUM) = automaton_create_action(ACTION_SHIFT, 5);      // shift to state 5
+     ACTION(7, TOKEN_LPAREN) = automaton_create_action(ACTION_SHIFT, 4);   // shift to state 4
      
      // State 8
-     tables->action_table[8][TOKEN_PLUS] = automaton_create_action(ACTION_SHIFT, 6);     // shift to state 6
-     tables->action_table[8][TOKEN_RPAREN] = automaton_create_action(ACTION_SHIFT, 11);  // shift to state 11
+     ACTION(8, TOKEN_PLUS) = automaton_create_action(ACTION_SHIFT, 6);     // shift to state 6
+     ACTION(8, TOKEN_RPAREN) = automaton_create_action(ACTION_SHIFT, 11);  // shift to state 11
      
      // State 9
-     tables->action_table[9][TOKEN_STAR] = automaton_create_action(ACTION_SHIFT, 7);     // shift to state 7
-     tables->action_table[9][TOKEN_PLUS] = automaton_create_action(ACTION_REDUCE, 2);    // reduce using rule 2
-     tables->action_table[9][TOKEN_RPAREN] = automaton_create_action(ACTION_REDUCE, 2);  // reduce using rule 2
-     tables->action_table[9][TOKEN_EOF] = automaton_create_action(ACTION_REDUCE, 2);     // reduce using rule 2
+     ACTION(9, TOKEN_STAR) = automaton_create_action(ACTION_SHIFT, 7);     // shift to state 7
+     ACTION(9, TOKEN_PLUS) = automaton_create_action(ACTION_REDUCE, 2);    // reduce using rule 2
+     ACTION(9, TOKEN_RPAREN) = automaton_create_action(ACTION_REDUCE, 2);  // reduce using rule 2
+     ACTION(9, TOKEN_EOF) = automaton_create_action(ACTION_REDUCE, 2);     // reduce using rule 2
      
      // State 10
-     tables->action_table[10][TOKEN_PLUS] = automaton_create_action(ACTION_REDUCE, 4);   // reduce using rule 4
-     tables->action_table[10][TOKEN_STAR] = automaton_create_action(ACTION_REDUCE, 4);   // reduce using rule 4
-     tables->action_table[10][TOKEN_RPAREN] = automaton_create_action(ACTION_REDUCE, 4); // reduce using rule 4
-     tables->action_table[10][TOKEN_EOF] = automaton_create_action(ACTION_REDUCE, 4);    // reduce using rule 4
+     ACTION(10, TOKEN_PLUS) = automaton_create_action(ACTION_REDUCE, 4);   // reduce using rule 4
+     ACTION(10, TOKEN_STAR) = automaton_create_action(ACTION_REDUCE, 4);   // reduce using rule 4
+     ACTION(10, TOKEN_RPAREN) = automaton_create_action(ACTION_REDUCE, 4); // reduce using rule 4
+     ACTION(10, TOKEN_EOF) = automaton_create_action(ACTION_REDUCE, 4);    // reduce using rule 4
   
      // State 11
-     tables->action_table[11][TOKEN_PLUS] = automaton_create_action(ACTION_REDUCE, 6);   // reduce using rule 6
-     tables->action_table[11][TOKEN_STAR] = automaton_create_action(ACTION_REDUCE, 6);   // reduce using rule 6
-     tables->action_table[11][TOKEN_RPAREN] = automaton_create_action(ACTION_REDUCE, 6); // reduce using rule 6
-     tables->action_table[11][TOKEN_EOF] = automaton_create_action(ACTION_REDUCE, 6);    // reduce using rule 6
+     ACTION(11, TOKEN_PLUS) = automaton_create_action(ACTION_REDUCE, 6);   // reduce using rule 6
+     ACTION(11, TOKEN_STAR) = automaton_create_action(ACTION_REDUCE, 6);   // reduce using rule 6
+     ACTION(11, TOKEN_RPAREN) = automaton_create_action(ACTION_REDUCE, 6); // reduce using rule 6
+     ACTION(11, TOKEN_EOF) = automaton_create_action(ACTION_REDUCE, 6);    // reduce using rule 6
 
  }
\ No newline at end of file
@@ -0,0 +1,310 @@
+/**
+ * @file batch.c
+ * @brief Batch mode: parse many input files with one parser per thread
+ * @members: Group
+ *
+ * The paths are collected first and split into one contiguous range per
+ * worker. Each worker has its own Parser (sharing the read-only tables)
+ * and takes files from the front of its range; a worker that runs dry
+ * steals the back half of another worker's range, so one slow file only
+ * delays the files queued behind it until someone steals them. Every
+ * range has its own lock and each result goes to the slot of its input,
+ * so nothing is shared between workers while they parse. The result
+ * lines are written in input order at the end.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <dirent.h>
+ #include <pthread.h>
+ #include <sys/stat.h>
+ #ifndef _WIN32
+ #include <unistd.h>
+ #endif
+ #include "../include/batch.h"
+ #include "../include/workers.h"
+ #include "../include/utils.h"
+
+ // Longest manifest line accepted
+ #define BATCH_MAX_PATH 4096
+
+ // Extension of the files taken from a directory
+ #define BATCH_EXTENSION ".cscn"
+
+ /**
+  * Growable list of input paths
+  */
+ typedef struct {
+     char** paths;
+     int count;
+     int capacity;
+     int unreadable;  // Directories that could not be listed
+ } PathList;
+
+ /**
+  * Range of input indices still to be parsed by a worker
+  */
+ typedef struct {
+     pthread_mutex_t lock;
+     int head;  // Next index the owner takes
+     int tail;  // End of the range, thieves take from here
+ } WorkRange;
+
+ /**
+  * State shared by the workers (only the ranges are written concurrently)
+  */
+ typedef struct {
+     char** paths;
+     WorkerResult* results;
+     WorkRange* ranges;  // One per worker, by worker index
+     int num_workers;
+ } BatchShared;
+
+ /**
+  * Number of online processors, at least 1
+  */
+ int batch_default_jobs(void) {
+ #ifdef _SC_NPROCESSORS_ONLN
+     long count = sysconf(_SC_NPROCESSORS_ONLN);
+     return count > 0 ? (int)count : 1;
+ #else
+     return 1;
+ #endif
+ }
+
+ static void path_list_add(PathList* list, const char* path) {
+     if (list->count == list->capacity) {
+         list->capacity = list->capacity ? list->capacity * 2 : 64;
+         list->paths = (char**)safe_realloc(list->paths, sizeof(char*) * list->capacity);
+     }
+     list->paths[list->count++] = safe_strdup(path);
+ }
+
+ static int compare_names(const void* a, const void* b) {
+     return strcmp(*(const char* const*)a, *(const char* const*)b);
+ }
+
+ /**
+  * Check whether a name ends with the input file extension
+  */
+ static bool has_input_extension(const char* name) {
+     size_t length = strlen(name);
+     size_t extension = strlen(BATCH_EXTENSION);
+     return length > extension && strcmp(name + length - extension, BATCH_EXTENSION) == 0;
+ }
+
+ /**
+  * Add the .cscn files of a directory in name order
+  */
+ static void add_directory(PathList* list, const char* path) {
+     DIR* directory = opendir(path);
+     if (!directory) {
+         log_error("Could not open directory %s", path);
+         list->unreadable++;
+         return;
+     }
+
+     PathList names = { NULL, 0, 0, 0 };
+     struct dirent* entry;
+     while ((entry = readdir(directory)) != NULL) {
+         if (has_input_extension(entry->d_name)) {
+             path_list_add(&names, entry->d_name);
+         }
+     }
+     closedir(directory);
+
+     qsort(names.paths, names.count, sizeof(char*), compare_names);
+
+     size_t length = strlen(path);
+     bool has_separator = length > 0 && (path[length - 1] == '/' || path[length - 1] == '\\');
+     for (int i = 0; i < names.count; i++) {
+         char* file = string_format("%s%s%s", path, has_separator ? "" : "/", names.paths[i]);
+         path_list_add(list, file);
+         free(file);
+         free(names.paths[i]);
+     }
+     free(names.paths);
+ }
+
+ /**
+  * Add a path that may be a file or a directory
+  */
+ static void add_path(PathList* list, const char* path) {
+     struct stat info;
+     if (stat(path, &info) == 0 && S_ISDIR(info.st_mode)) {
+         add_directory(list, path);
+     } else {
+         path_list_add(list, path);
+     }
+ }
+
+ /**
+  * Parse one file into its result slot
+  */
+ static void parse_one(Parser* parser, const char* path, WorkerResult* slot, ParseStats* totals) {
+     char* output_file = NULL;
+     if (parser->binary_trace) {
+         output_file = generate_trace_filename(path);
+     } else if (parser->trace_level >= TRACE_SUMMARY) {
+         output_file = generate_output_filename(path);
+     }
+
+     ParseResult result = parser_parse(parser, path, output_file);
+     worker_result_store(slot, &result, totals);
+     free(output_file);
+ }
+
+ /**
+  * Take the next index of the worker's own range, -1 if it is empty
+  */
+ static int take_own(WorkRange* range) {
+     int item = -1;
+
+     pthread_mutex_lock(&range->lock);
+     if (range->head < range->tail) {
+         item = range->head++;
+     }
+     pthread_mutex_unlock(&range->lock);
+     return item;
+ }
+
+ /**
+  * Steal the back half of another worker's range, -1 if all are empty
+  */
+ static int steal(BatchShared* shared, int index) {
+     WorkRange* own = &shared->ranges[index];
+
+     for (int offset = 1; offset < shared->num_workers; offset++) {
+         WorkRange* victim = &shared->ranges[(index + offset) % shared->num_workers];
+         int start = 0;
+         int end = 0;
+
+         pthread_mutex_lock(&victim->lock);
+         int remaining = victim->tail - victim->head;
+         if (remaining > 0) {
+             end = victim->tail;
+             start = end - (remaining + 1) / 2;
+             victim->tail = start;
+         }
+         pthread_mutex_unlock(&victim->lock);
+
+         if (end > start) {
+             // Keep the rest of the stolen half where others can steal it
+             pthread_mutex_lock(&own->lock);
+             own->head = start + 1;
+             own->tail = end;
+             pthread_mutex_unlock(&own->lock);
+             return start;
+         }
+     }
+     return -1;
+ }
+
+ /**
+  * Worker loop: own range first, then steal until everything is taken
+  */
+ static void batch_loop(WorkerThread* worker) {
+     BatchShared* shared = (BatchShared*)worker->shared;
+
+     for (;;) {
+         int item = take_own(&shared->ranges[worker->index]);
+         if (item < 0) {
+             item = steal(shared, worker->index);
+         }
+         if (item < 0) {
+             break;
+         }
+         parse_one(worker->parser, shared->paths[item], &shared->results[item], worker->stats);
+     }
+ }
+
+ /**
+  * Parse every path with the given number of workers
+  */
+ static void run_workers(Parser* parser, PathList* list, WorkerResult* results, int jobs,
+                         ParseStats* totals) {
+     BatchShared shared = {
+         .paths = list->paths,
+         .results = results,
+         .ranges = (WorkRange*)safe_malloc(sizeof(WorkRange) * jobs),
+         .num_workers = jobs
+     };
+
+     // A worker that failed to start leaves its range to the others to steal
+     for (int w = 0; w < jobs; w++) {
+         WorkRange* range = &shared.ranges[w];
+         pthread_mutex_init(&range->lock, NULL);
+         range->head = (int)((long long)list->count * w / jobs);
+         range->tail = (int)((long long)list->count * (w + 1) / jobs);
+     }
+
+     worker_run(parser, jobs, "batch", batch_loop, &shared, totals);
+
+     for (int w = 0; w < jobs; w++) {
+         pthread_mutex_destroy(&shared.ranges[w].lock);
+     }
+     free(shared.ranges);
+ }
+
+ /**
+  * Parse a list of inputs with one parser per worker
+  */
+ BatchSummary batch_run(Parser* parser, const char* const* paths, int count, FILE* manifest,
+                        FILE* out, int jobs) {
+     BatchSummary summary = { 0, 0, 0, 0.0, 0, NULL };
+     double start = worker_now_seconds();
+
+     PathList list = { NULL, 0, 0, 0 };
+     if (count > 0) {
+         for (int i = 0; i < count; i++) {
+             add_path(&list, paths[i]);
+         }
+     } else if (manifest) {
+         // One path per line, blank lines and '#' comments are skipped
+         char line[BATCH_MAX_PATH];
+         while (fgets(line, sizeof(line), manifest)) {
+             line[strcspn(line, "\r\n")] = '\0';
+             if (line[0] == '\0' || line[0] == '#') {
+                 continue;
+             }
+             add_path(&list, line);
+         }
+     }
+
+     if (jobs < 1) {
+         jobs = 1;
+     }
+     if (jobs > list.count) {
+         jobs = list.count > 0 ? list.count : 1;
+     }
+
+     WorkerResult* results = (WorkerResult*)safe_malloc(sizeof(WorkerResult) * (list.count > 0 ? list.count : 1));
+     if (parser->collect_stats) {
+         summary.stats = parse_stats_create(parser->tables->num_productions);
+     }
+     run_workers(parser, &list, results, jobs, summary.stats);
+
+     // Result lines in input order
+     for (int i = 0; i < list.count; i++) {
+         WorkerResult* result = &results[i];
+         if (result->success) {
+             summary.accepted++;
+         } else {
+             summary.failed++;
+         }
+         fputs(list.paths[i], out);
+         worker_result_print(out, result);
+         free(result->message);
+         free(list.paths[i]);
+     }
+     summary.files = list.count;
+     summary.failed += list.unreadable;
+     summary.threads = jobs;
+
+     free(results);
+     free(list.paths);
+
+     summary.seconds = worker_now_seconds() - start;
+     return summary;
+ }
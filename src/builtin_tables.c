@@ -0,0 +1,19 @@
+/**
+ * @file builtin_tables.c
+ * @brief Compile-time parsing tables for the built-in expression grammar
+ * @members: Group
+ *
+ * expr_tables.h is generated by tools/gen_tables.c during the build
+ * (see the Makefile), so the tables are plain read-only data and
+ * parser_create does not have to build anything.
+ */
+
+ #include "../include/automaton.h"
+ #include "expr_tables.h"
+
+ /**
+  * Get the shared built-in tables
+  */
+ const ParsingTables* automaton_builtin() {
+     return &expr_tables;
+ }
@@ -0,0 +1,386 @@
+/**
+ * @file collapse.c
+ * @brief Unit production elimination on parsing tables
+ * @members: Group
+ *
+ * Works on a growable copy of the rows. For every shift or goto from a
+ * state q to a state X that reduces by a single-symbol production, a
+ * merged row is built: on each lookahead it has the action X ends up with
+ * once those reductions are followed through the gotos of q, and the
+ * gotos of every state on the way (they never disagree in an LR
+ * automaton, if they do the transition is left alone). The transition is
+ * pointed at an identical existing row or a new one. New rows are
+ * processed like the others, so their transitions are collapsed too.
+ * Finally the rows reachable from state 0 are renumbered into the new
+ * tables.
+ */
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/collapse.h"
+ #include "../include/automaton.h"
+ #include "../include/utils.h"
+
+ /**
+  * Rows of the tables being collapsed
+  */
+ typedef struct {
+     uint16_t* actions;     // num_states * num_terminals
+     int16_t* gotos;        // num_states * num_non_terminals
+     int num_states;        // Rows in use
+     int capacity;          // Rows allocated
+     int num_terminals;
+     int num_non_terminals;
+ } Rows;
+
+ // Forward declarations
+ static bool* new_flags(int count);
+ static void rows_grow(Rows* rows);
+ static bool build_merged_row(const ParsingTables* tables, const Rows* rows, const bool* unit_state,
+                              const bool* collapsible, int below, int target,
+                              uint16_t* actions, int16_t* gotos, bool* used);
+ static int find_or_add_row(Rows* rows, const uint16_t* actions, const int16_t* gotos);
+ static int merge_transition(const ParsingTables* tables, Rows* rows, const bool* unit_state,
+                             const bool* collapsible, int below, int target,
+                             uint16_t* actions, int16_t* gotos, bool* used);
+ static bool collapsible_reduce(const ParsingTables* tables, const bool* collapsible, int action);
+ static ParsingTables* compact_rows(const ParsingTables* tables, const Rows* rows);
+
+ /**
+  * Build tables that skip the reductions by unit productions
+  */
+ ParsingTables* collapse_unit_productions(const ParsingTables* tables, const SemanticAction* actions,
+                                          CollapseReport* report) {
+     int num_states = tables->num_states;
+     int num_terminals = tables->num_terminals;
+     int num_non_terminals = tables->num_non_terminals;
+
+     // Unit productions whose value is the value of their right-hand side
+     bool* collapsible = new_flags(tables->num_productions + 1);
+     for (int p = 1; p <= tables->num_productions; p++) {
+         collapsible[p] = tables->productions[p].rhs_length == 1 &&
+                          (!actions || actions[p] == semantic_copy);
+     }
+
+     // States that reduce by one of them on some lookahead
+     bool* unit_state = new_flags(num_states);
+     for (int state = 0; state < num_states; state++) {
+         for (int token = 0; token < num_terminals; token++) {
+             if (collapsible_reduce(tables, collapsible, tables_action(tables, state, (TokenType)token))) {
+                 unit_state[state] = true;
+             }
+         }
+     }
+
+     Rows rows = { NULL, NULL, 0, 0, num_terminals, num_non_terminals };
+     while (rows.capacity < num_states) {
+         rows_grow(&rows);
+     }
+     memcpy(rows.actions, tables->action_table, sizeof(uint16_t) * num_states * num_terminals);
+     memcpy(rows.gotos, tables->goto_table, sizeof(int16_t) * num_states * num_non_terminals);
+     rows.num_states = num_states;
+
+     uint16_t* merged_actions = (uint16_t*)safe_malloc(sizeof(uint16_t) * num_terminals);
+     int16_t* merged_gotos = (int16_t*)safe_malloc(sizeof(int16_t) * num_non_terminals);
+     bool* used = NULL;
+
+     // Rows added on the way are visited by the same loop
+     for (int state = 0; state < rows.num_states; state++) {
+         // Shifts of a terminal the state reduces at once (like f → NUM)
+         for (int token = 0; token < num_terminals; token++) {
+             int action = rows.actions[state * num_terminals + token];
+             if (action_type_of(action) != ACTION_SHIFT) {
+                 continue;
+             }
+             used = (bool*)safe_realloc(used, sizeof(bool) * rows.num_states);
+             int merged = merge_transition(tables, &rows, unit_state, collapsible, state,
+                                           action_value_of(action), merged_actions, merged_gotos, used);
+             if (merged >= 0) {
+                 rows.actions[state * num_terminals + token] =
+                     (uint16_t)automaton_create_action(ACTION_SHIFT, merged);
+             }
+         }
+
+         // Gotos to a state reducing by a unit production (like t → f)
+         for (int nt = 0; nt < num_non_terminals; nt++) {
+             int target = rows.gotos[state * num_non_terminals + nt];
+             if (target < 0) {
+                 continue;
+             }
+             used = (bool*)safe_realloc(used, sizeof(bool) * rows.num_states);
+             int merged = merge_transition(tables, &rows, unit_state, collapsible, state, target,
+                                           merged_actions, merged_gotos, used);
+             if (merged >= 0) {
+                 rows.gotos[state * num_non_terminals + nt] = (int16_t)merged;
+             }
+         }
+     }
+
+     ParsingTables* collapsed = compact_rows(tables, &rows);
+
+     if (report) {
+         report->states_before = num_states;
+         report->states_after = collapsed->num_states;
+         report->units_removed = 0;
+         for (int p = 1; p <= tables->num_productions; p++) {
+             if (tables->productions[p].rhs_length != 1) {
+                 continue;
+             }
+             bool before = false;
+             bool after = false;
+             for (int i = 0; i < num_states * num_terminals; i++) {
+                 int action = tables->action_table[i];
+                 before |= action_type_of(action) == ACTION_REDUCE && action_value_of(action) == p;
+             }
+             for (int i = 0; i < collapsed->num_states * num_terminals; i++) {
+                 int action = collapsed->action_table[i];
+                 after |= action_type_of(action) == ACTION_REDUCE && action_value_of(action) == p;
+             }
+             if (before && !after) {
+                 report->units_removed++;
+             }
+         }
+     }
+
+     free(used);
+     free(merged_gotos);
+     free(merged_actions);
+     free(rows.gotos);
+     free(rows.actions);
+     free(unit_state);
+     free(collapsible);
+     return collapsed;
+ }
+
+ /* Internal function implementations */
+
+ /**
+  * Array of count false flags
+  */
+ static bool* new_flags(int count) {
+     bool* flags = (bool*)safe_malloc(sizeof(bool) * (size_t)count);
+     memset(flags, 0, sizeof(bool) * (size_t)count);
+     return flags;
+ }
+
+ /**
+  * Double the rows allocated
+  */
+ static void rows_grow(Rows* rows) {
+     rows->capacity = rows->capacity ? rows->capacity * 2 : 16;
+     rows->actions = (uint16_t*)safe_realloc(rows->actions,
+                                             sizeof(uint16_t) * rows->capacity * rows->num_terminals);
+     rows->gotos = (int16_t*)safe_realloc(rows->gotos,
+                                          sizeof(int16_t) * rows->capacity * rows->num_non_terminals);
+ }
+
+ /**
+  * Row for the goto of state below to target with the unit reductions of
+  * target followed through; false if they cannot be (a cycle of unit
+  * productions, a missing goto or gotos that disagree)
+  */
+ static bool build_merged_row(const ParsingTables* tables, const Rows* rows, const bool* unit_state,
+                              const bool* collapsible, int below, int target,
+                              uint16_t* actions, int16_t* gotos, bool* used) {
+     int num_terminals = rows->num_terminals;
+     int num_non_terminals = rows->num_non_terminals;
+
+     for (int i = 0; i < rows->num_states; i++) {
+         used[i] = false;
+     }
+     used[target] = true;
+
+     for (int token = 0; token < num_terminals; token++) {
+         int state = target;
+         int action = rows->actions[state * num_terminals + token];
+         int chain = 0;
+
+         // Only original unit states reduce by a collapsible production
+         while (state < tables->num_states && unit_state[state] &&
+                collapsible_reduce(tables, collapsible, action)) {
+             if (++chain > tables->num_productions) {
+                 return false;
+             }
+             int lhs = tables->productions[action_value_of(action)].lhs;
+             state = rows->gotos[below * num_non_terminals + lhs];
+             if (state < 0) {
+                 return false;
+             }
+             used[state] = true;
+             action = rows->actions[state * num_terminals + token];
+         }
+         actions[token] = (uint16_t)action;
+     }
+
+     // The merged entry stands for every state used above
+     for (int nt = 0; nt < num_non_terminals; nt++) {
+         gotos[nt] = -1;
+         for (int state = 0; state < rows->num_states; state++) {
+             int next = used[state] ? rows->gotos[state * num_non_terminals + nt] : -1;
+             if (next < 0) {
+                 continue;
+             }
+             if (gotos[nt] >= 0 && gotos[nt] != next) {
+                 return false;
+             }
+             gotos[nt] = (int16_t)next;
+         }
+     }
+     return true;
+ }
+
+ /**
+  * New target of the transition from state below to target, -1 to keep
+  * it (target reduces by no collapsible production or cannot be merged)
+  */
+ static int merge_transition(const ParsingTables* tables, Rows* rows, const bool* unit_state,
+                             const bool* collapsible, int below, int target,
+                             uint16_t* actions, int16_t* gotos, bool* used) {
+     if (target >= tables->num_states || !unit_state[target] ||
+         !build_merged_row(tables, rows, unit_state, collapsible, below, target, actions, gotos, used)) {
+         return -1;
+     }
+     int merged = find_or_add_row(rows, actions, gotos);
+     if (merged < 0) {
+         log_error("Too many states while collapsing unit productions, some are kept");
+     }
+     return merged;
+ }
+
+ /**
+  * Whether an action reduces by a collapsible unit production
+  */
+ static bool collapsible_reduce(const ParsingTables* tables, const bool* collapsible, int action) {
+     int production = action_value_of(action);
+     return action_type_of(action) == ACTION_REDUCE && production >= 1 &&
+            production <= tables->num_productions && collapsible[production];
+ }
+
+ /**
+  * Index of a row equal to the given one, appended if there is none;
+  * -1 if the states no longer fit in a packed action
+  */
+ static int find_or_add_row(Rows* rows, const uint16_t* actions, const int16_t* gotos) {
+     size_t action_bytes = sizeof(uint16_t) * rows->num_terminals;
+     size_t goto_bytes = sizeof(int16_t) * rows->num_non_terminals;
+
+     for (int state = 0; state < rows->num_states; state++) {
+         if (memcmp(rows->actions + state * rows->num_terminals, actions, action_bytes) == 0 &&
+             memcmp(rows->gotos + state * rows->num_non_terminals, gotos, goto_bytes) == 0) {
+             return state;
+         }
+     }
+
+     if (rows->num_states == ACTION_VALUE_MAX) {
+         return -1;
+     }
+     if (rows->num_states == rows->capacity) {
+         rows_grow(rows);
+     }
+     int state = rows->num_states++;
+     memcpy(rows->actions + state * rows->num_terminals, actions, action_bytes);
+     memcpy(rows->gotos + state * rows->num_non_terminals, gotos, goto_bytes);
+     return state;
+ }
+
+ /**
+  * New tables with the rows reachable from state 0, in their order, and
+  * a copy of the productions and names
+  */
+ static ParsingTables* compact_rows(const ParsingTables* tables, const Rows* rows) {
+     int num_terminals = rows->num_terminals;
+     int num_non_terminals = rows->num_non_terminals;
+
+     // Reachable rows, numbered in row order
+     int* number = (int*)safe_malloc(sizeof(int) * rows->num_states);
+     int* pending = (int*)safe_malloc(sizeof(int) * rows->num_states);
+     for (int i = 0; i < rows->num_states; i++) {
+         number[i] = -1;
+     }
+     int count = 0;
+     number[0] = 0;
+     pending[count++] = 0;
+     for (int next = 0; next < count; next++) {
+         int state = pending[next];
+         for (int token = 0; token < num_terminals; token++) {
+             int action = rows->actions[state * num_terminals + token];
+             int target = action_value_of(action);
+             if (action_type_of(action) == ACTION_SHIFT && number[target] < 0) {
+                 number[target] = 0;
+                 pending[count++] = target;
+             }
+         }
+         for (int nt = 0; nt < num_non_terminals; nt++) {
+             int target = rows->gotos[state * num_non_terminals + nt];
+             if (target >= 0 && number[target] < 0) {
+                 number[target] = 0;
+                 pending[count++] = target;
+             }
+         }
+     }
+     int num_states = 0;
+     for (int i = 0; i < rows->num_states; i++) {
+         if (number[i] >= 0) {
+             number[i] = num_states++;
+         }
+     }
+
+     uint16_t* actions = (uint16_t*)safe_malloc(sizeof(uint16_t) * num_states * num_terminals);
+     int16_t* gotos = (int16_t*)safe_malloc(sizeof(int16_t) * num_states * num_non_terminals);
+     for (int i = 0; i < rows->num_states; i++) {
+         if (number[i] < 0) {
+             continue;
+         }
+         for (int token = 0; token < num_terminals; token++) {
+             int action = rows->actions[i * num_terminals + token];
+             if (action_type_of(action) == ACTION_SHIFT) {
+                 action = automaton_create_action(ACTION_SHIFT, number[action_value_of(action)]);
+             }
+             actions[number[i] * num_terminals + token] = (uint16_t)action;
+         }
+         for (int nt = 0; nt < num_non_terminals; nt++) {
+             int target = rows->gotos[i * num_non_terminals + nt];
+             gotos[number[i] * num_non_terminals + nt] = (int16_t)(target < 0 ? -1 : number[target]);
+         }
+     }
+     free(pending);
+     free(number);
+
+     // Productions and names are freed with the tables, so they are copied
+     Production* productions = (Production*)safe_malloc(sizeof(Production) * (tables->num_productions + 1));
+     for (int i = 0; i <= tables->num_productions; i++) {
+         const Production* source = &tables->productions[i];
+         int* rhs = NULL;
+         if (source->rhs && source->rhs_length > 0) {
+             rhs = (int*)safe_malloc(sizeof(int) * source->rhs_length);
+             memcpy(rhs, source->rhs, sizeof(int) * source->rhs_length);
+         }
+         productions[i].lhs = source->lhs;
+         productions[i].rhs = rhs;
+         productions[i].rhs_length = source->rhs_length;
+         productions[i].rule_string = source->rule_string ? safe_strdup(source->rule_string) : NULL;
+     }
+
+     const char** names = NULL;
+     if (tables->non_terminal_names) {
+         names = (const char**)safe_malloc(sizeof(char*) * num_non_terminals);
+         for (int i = 0; i < num_non_terminals; i++) {
+             names[i] = safe_strdup(tables->non_terminal_names[i]);
+         }
+     }
+
+     ParsingTables* collapsed = (ParsingTables*)safe_malloc(sizeof(ParsingTables));
+     collapsed->action_table = actions;
+     collapsed->goto_table = gotos;
+     collapsed->num_states = num_states;
+     collapsed->num_terminals = num_terminals;
+     collapsed->num_non_terminals = num_non_terminals;
+     collapsed->non_terminal_names = names;
+     collapsed->productions = productions;
+     collapsed->num_productions = tables->num_productions;
+     collapsed->is_static = false;
+     collapsed->cache_map = NULL;
+     collapsed->cache_size = 0;
+     automaton_build_expected(collapsed);
+     return collapsed;
+ }
@@ -0,0 +1,112 @@
+/**
+ * @file engine.c
+ * @brief Parse loop generated for the built-in grammar
+ * @members: Group
+ *
+ * expr_engine.h is generated by tools/gen_tables.c --engine from the same
+ * tables as expr_tables.h (see the Makefile). It is one function with a
+ * label per state: a shift pushes its state and jumps to it, a reduction
+ * pops its right-hand side and switches on the uncovered state straight
+ * to the goto state. The operations it uses are the macros below.
+ */
+
+ #include <stdlib.h>
+ #include "../include/engine.h"
+ #include "../include/automaton.h"
+ #include "../include/utils.h"
+
+ static uint16_t* engine_grow(EngineRun* run, uint16_t* top);
+
+ // Locals of the generated function: the stack top and its limit
+ #define ENGINE_ENTER() \
+     TokenStream* input = run->input; \
+     uint16_t* top = run->states; \
+     uint16_t* limit = run->states + run->capacity; \
+     int steps = 0; \
+     *top = 0
+
+ #define ENGINE_STEP() (steps++)
+
+ #define ENGINE_TOKEN() (input->current->type)
+
+ // Push a state, growing the storage when it is full
+ #define ENGINE_PUSH(state) do { \
+         if (++top == limit) { \
+             top = engine_grow(run, top); \
+             limit = run->states + run->capacity; \
+         } \
+         *top = (uint16_t)(state); \
+     } while (0)
+
+ // Only states are stacked, so the shifted token is released at once
+ #define ENGINE_SHIFT(state) do { \
+         ENGINE_PUSH(state); \
+         token_stream_release(input, get_next_token(input)); \
+         if (!input->current) { \
+             ENGINE_FAIL(); \
+         } \
+     } while (0)
+
+ // State uncovered by popping length entries
+ #define ENGINE_BELOW(length) (top[-(length)])
+
+ // Pop length (at least 1) entries and push the goto state, never grows
+ #define ENGINE_REDUCE(production, length, state) do { \
+         top -= (length) - 1; \
+         *top = (uint16_t)(state); \
+     } while (0)
+
+ // Empty production: only the goto state is pushed
+ #define ENGINE_PUSH_GOTO(production, state) ENGINE_PUSH(state)
+
+ #define ENGINE_ACCEPT() do { \
+         run->steps = steps; \
+         return ENGINE_ACCEPTED; \
+     } while (0)
+
+ #define ENGINE_REJECT() do { \
+         run->steps = steps; \
+         run->error_token = input->current; \
+         run->error_state = *top; \
+         return ENGINE_REJECTED; \
+     } while (0)
+
+ #define ENGINE_FAIL() do { \
+         run->steps = steps; \
+         return ENGINE_FAILED; \
+     } while (0)
+
+ #include "expr_engine.h"
+
+ /**
+  * Check whether the generated engine implements these tables
+  */
+ bool engine_supports(const ParsingTables* tables) {
+     return tables == automaton_builtin();
+ }
+
+ /**
+  * Parse the input with the generated engine
+  */
+ EngineStatus engine_run(EngineRun* run) {
+     run->steps = 0;
+     run->error_token = NULL;
+     if (!run->input || !run->input->current) {
+         return ENGINE_FAILED;
+     }
+     if (run->capacity == 0) {
+         run->states = (uint16_t*)safe_malloc(sizeof(uint16_t) * ENGINE_INITIAL_CAPACITY);
+         run->capacity = ENGINE_INITIAL_CAPACITY;
+     }
+     return expr_engine(run);
+ }
+
+ /**
+  * Double the state stack, top points one past the full storage
+  */
+ static uint16_t* engine_grow(EngineRun* run, uint16_t* top) {
+     int used = (int)(top - run->states);
+     run->capacity *= 2;
+     run->states = (uint16_t*)safe_realloc(run->states, sizeof(uint16_t) * run->capacity);
+     return run->states + used;
+ }
@@ -0,0 +1,363 @@
+/**
+ * @file grammar.c
+ * @brief Reader for BNF grammar descriptions
+ * @members: Group
+ *
+ * Non-terminal names are interned into small integer IDs while the
+ * source is read, so the table generator only handles ints.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <ctype.h>
+ #include "../include/grammar.h"
+ #include "../include/utils.h"
+
+ // Initial number of slots for rules and interned names
+ #define GRAMMAR_INITIAL_CAPACITY 16
+
+ /**
+  * Lexical elements of the grammar source
+  */
+ typedef enum {
+     GTOK_NAME,   // Terminal or non-terminal name
+     GTOK_COLON,  // ':'
+     GTOK_BAR,    // '|'
+     GTOK_SEMI,   // ';'
+     GTOK_END,    // End of source
+     GTOK_ERROR   // Unexpected character
+ } GrammarTokenType;
+
+ /**
+  * Reader state
+  */
+ typedef struct {
+     const char* pos;          // Next unread character
+     const char* source_name;  // For error messages
+     int line;                 // Current line
+     GrammarTokenType type;    // Current token
+     const char* text;         // Current token text
+     int length;               // Current token length
+     int token_line;           // Line of the current token
+     Grammar* grammar;         // Grammar being built
+     int names_capacity;       // Allocated entries in grammar->names
+     bool* defined;            // Non-terminals with a rule
+     int* first_use;           // Line where each non-terminal was first used
+ } GrammarReader;
+
+ /**
+  * Read the next token of the grammar source
+  */
+ static void next_token(GrammarReader* reader) {
+     for (;;) {
+         while (isspace((unsigned char)*reader->pos)) {
+             if (*reader->pos == '\n') {
+                 reader->line++;
+             }
+             reader->pos++;
+         }
+         if (*reader->pos != '#') {
+             break;
+         }
+         // Comment up to the end of the line
+         while (*reader->pos && *reader->pos != '\n') {
+             reader->pos++;
+         }
+     }
+
+     reader->text = reader->pos;
+     reader->length = 1;
+     reader->token_line = reader->line;
+
+     char c = *reader->pos;
+     if (c == '\0') {
+         reader->type = GTOK_END;
+         reader->length = 0;
+         return;
+     }
+     if (isalpha((unsigned char)c) || c == '_') {
+         const char* start = reader->pos;
+         while (isalnum((unsigned char)*reader->pos) || *reader->pos == '_') {
+             reader->pos++;
+         }
+         reader->type = GTOK_NAME;
+         reader->length = (int)(reader->pos - start);
+         return;
+     }
+
+     reader->pos++;
+     switch (c) {
+         case ':': reader->type = GTOK_COLON; break;
+         case '|': reader->type = GTOK_BAR;   break;
+         case ';': reader->type = GTOK_SEMI;  break;
+         default:  reader->type = GTOK_ERROR; break;
+     }
+ }
+
+ /**
+  * Intern a non-terminal name, returning its index
+  */
+ static int intern_non_terminal(GrammarReader* reader, const char* text, int length) {
+     Grammar* grammar = reader->grammar;
+
+     for (int i = 0; i < grammar->num_non_terminals; i++) {
+         if ((int)strlen(grammar->names[i]) == length &&
+             memcmp(grammar->names[i], text, length) == 0) {
+             return i;
+         }
+     }
+
+     if (grammar->num_non_terminals == reader->names_capacity) {
+         reader->names_capacity *= 2;
+         grammar->names = (char**)safe_realloc(grammar->names, sizeof(char*) * reader->names_capacity);
+         reader->defined = (bool*)safe_realloc(reader->defined, sizeof(bool) * reader->names_capacity);
+         reader->first_use = (int*)safe_realloc(reader->first_use, sizeof(int) * reader->names_capacity);
+     }
+
+     int index = grammar->num_non_terminals++;
+     char* name = (char*)safe_malloc(length + 1);
+     memcpy(name, text, length);
+     name[length] = '\0';
+     grammar->names[index] = name;
+     reader->defined[index] = false;
+     reader->first_use[index] = reader->token_line;
+     return index;
+ }
+
+ /**
+  * Map the current name token to a symbol, -1 if it is EOF
+  */
+ static int name_to_symbol(GrammarReader* reader) {
+     TokenType type = token_type_from_text(reader->text, reader->length);
+
+     if (type == TOKEN_EOF) {
+         return -1;
+     }
+     if (type >= 0 && type < GRAMMAR_TERMINALS) {
+         return type;
+     }
+     return GRAMMAR_NT(intern_non_terminal(reader, reader->text, reader->length));
+ }
+
+ /**
+  * Append a rule with the given symbols
+  */
+ static void add_rule(Grammar* grammar, int lhs, const int* rhs, int rhs_length, int line) {
+     if (grammar->num_rules + 1 == grammar->capacity) {
+         grammar->capacity *= 2;
+         grammar->rules = (GrammarRule*)safe_realloc(grammar->rules, sizeof(GrammarRule) * grammar->capacity);
+     }
+
+     GrammarRule* rule = &grammar->rules[++grammar->num_rules];
+     rule->lhs = lhs;
+     rule->rhs_length = rhs_length;
+     rule->rhs = NULL;
+     rule->line = line;
+     if (rhs_length > 0) {
+         rule->rhs = (int*)safe_malloc(sizeof(int) * rhs_length);
+         memcpy(rule->rhs, rhs, sizeof(int) * rhs_length);
+     }
+ }
+
+ /**
+  * Report an error at the current token
+  */
+ static void reader_error(GrammarReader* reader, const char* message) {
+     log_error("%s:%d: %s near '%.*s'", reader->source_name, reader->token_line,
+               message, reader->length, reader->text);
+ }
+
+ /**
+  * Read one rule: name ':' alternatives ';'
+  */
+ static bool read_rule(GrammarReader* reader, int** symbols, int* symbols_capacity) {
+     if (reader->type != GTOK_NAME) {
+         reader_error(reader, "Expected a rule name");
+         return false;
+     }
+
+     int lhs_symbol = name_to_symbol(reader);
+     if (lhs_symbol < 0 || !GRAMMAR_IS_NT(lhs_symbol)) {
+         reader_error(reader, "Terminal used as a rule name");
+         return false;
+     }
+     int lhs = GRAMMAR_NT_INDEX(lhs_symbol);
+     if (reader->defined[lhs]) {
+         reader_error(reader, "Rule defined twice");
+         return false;
+     }
+     reader->defined[lhs] = true;
+
+     next_token(reader);
+     if (reader->type != GTOK_COLON) {
+         reader_error(reader, "Expected ':'");
+         return false;
+     }
+
+     for (;;) {
+         int count = 0;
+
+         next_token(reader);
+         int line = reader->token_line;
+         while (reader->type == GTOK_NAME) {
+             int symbol = name_to_symbol(reader);
+             if (symbol < 0) {
+                 reader_error(reader, "EOF is implicit and cannot be used");
+                 return false;
+             }
+             if (count == *symbols_capacity) {
+                 *symbols_capacity *= 2;
+                 *symbols = (int*)safe_realloc(*symbols, sizeof(int) * *symbols_capacity);
+             }
+             (*symbols)[count++] = symbol;
+             next_token(reader);
+         }
+
+         add_rule(reader->grammar, lhs, *symbols, count, line);
+
+         if (reader->type == GTOK_SEMI) {
+             next_token(reader);
+             return true;
+         }
+         if (reader->type != GTOK_BAR) {
+             reader_error(reader, "Expected '|' or ';'");
+             return false;
+         }
+     }
+ }
+
+ /**
+  * Read a grammar from BNF source text
+  */
+ Grammar* grammar_parse(const char* source, const char* source_name) {
+     Grammar* grammar = (Grammar*)safe_malloc(sizeof(Grammar));
+     grammar->names = (char**)safe_malloc(sizeof(char*) * GRAMMAR_INITIAL_CAPACITY);
+     grammar->num_non_terminals = 0;
+     grammar->rules = (GrammarRule*)safe_malloc(sizeof(GrammarRule) * GRAMMAR_INITIAL_CAPACITY);
+     grammar->num_rules = 0;
+     grammar->capacity = GRAMMAR_INITIAL_CAPACITY;
+
+     // Rule 0 is unused so rule numbers match production numbers
+     grammar->rules[0].lhs = 0;
+     grammar->rules[0].rhs = NULL;
+     grammar->rules[0].rhs_length = 0;
+     grammar->rules[0].line = 0;
+
+     GrammarReader reader = {
+         .pos = source,
+         .source_name = source_name,
+         .line = 1,
+         .grammar = grammar,
+         .names_capacity = GRAMMAR_INITIAL_CAPACITY,
+         .defined = (bool*)safe_malloc(sizeof(bool) * GRAMMAR_INITIAL_CAPACITY),
+         .first_use = (int*)safe_malloc(sizeof(int) * GRAMMAR_INITIAL_CAPACITY)
+     };
+
+     int symbols_capacity = GRAMMAR_INITIAL_CAPACITY;
+     int* symbols = (int*)safe_malloc(sizeof(int) * symbols_capacity);
+     bool ok = true;
+
+     next_token(&reader);
+     while (ok && reader.type != GTOK_END) {
+         ok = read_rule(&reader, &symbols, &symbols_capacity);
+     }
+
+     if (ok && grammar->num_rules == 0) {
+         log_error("%s: Grammar has no rules", source_name);
+         ok = false;
+     }
+
+     // Every non-terminal used on a right-hand side needs a rule
+     for (int i = 0; ok && i < grammar->num_non_terminals; i++) {
+         if (!reader.defined[i]) {
+             log_error("%s:%d: Non-terminal '%s' has no rule", source_name,
+                       reader.first_use[i], grammar->names[i]);
+             ok = false;
+         }
+     }
+
+     free(symbols);
+     free(reader.defined);
+     free(reader.first_use);
+
+     if (!ok) {
+         grammar_free(grammar);
+         return NULL;
+     }
+     return grammar;
+ }
+
+ /**
+  * Read a whole file into a NUL-terminated heap buffer
+  */
+ char* grammar_read_file(const char* filename, size_t* length) {
+     FILE* file = fopen(filename, "rb");
+     if (!file) {
+         log_error("Could not open grammar file %s", filename);
+         return NULL;
+     }
+
+     size_t capacity = 4096;
+     size_t size = 0;
+     char* text = (char*)safe_malloc(capacity);
+     size_t read;
+     while ((read = fread(text + size, 1, capacity - size - 1, file)) > 0) {
+         size += read;
+         if (capacity - size - 1 == 0) {
+             capacity *= 2;
+             text = (char*)safe_realloc(text, capacity);
+         }
+     }
+     fclose(file);
+
+     text[size] = '\0';
+     if (length) {
+         *length = size;
+     }
+     return text;
+ }
+
+ /**
+  * Read a grammar from a file
+  */
+ Grammar* grammar_load(const char* filename) {
+     char* source = grammar_read_file(filename, NULL);
+     if (!source) {
+         return NULL;
+     }
+
+     Grammar* grammar = grammar_parse(source, filename);
+     free(source);
+     return grammar;
+ }
+
+ /**
+  * Free a grammar
+  */
+ void grammar_free(Grammar* grammar) {
+     if (!grammar) {
+         return;
+     }
+
+     for (int i = 0; i < grammar->num_non_terminals; i++) {
+         free(grammar->names[i]);
+     }
+     for (int i = 1; i <= grammar->num_rules; i++) {
+         free(grammar->rules[i].rhs);
+     }
+     free(grammar->names);
+     free(grammar->rules);
+     free(grammar);
+ }
+
+ /**
+  * Display name of a grammar symbol
+  */
+ const char* grammar_symbol_name(const Grammar* grammar, int symbol) {
+     if (GRAMMAR_IS_NT(symbol)) {
+         int index = GRAMMAR_NT_INDEX(symbol);
+         return index < grammar->num_non_terminals ? grammar->names[index] : "UNKNOWN";
+     }
+     return token_type_to_string((TokenType)symbol);
+ }
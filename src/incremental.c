@@ -0,0 +1,330 @@
+/**
+ * @file incremental.c
+ * @brief Incremental reparsing of an edited token sequence
+ * @members: Group
+ *
+ * The parser state only depends on the tokens already shifted, so the
+ * stack right before token i is shifted is a valid starting point for
+ * any edit at or after i. Such a snapshot is kept for every token: the
+ * stack is persistent (entries point to their parent and are never
+ * changed), so a snapshot is just the index of its top entry and all
+ * snapshots share their common part.
+ *
+ * After an edit the parse restarts from the snapshot at the first
+ * changed token. Past the inserted tokens, the stack at each boundary is
+ * compared with the previous parse's snapshot at the same (shifted)
+ * token; when they are equal the parser is back on its old path and the
+ * remaining snapshots and the result of the previous parse still hold.
+ */
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/incremental.h"
+ #include "../include/automaton.h"
+ #include "../include/utils.h"
+
+ // Initial pool sizes
+ #define INCREMENTAL_INITIAL_TOKENS 64
+ #define INCREMENTAL_INITIAL_NODES 256
+
+ // Stack entries of abandoned parses accumulate in the pool; once it
+ // holds this many entries per token the next edit parses from scratch
+ // with an empty pool
+ #define INCREMENTAL_COMPACT_FACTOR 8
+
+ /**
+  * Create an empty incremental parse
+  */
+ IncrementalParse* incremental_create(const ParsingTables* tables) {
+     IncrementalParse* parse = (IncrementalParse*)safe_malloc(sizeof(IncrementalParse));
+     parse->tables = tables;
+     parse->input = NULL;
+     parse->token_capacity = INCREMENTAL_INITIAL_TOKENS;
+     parse->tokens = (Token**)safe_malloc(sizeof(Token*) * parse->token_capacity);
+     parse->snapshots = (uint32_t*)safe_malloc(sizeof(uint32_t) * (parse->token_capacity + 1));
+     parse->num_tokens = 0;
+     parse->eof = NULL;
+     parse->valid_snapshots = 0;
+     parse->node_capacity = INCREMENTAL_INITIAL_NODES;
+     parse->nodes = (IncrementalNode*)safe_malloc(sizeof(IncrementalNode) * parse->node_capacity);
+     parse->num_nodes = 0;
+     parse->success = false;
+     parse->error_token = -1;
+     parse->last_resumed = 0;
+     parse->last_shifted = 0;
+     parse->last_converged = false;
+     return parse;
+ }
+
+ /**
+  * Free an incremental parse and its tokens
+  */
+ void incremental_free(IncrementalParse* parse) {
+     if (!parse) {
+         return;
+     }
+     token_stream_free(parse->input);
+     free(parse->tokens);
+     free(parse->snapshots);
+     free(parse->nodes);
+     free(parse);
+ }
+
+ /**
+  * Make room for a sequence of count tokens
+  */
+ static void reserve_tokens(IncrementalParse* parse, int count) {
+     if (count <= parse->token_capacity) {
+         return;
+     }
+     while (parse->token_capacity < count) {
+         parse->token_capacity *= 2;
+     }
+     parse->tokens = (Token**)safe_realloc(parse->tokens, sizeof(Token*) * parse->token_capacity);
+     parse->snapshots = (uint32_t*)safe_realloc(parse->snapshots,
+                                                sizeof(uint32_t) * (parse->token_capacity + 1));
+ }
+
+ /**
+  * Drop every stack entry and start again from the initial state
+  */
+ static void reset_nodes(IncrementalParse* parse) {
+     parse->nodes[0].state = 0;
+     parse->nodes[0].parent = INCREMENTAL_NONE;
+     parse->nodes[0].depth = 0;
+     parse->num_nodes = 1;
+ }
+
+ /**
+  * Push a state on top of an entry, returns the new entry
+  */
+ static uint32_t push_node(IncrementalParse* parse, int state, uint32_t parent) {
+     if (parse->num_nodes == parse->node_capacity) {
+         if (parse->node_capacity >= INCREMENTAL_NONE / 2) {
+             log_error("Incremental parse stack too large");
+             exit(EXIT_FAILURE);
+         }
+         parse->node_capacity *= 2;
+         parse->nodes = (IncrementalNode*)safe_realloc(parse->nodes,
+                                                       sizeof(IncrementalNode) * parse->node_capacity);
+     }
+     uint32_t index = parse->num_nodes++;
+     parse->nodes[index].state = state;
+     parse->nodes[index].parent = parent;
+     parse->nodes[index].depth = parse->nodes[parent].depth + 1;
+     return index;
+ }
+
+ /**
+  * Compare two stacks state by state, down to the part they share
+  */
+ static bool same_stack(const IncrementalParse* parse, uint32_t a, uint32_t b) {
+     while (a != b) {
+         const IncrementalNode* x = &parse->nodes[a];
+         const IncrementalNode* y = &parse->nodes[b];
+         if (x->depth != y->depth || x->state != y->state) {
+             return false;
+         }
+         a = x->parent;
+         b = y->parent;
+     }
+     return true;
+ }
+
+ /**
+  * Parse from token resume with the given stack
+  *
+  * Snapshots compare_from .. compare_limit - 1 still hold the previous
+  * parse's stacks (moved to the new token indices); meeting one of them
+  * ends the parse with the previous result.
+  */
+ static void reparse(IncrementalParse* parse, int resume, uint32_t top,
+                     int compare_from, int compare_limit, bool old_success, int old_error) {
+     const ParsingTables* tables = parse->tables;
+     int i = resume;
+
+     parse->last_resumed = resume;
+     parse->last_shifted = 0;
+     parse->last_converged = false;
+     parse->success = false;
+     parse->error_token = -1;
+
+     for (;;) {
+         // Token boundary: join the previous parse if the stacks agree
+         if (i >= compare_from && i < compare_limit && same_stack(parse, top, parse->snapshots[i])) {
+             parse->valid_snapshots = compare_limit;
+             parse->success = old_success;
+             parse->error_token = old_success ? -1 : old_error;
+             parse->last_converged = true;
+             return;
+         }
+         parse->snapshots[i] = top;
+
+         Token* token = i < parse->num_tokens ? parse->tokens[i] : parse->eof;
+         bool shifted = false;
+
+         // Reduce until the token is shifted or the parse ends
+         while (!shifted) {
+             int action = get_action(tables, parse->nodes[top].state, token->type);
+             int param = action_value_of(action);
+
+             switch (action_type_of(action)) {
+                 case ACTION_SHIFT:
+                     if (i == parse->num_tokens) {
+                         // The end of input is never shifted
+                         parse->error_token = i;
+                         parse->valid_snapshots = i + 1;
+                         return;
+                     }
+                     top = push_node(parse, param, top);
+                     shifted = true;
+                     break;
+
+                 case ACTION_REDUCE: {
+                     const Production* production = &tables->productions[param];
+                     if ((int)parse->nodes[top].depth < production->rhs_length) {
+                         log_error("Stack underflow during reduction");
+                         parse->error_token = i;
+                         parse->valid_snapshots = i + 1;
+                         return;
+                     }
+                     for (int k = 0; k < production->rhs_length; k++) {
+                         top = parse->nodes[top].parent;
+                     }
+                     int goto_state = get_goto_state(tables, parse->nodes[top].state, production->lhs);
+                     if (goto_state < 0) {
+                         log_error("Invalid goto state for non-terminal %d from state %d",
+                                   production->lhs, parse->nodes[top].state);
+                         parse->error_token = i;
+                         parse->valid_snapshots = i + 1;
+                         return;
+                     }
+                     top = push_node(parse, goto_state, top);
+                     break;
+                 }
+
+                 case ACTION_ACCEPT:
+                     parse->success = true;
+                     parse->valid_snapshots = i + 1;
+                     return;
+
+                 case ACTION_ERROR:
+                 default:
+                     parse->error_token = i;
+                     parse->valid_snapshots = i + 1;
+                     return;
+             }
+         }
+
+         i++;
+         parse->last_shifted++;
+     }
+ }
+
+ /**
+  * Read the tokens of a file and parse them
+  */
+ bool incremental_load(IncrementalParse* parse, const char* input_file, unsigned flags) {
+     // Every token must stay addressable for later edits
+     TokenStream* input = token_stream_open(input_file, flags & ~TOKEN_STREAM_STREAMING);
+     if (!input) {
+         log_error("Failed to open input file: %s", input_file);
+         return false;
+     }
+
+     token_stream_free(parse->input);
+     parse->input = input;
+     parse->num_tokens = 0;
+
+     while (input->current && input->current->type != TOKEN_EOF) {
+         reserve_tokens(parse, parse->num_tokens + 1);
+         parse->tokens[parse->num_tokens++] = get_next_token(input);
+     }
+     parse->eof = input->current;
+     if (!parse->eof) {
+         log_error("Missing end of input in %s", input_file);
+         return false;
+     }
+
+     reset_nodes(parse);
+     reparse(parse, 0, 0, 0, 0, false, -1);
+     return true;
+ }
+
+ /**
+  * Replace a range of tokens and reparse from the first change
+  */
+ bool incremental_edit(IncrementalParse* parse, int start, int removed,
+                       const Token* inserted, int count) {
+     if (!parse || !parse->input || start < 0 || removed < 0 || count < 0 ||
+         start + removed > parse->num_tokens || (count > 0 && !inserted)) {
+         log_error("Invalid edit range");
+         return false;
+     }
+     for (int j = 0; j < count; j++) {
+         if (inserted[j].type >= TOKEN_EOF && inserted[j].type != TOKEN_INVALID) {
+             log_error("Invalid token type in edit: %s", token_type_to_string(inserted[j].type));
+             return false;
+         }
+     }
+
+     int end = start + removed;
+     int delta = count - removed;
+     int old_count = parse->num_tokens;
+     int old_valid = parse->valid_snapshots;
+     bool old_success = parse->success;
+     int old_error = parse->error_token;
+
+     // The snapshot at start only depends on the tokens before it; past
+     // an error there are none, restart at the rejected token
+     int resume = start < old_valid ? start : old_valid - 1;
+     uint32_t top = parse->snapshots[resume];
+
+     // Move the unchanged tail, its snapshots become the old path to meet
+     reserve_tokens(parse, old_count + delta);
+     memmove(&parse->tokens[start + count], &parse->tokens[end],
+             sizeof(Token*) * (old_count - end));
+     memmove(&parse->snapshots[end + delta], &parse->snapshots[end],
+             sizeof(uint32_t) * (old_count - end + 1));
+     parse->num_tokens = old_count + delta;
+
+     for (int j = 0; j < count; j++) {
+         const Token* token = &inserted[j];
+         parse->tokens[start + j] = token_stream_new_token(parse->input, token->type, token->lexeme,
+                                                           token->length, token->line_number,
+                                                           token->position, true);
+     }
+
+     // Keep the stream's token list in sequence order
+     Token* next = start + count < parse->num_tokens ? parse->tokens[start + count] : parse->eof;
+     for (int j = start + count - 1; j >= start; j--) {
+         parse->tokens[j]->next = next;
+         next = parse->tokens[j];
+     }
+     if (start > 0) {
+         parse->tokens[start - 1]->next = next;
+     } else {
+         parse->input->head = next;
+     }
+
+     // Too many dead entries in the pool: parse everything again
+     if (parse->num_nodes > INCREMENTAL_COMPACT_FACTOR * (uint32_t)(parse->num_tokens + 1)) {
+         reset_nodes(parse);
+         reparse(parse, 0, 0, 0, 0, false, -1);
+         return true;
+     }
+
+     reparse(parse, resume, top, start + count, old_valid + delta,
+             old_success, old_success ? -1 : old_error + delta);
+     return true;
+ }
+
+ /**
+  * Token rejected by the current parse
+  */
+ Token* incremental_error_token(const IncrementalParse* parse) {
+     if (!parse || parse->success || parse->error_token < 0) {
+         return NULL;
+     }
+     return parse->error_token < parse->num_tokens ? parse->tokens[parse->error_token] : parse->eof;
+ }
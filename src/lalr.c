@@ -0,0 +1,897 @@
+/**
+ * @file lalr.c
+ * @brief LALR(1) parsing table generator
+ * @members: Group
+ *
+ * Symbols are ints (terminals are TokenType values, non-terminals are
+ * GRAMMAR_NT indices) and an LR(0) item is a single int, the item number
+ * of production p with the dot at d being item_base[p] + d. Lookahead
+ * sets are 64-bit masks over the terminals, so FIRST, FOLLOW and the
+ * lookahead propagation are word-wide ORs.
+ *
+ * The lookaheads are computed as in the dragon book: every kernel item
+ * is closed once with a marker lookahead to find which lookaheads are
+ * generated spontaneously and which propagate between kernel items,
+ * then the propagation links are followed to a fixed point.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdint.h>
+ #include <string.h>
+ #include "../include/lalr.h"
+ #include "../include/automaton.h"
+ #include "../include/utils.h"
+
+ // Lookahead set, bit t for terminal t
+ typedef uint64_t LookaheadSet;
+
+ #define LA_BIT(terminal) ((LookaheadSet)1 << (terminal))
+
+ // Marker lookahead for the propagation pass, outside the terminal range
+ #define LA_PROPAGATE ((LookaheadSet)1 << 63)
+
+ _Static_assert(GRAMMAR_TERMINALS < 63, "terminals must fit in a LookaheadSet");
+
+ // Action table columns, one per TokenType like the built-in tables
+ #define NUM_TERMINALS (TOKEN_NON_TERMINAL + 1)
+
+ // Name of the non-terminal of the added augmented rule
+ #define ACCEPT_NAME "$accept"
+
+ /**
+  * Propagation link between two kernel items
+  */
+ typedef struct {
+     int from;  // Kernel slot the lookaheads come from
+     int to;    // Kernel slot they flow into
+ } LalrLink;
+
+ /**
+  * Generator state
+  */
+ typedef struct {
+     const Grammar* grammar;
+
+     // Productions including the augmented one, 0..num_productions
+     int num_productions;
+     int* lhs;               // Left-hand side non-terminal index
+     const int** rhs;        // Right-hand side symbols
+     int* rhs_length;
+     int accept_production;  // Production whose completion accepts
+     int start;              // Non-terminal derived by the accepting production
+     int start_symbol;       // Right-hand side of an added $accept → start
+     int num_non_terminals;  // Including $accept when it was added
+     int num_symbols;        // GRAMMAR_TERMINALS + num_non_terminals
+
+     // Productions grouped by left-hand side
+     int* nt_first;          // [nt]..[nt + 1] index nt_productions
+     int* nt_productions;
+
+     // LR(0) items
+     int num_items;
+     int* item_base;         // Item of (p, 0)
+     int* item_production;
+     int* item_dot;
+
+     // FIRST and FOLLOW
+     bool* nullable;
+     LookaheadSet* first;
+     LookaheadSet* follow;
+
+     // States as sorted kernel item lists
+     int num_states;
+     int states_capacity;
+     int* kernel_start;      // [s]..[s + 1] index kernel_items
+     int* kernel_items;
+     int kernel_capacity;
+     int* transitions;       // [s * num_symbols + symbol], -1 for none
+     int* hash_buckets;      // Kernel hash -> first state
+     int* hash_next;         // Next state in the same bucket
+     int hash_size;
+
+     // Lookaheads per kernel slot (same indexing as kernel_items)
+     LookaheadSet* lookaheads;
+     LalrLink* links;
+     int num_links;
+     int links_capacity;
+
+     // Scratch space for closures
+     int* closure;           // Items of the current closure
+     int closure_size;
+     LookaheadSet* closure_la; // Lookaheads per item in the current closure
+     int* item_stamp;        // Item is in the closure when equal to stamp
+     int* nt_stamp;          // Non-terminal expanded when equal to stamp
+     int stamp;
+     int* worklist;
+     bool* queued;
+     int* buckets;           // Closure items ordered by next symbol
+     int* bucket_start;
+ } Lalr;
+
+ // Display text for terminals in rule strings, same as the built-in rules
+ static const char* TERMINAL_TEXT[GRAMMAR_TERMINALS] = { "NUM", "+", "*", "(", ")", "$" };
+
+ /**
+  * Allocate zero-filled memory
+  */
+ static void* zero_alloc(size_t size) {
+     void* memory = safe_malloc(size);
+     memset(memory, 0, size);
+     return memory;
+ }
+
+ /**
+  * Symbol after the dot of an item, -1 if the item is complete
+  */
+ static inline int next_symbol(const Lalr* lalr, int item) {
+     int production = lalr->item_production[item];
+     int dot = lalr->item_dot[item];
+     return dot < lalr->rhs_length[production] ? lalr->rhs[production][dot] : -1;
+ }
+
+ /**
+  * Name of a symbol, including the added $accept
+  */
+ static const char* symbol_name(const Lalr* lalr, int symbol) {
+     if (GRAMMAR_IS_NT(symbol) && GRAMMAR_NT_INDEX(symbol) == lalr->grammar->num_non_terminals) {
+         return ACCEPT_NAME;
+     }
+     return grammar_symbol_name(lalr->grammar, symbol);
+ }
+
+ /**
+  * Set up productions, choosing or adding the accepting production
+  */
+ static void setup_productions(Lalr* lalr) {
+     const Grammar* grammar = lalr->grammar;
+     const GrammarRule* first_rule = &grammar->rules[1];
+     int start_nt = first_rule->lhs;
+
+     // The first rule accepts directly if it is s → X with s unused elsewhere
+     bool unit_start = first_rule->rhs_length == 1 && GRAMMAR_IS_NT(first_rule->rhs[0]);
+     for (int i = 1; unit_start && i <= grammar->num_rules; i++) {
+         if (i > 1 && grammar->rules[i].lhs == start_nt) {
+             unit_start = false;
+         }
+         for (int j = 0; j < grammar->rules[i].rhs_length; j++) {
+             if (grammar->rules[i].rhs[j] == GRAMMAR_NT(start_nt)) {
+                 unit_start = false;
+             }
+         }
+     }
+
+     lalr->num_productions = grammar->num_rules;
+     lalr->num_non_terminals = grammar->num_non_terminals + (unit_start ? 0 : 1);
+     lalr->num_symbols = GRAMMAR_TERMINALS + lalr->num_non_terminals;
+     lalr->lhs = (int*)safe_malloc(sizeof(int) * (lalr->num_productions + 1));
+     lalr->rhs = (const int**)safe_malloc(sizeof(int*) * (lalr->num_productions + 1));
+     lalr->rhs_length = (int*)safe_malloc(sizeof(int) * (lalr->num_productions + 1));
+
+     for (int i = 1; i <= grammar->num_rules; i++) {
+         lalr->lhs[i] = grammar->rules[i].lhs;
+         lalr->rhs[i] = grammar->rules[i].rhs;
+         lalr->rhs_length[i] = grammar->rules[i].rhs_length;
+     }
+
+     if (unit_start) {
+         lalr->accept_production = 1;
+         lalr->start = GRAMMAR_NT_INDEX(first_rule->rhs[0]);
+         lalr->lhs[0] = 0;
+         lalr->rhs[0] = NULL;
+         lalr->rhs_length[0] = 0;
+     } else {
+         // Production 0 is $accept → start
+         lalr->accept_production = 0;
+         lalr->start = start_nt;
+         lalr->start_symbol = GRAMMAR_NT(start_nt);
+         lalr->lhs[0] = grammar->num_non_terminals;
+         lalr->rhs[0] = &lalr->start_symbol;
+         lalr->rhs_length[0] = 1;
+     }
+
+     // Group productions by left-hand side (production 0 of the unit
+     // start case is empty and never expanded)
+     int first_production = unit_start ? 1 : 0;
+     lalr->nt_first = (int*)zero_alloc(sizeof(int) * (lalr->num_non_terminals + 1));
+     lalr->nt_productions = (int*)safe_malloc(sizeof(int) * (lalr->num_productions + 1));
+     for (int p = first_production; p <= lalr->num_productions; p++) {
+         lalr->nt_first[lalr->lhs[p] + 1]++;
+     }
+     for (int nt = 0; nt < lalr->num_non_terminals; nt++) {
+         lalr->nt_first[nt + 1] += lalr->nt_first[nt];
+     }
+     int* fill = (int*)safe_malloc(sizeof(int) * (lalr->num_non_terminals + 1));
+     memcpy(fill, lalr->nt_first, sizeof(int) * (lalr->num_non_terminals + 1));
+     for (int p = first_production; p <= lalr->num_productions; p++) {
+         lalr->nt_productions[fill[lalr->lhs[p]]++] = p;
+     }
+     free(fill);
+
+     // Number the LR(0) items
+     lalr->item_base = (int*)safe_malloc(sizeof(int) * (lalr->num_productions + 1));
+     lalr->num_items = 0;
+     for (int p = 0; p <= lalr->num_productions; p++) {
+         lalr->item_base[p] = lalr->num_items;
+         lalr->num_items += lalr->rhs_length[p] + 1;
+     }
+     lalr->item_production = (int*)safe_malloc(sizeof(int) * lalr->num_items);
+     lalr->item_dot = (int*)safe_malloc(sizeof(int) * lalr->num_items);
+     for (int p = 0; p <= lalr->num_productions; p++) {
+         for (int d = 0; d <= lalr->rhs_length[p]; d++) {
+             lalr->item_production[lalr->item_base[p] + d] = p;
+             lalr->item_dot[lalr->item_base[p] + d] = d;
+         }
+     }
+ }
+
+ /**
+  * FIRST of rhs[dot..] of a production, plus tail if it can be empty
+  */
+ static LookaheadSet first_of_suffix(const Lalr* lalr, int production, int dot, LookaheadSet tail) {
+     LookaheadSet result = 0;
+
+     for (int i = dot; i < lalr->rhs_length[production]; i++) {
+         int symbol = lalr->rhs[production][i];
+         if (!GRAMMAR_IS_NT(symbol)) {
+             return result | LA_BIT(symbol);
+         }
+         int nt = GRAMMAR_NT_INDEX(symbol);
+         result |= lalr->first[nt];
+         if (!lalr->nullable[nt]) {
+             return result;
+         }
+     }
+     return result | tail;
+ }
+
+ /**
+  * Compute nullable, FIRST and FOLLOW to a fixed point
+  */
+ static void compute_first_follow(Lalr* lalr) {
+     int count = lalr->num_non_terminals;
+     lalr->nullable = (bool*)zero_alloc(sizeof(bool) * count);
+     lalr->first = (LookaheadSet*)zero_alloc(sizeof(LookaheadSet) * count);
+     lalr->follow = (LookaheadSet*)zero_alloc(sizeof(LookaheadSet) * count);
+
+     bool changed = true;
+     while (changed) {
+         changed = false;
+         for (int p = 0; p <= lalr->num_productions; p++) {
+             if (p == 0 && lalr->accept_production != 0) {
+                 continue;
+             }
+             int nt = lalr->lhs[p];
+             LookaheadSet first = first_of_suffix(lalr, p, 0, 0);
+             bool nullable = true;
+             for (int i = 0; nullable && i < lalr->rhs_length[p]; i++) {
+                 int symbol = lalr->rhs[p][i];
+                 nullable = GRAMMAR_IS_NT(symbol) && lalr->nullable[GRAMMAR_NT_INDEX(symbol)];
+             }
+             if ((lalr->first[nt] | first) != lalr->first[nt] || (nullable && !lalr->nullable[nt])) {
+                 lalr->first[nt] |= first;
+                 lalr->nullable[nt] |= nullable;
+                 changed = true;
+             }
+         }
+     }
+
+     lalr->follow[lalr->start] = LA_BIT(TOKEN_EOF);
+     lalr->follow[lalr->lhs[lalr->accept_production]] = LA_BIT(TOKEN_EOF);
+     changed = true;
+     while (changed) {
+         changed = false;
+         for (int p = 1; p <= lalr->num_productions; p++) {
+             for (int i = 0; i < lalr->rhs_length[p]; i++) {
+                 int symbol = lalr->rhs[p][i];
+                 if (!GRAMMAR_IS_NT(symbol)) {
+                     continue;
+                 }
+                 int nt = GRAMMAR_NT_INDEX(symbol);
+                 LookaheadSet follow = first_of_suffix(lalr, p, i + 1, lalr->follow[lalr->lhs[p]]);
+                 if ((lalr->follow[nt] | follow) != lalr->follow[nt]) {
+                     lalr->follow[nt] |= follow;
+                     changed = true;
+                 }
+             }
+         }
+     }
+ }
+
+ /**
+  * Hash of a sorted kernel item list
+  */
+ static unsigned hash_kernel(const int* items, int count) {
+     unsigned hash = 2166136261u;
+     for (int i = 0; i < count; i++) {
+         hash = (hash ^ (unsigned)items[i]) * 16777619u;
+     }
+     return hash;
+ }
+
+ /**
+  * Rebuild the kernel hash with twice as many buckets
+  */
+ static void grow_hash(Lalr* lalr) {
+     lalr->hash_size *= 2;
+     free(lalr->hash_buckets);
+     lalr->hash_buckets = (int*)safe_malloc(sizeof(int) * lalr->hash_size);
+     for (int i = 0; i < lalr->hash_size; i++) {
+         lalr->hash_buckets[i] = -1;
+     }
+     for (int s = 0; s < lalr->num_states; s++) {
+         const int* items = &lalr->kernel_items[lalr->kernel_start[s]];
+         int count = lalr->kernel_start[s + 1] - lalr->kernel_start[s];
+         unsigned bucket = hash_kernel(items, count) & (lalr->hash_size - 1);
+         lalr->hash_next[s] = lalr->hash_buckets[bucket];
+         lalr->hash_buckets[bucket] = s;
+     }
+ }
+
+ /**
+  * Find the state with this kernel, adding it if it is new
+  */
+ static int find_or_add_state(Lalr* lalr, const int* items, int count) {
+     unsigned hash = hash_kernel(items, count);
+
+     for (int s = lalr->hash_buckets[hash & (lalr->hash_size - 1)]; s >= 0; s = lalr->hash_next[s]) {
+         int start = lalr->kernel_start[s];
+         if (lalr->kernel_start[s + 1] - start == count &&
+             memcmp(&lalr->kernel_items[start], items, sizeof(int) * count) == 0) {
+             return s;
+         }
+     }
+
+     if (lalr->num_states + 1 >= lalr->states_capacity) {
+         lalr->states_capacity *= 2;
+         lalr->kernel_start = (int*)safe_realloc(lalr->kernel_start, sizeof(int) * (lalr->states_capacity + 1));
+         lalr->hash_next = (int*)safe_realloc(lalr->hash_next, sizeof(int) * lalr->states_capacity);
+         lalr->transitions = (int*)safe_realloc(lalr->transitions,
+                                                sizeof(int) * lalr->states_capacity * lalr->num_symbols);
+     }
+     int used = lalr->kernel_start[lalr->num_states];
+     if (used + count > lalr->kernel_capacity) {
+         while (used + count > lalr->kernel_capacity) {
+             lalr->kernel_capacity *= 2;
+         }
+         lalr->kernel_items = (int*)safe_realloc(lalr->kernel_items, sizeof(int) * lalr->kernel_capacity);
+     }
+
+     int state = lalr->num_states++;
+     memcpy(&lalr->kernel_items[used], items, sizeof(int) * count);
+     lalr->kernel_start[state + 1] = used + count;
+     for (int x = 0; x < lalr->num_symbols; x++) {
+         lalr->transitions[state * lalr->num_symbols + x] = -1;
+     }
+
+     if (lalr->num_states > lalr->hash_size / 2) {
+         grow_hash(lalr);
+     } else {
+         unsigned bucket = hash & (lalr->hash_size - 1);
+         lalr->hash_next[state] = lalr->hash_buckets[bucket];
+         lalr->hash_buckets[bucket] = state;
+     }
+     return state;
+ }
+
+ /**
+  * LR(0) closure of a state's kernel into lalr->closure
+  */
+ static void closure_lr0(Lalr* lalr, int state) {
+     lalr->stamp++;
+     lalr->closure_size = 0;
+
+     for (int k = lalr->kernel_start[state]; k < lalr->kernel_start[state + 1]; k++) {
+         lalr->closure[lalr->closure_size++] = lalr->kernel_items[k];
+     }
+     for (int i = 0; i < lalr->closure_size; i++) {
+         int symbol = next_symbol(lalr, lalr->closure[i]);
+         if (symbol < 0 || !GRAMMAR_IS_NT(symbol)) {
+             continue;
+         }
+         int nt = GRAMMAR_NT_INDEX(symbol);
+         if (lalr->nt_stamp[nt] == lalr->stamp) {
+             continue;
+         }
+         lalr->nt_stamp[nt] = lalr->stamp;
+         for (int j = lalr->nt_first[nt]; j < lalr->nt_first[nt + 1]; j++) {
+             lalr->closure[lalr->closure_size++] = lalr->item_base[lalr->nt_productions[j]];
+         }
+     }
+ }
+
+ static int compare_ints(const void* a, const void* b) {
+     int x = *(const int*)a;
+     int y = *(const int*)b;
+     return (x > y) - (x < y);
+ }
+
+ /**
+  * Build the LR(0) automaton breadth first from the accepting item
+  */
+ static void build_states(Lalr* lalr) {
+     lalr->states_capacity = 64;
+     lalr->kernel_capacity = 256;
+     lalr->hash_size = 128;
+     lalr->kernel_start = (int*)safe_malloc(sizeof(int) * (lalr->states_capacity + 1));
+     lalr->kernel_items = (int*)safe_malloc(sizeof(int) * lalr->kernel_capacity);
+     lalr->hash_next = (int*)safe_malloc(sizeof(int) * lalr->states_capacity);
+     lalr->transitions = (int*)safe_malloc(sizeof(int) * lalr->states_capacity * lalr->num_symbols);
+     lalr->hash_buckets = (int*)safe_malloc(sizeof(int) * lalr->hash_size);
+     for (int i = 0; i < lalr->hash_size; i++) {
+         lalr->hash_buckets[i] = -1;
+     }
+     lalr->kernel_start[0] = 0;
+     lalr->num_states = 0;
+
+     // Each item appears at most once in a closure
+     lalr->closure = (int*)safe_malloc(sizeof(int) * lalr->num_items);
+     lalr->closure_la = (LookaheadSet*)zero_alloc(sizeof(LookaheadSet) * lalr->num_items);
+     lalr->item_stamp = (int*)zero_alloc(sizeof(int) * lalr->num_items);
+     lalr->nt_stamp = (int*)zero_alloc(sizeof(int) * lalr->num_non_terminals);
+     lalr->worklist = (int*)safe_malloc(sizeof(int) * lalr->num_items);
+     lalr->queued = (bool*)zero_alloc(sizeof(bool) * lalr->num_items);
+     lalr->buckets = (int*)safe_malloc(sizeof(int) * lalr->num_items);
+     lalr->bucket_start = (int*)safe_malloc(sizeof(int) * (lalr->num_symbols + 1));
+     lalr->stamp = 0;
+
+     int initial = lalr->item_base[lalr->accept_production];
+     find_or_add_state(lalr, &initial, 1);
+
+     int* kernel = (int*)safe_malloc(sizeof(int) * lalr->num_items);
+     for (int state = 0; state < lalr->num_states; state++) {
+         closure_lr0(lalr, state);
+
+         // Order the closure items by the symbol after the dot
+         memset(lalr->bucket_start, 0, sizeof(int) * (lalr->num_symbols + 1));
+         for (int i = 0; i < lalr->closure_size; i++) {
+             int symbol = next_symbol(lalr, lalr->closure[i]);
+             if (symbol >= 0) {
+                 lalr->bucket_start[symbol + 1]++;
+             }
+         }
+         for (int x = 0; x < lalr->num_symbols; x++) {
+             lalr->bucket_start[x + 1] += lalr->bucket_start[x];
+         }
+         for (int i = 0; i < lalr->closure_size; i++) {
+             int symbol = next_symbol(lalr, lalr->closure[i]);
+             if (symbol >= 0) {
+                 lalr->buckets[lalr->bucket_start[symbol]++] = lalr->closure[i] + 1;
+             }
+         }
+         // bucket_start[x] is now the end of bucket x, shift back
+         for (int x = lalr->num_symbols; x > 0; x--) {
+             lalr->bucket_start[x] = lalr->bucket_start[x - 1];
+         }
+         lalr->bucket_start[0] = 0;
+
+         for (int x = 0; x < lalr->num_symbols; x++) {
+             int count = lalr->bucket_start[x + 1] - lalr->bucket_start[x];
+             if (count == 0) {
+                 continue;
+             }
+             memcpy(kernel, &lalr->buckets[lalr->bucket_start[x]], sizeof(int) * count);
+             qsort(kernel, count, sizeof(int), compare_ints);
+             int target = find_or_add_state(lalr, kernel, count);
+             lalr->transitions[state * lalr->num_symbols + x] = target;
+         }
+     }
+     free(kernel);
+ }
+
+ /**
+  * Kernel slot of an item in a state (kernels are sorted)
+  */
+ static int kernel_slot(const Lalr* lalr, int state, int item) {
+     int low = lalr->kernel_start[state];
+     int high = lalr->kernel_start[state + 1] - 1;
+
+     while (low <= high) {
+         int mid = (low + high) / 2;
+         if (lalr->kernel_items[mid] == item) {
+             return mid;
+         }
+         if (lalr->kernel_items[mid] < item) {
+             low = mid + 1;
+         } else {
+             high = mid - 1;
+         }
+     }
+     return -1;
+ }
+
+ /**
+  * Add lookaheads to a closure item, queueing it if they are new
+  */
+ static inline void closure_add(Lalr* lalr, int item, LookaheadSet la, int* tail) {
+     if (lalr->item_stamp[item] != lalr->stamp) {
+         lalr->item_stamp[item] = lalr->stamp;
+         lalr->closure_la[item] = 0;
+         lalr->closure[lalr->closure_size++] = item;
+     }
+     if ((lalr->closure_la[item] | la) != lalr->closure_la[item]) {
+         lalr->closure_la[item] |= la;
+         if (!lalr->queued[item]) {
+             lalr->queued[item] = true;
+             lalr->worklist[(*tail)++ % lalr->num_items] = item;
+         }
+     }
+ }
+
+ /**
+  * LR(1) closure of the given kernel slots of a state. A kernel slot
+  * starts with propagate (when >= 0 only that slot is used) or with its
+  * current lookaheads. Results are in closure / closure_la.
+  */
+ static void closure_lr1(Lalr* lalr, int state, int only_slot, LookaheadSet seed) {
+     lalr->stamp++;
+     lalr->closure_size = 0;
+     int head = 0;
+     int tail = 0;
+
+     for (int k = lalr->kernel_start[state]; k < lalr->kernel_start[state + 1]; k++) {
+         if (only_slot < 0) {
+             closure_add(lalr, lalr->kernel_items[k], lalr->lookaheads[k], &tail);
+         } else if (k == only_slot) {
+             closure_add(lalr, lalr->kernel_items[k], seed, &tail);
+         }
+     }
+
+     while (head != tail) {
+         int item = lalr->worklist[head++ % lalr->num_items];
+         lalr->queued[item] = false;
+
+         int symbol = next_symbol(lalr, item);
+         if (symbol < 0 || !GRAMMAR_IS_NT(symbol)) {
+             continue;
+         }
+         int nt = GRAMMAR_NT_INDEX(symbol);
+         LookaheadSet la = first_of_suffix(lalr, lalr->item_production[item],
+                                           lalr->item_dot[item] + 1, lalr->closure_la[item]);
+         for (int j = lalr->nt_first[nt]; j < lalr->nt_first[nt + 1]; j++) {
+             closure_add(lalr, lalr->item_base[lalr->nt_productions[j]], la, &tail);
+         }
+     }
+ }
+
+ /**
+  * Compute the LALR(1) lookaheads of every kernel item
+  */
+ static void compute_lookaheads(Lalr* lalr) {
+     int kernel_count = lalr->kernel_start[lalr->num_states];
+     lalr->lookaheads = (LookaheadSet*)zero_alloc(sizeof(LookaheadSet) * kernel_count);
+     lalr->links_capacity = 256;
+     lalr->links = (LalrLink*)safe_malloc(sizeof(LalrLink) * lalr->links_capacity);
+     lalr->num_links = 0;
+
+     // Spontaneous lookaheads and propagation links
+     for (int state = 0; state < lalr->num_states; state++) {
+         for (int k = lalr->kernel_start[state]; k < lalr->kernel_start[state + 1]; k++) {
+             closure_lr1(lalr, state, k, LA_PROPAGATE);
+             for (int i = 0; i < lalr->closure_size; i++) {
+                 int item = lalr->closure[i];
+                 int symbol = next_symbol(lalr, item);
+                 if (symbol < 0) {
+                     continue;
+                 }
+                 int target = lalr->transitions[state * lalr->num_symbols + symbol];
+                 int slot = kernel_slot(lalr, target, item + 1);
+                 LookaheadSet la = lalr->closure_la[item];
+
+                 lalr->lookaheads[slot] |= la & ~LA_PROPAGATE;
+                 if (la & LA_PROPAGATE) {
+                     if (lalr->num_links == lalr->links_capacity) {
+                         lalr->links_capacity *= 2;
+                         lalr->links = (LalrLink*)safe_realloc(lalr->links,
+                                                               sizeof(LalrLink) * lalr->links_capacity);
+                     }
+                     lalr->links[lalr->num_links].from = k;
+                     lalr->links[lalr->num_links].to = slot;
+                     lalr->num_links++;
+                 }
+             }
+         }
+     }
+
+     // End of input follows the start item
+     lalr->lookaheads[kernel_slot(lalr, 0, lalr->item_base[lalr->accept_production])] |= LA_BIT(TOKEN_EOF);
+
+     bool changed = true;
+     while (changed) {
+         changed = false;
+         for (int i = 0; i < lalr->num_links; i++) {
+             LookaheadSet from = lalr->lookaheads[lalr->links[i].from];
+             LookaheadSet* to = &lalr->lookaheads[lalr->links[i].to];
+             if ((*to | from) != *to) {
+                 *to |= from;
+                 changed = true;
+             }
+         }
+     }
+ }
+
+ /**
+  * Rule string like the built-in ones, e.g. "e → e + t"
+  */
+ static char* rule_string(const Lalr* lalr, int production) {
+     char* text = string_format("%s →", symbol_name(lalr, GRAMMAR_NT(lalr->lhs[production])));
+
+     if (lalr->rhs_length[production] == 0) {
+         return string_append(text, " ε");
+     }
+     for (int i = 0; i < lalr->rhs_length[production]; i++) {
+         int symbol = lalr->rhs[production][i];
+         text = string_append(text, " ");
+         text = string_append(text, GRAMMAR_IS_NT(symbol) ? symbol_name(lalr, symbol) : TERMINAL_TEXT[symbol]);
+     }
+     return text;
+ }
+
+ /**
+  * Print a lookahead set as terminal names
+  */
+ static void print_set(FILE* out, LookaheadSet set) {
+     fprintf(out, "{");
+     const char* separator = " ";
+     for (int t = 0; t < GRAMMAR_TERMINALS; t++) {
+         if (set & LA_BIT(t)) {
+             fprintf(out, "%s%s", separator, token_type_to_string((TokenType)t));
+             separator = ", ";
+         }
+     }
+     fprintf(out, " }");
+ }
+
+ /**
+  * Print an item as "e → e . + t"
+  */
+ static void print_item(FILE* out, const Lalr* lalr, int item) {
+     int production = lalr->item_production[item];
+     int dot = lalr->item_dot[item];
+
+     fprintf(out, "%s →", symbol_name(lalr, GRAMMAR_NT(lalr->lhs[production])));
+     for (int i = 0; i <= lalr->rhs_length[production]; i++) {
+         if (i == dot) {
+             fprintf(out, " .");
+         }
+         if (i < lalr->rhs_length[production]) {
+             fprintf(out, " %s", symbol_name(lalr, lalr->rhs[production][i]));
+         }
+     }
+ }
+
+ /**
+  * Fill one state's action row from its LR(1) closure
+  */
+ static void fill_actions(Lalr* lalr, int state, uint16_t* actions, LalrReport* report) {
+     uint16_t* row = &actions[state * NUM_TERMINALS];
+
+     for (int t = 0; t < GRAMMAR_TERMINALS; t++) {
+         int target = lalr->transitions[state * lalr->num_symbols + t];
+         if (target >= 0) {
+             row[t] = (uint16_t)automaton_create_action(ACTION_SHIFT, target);
+         }
+     }
+
+     closure_lr1(lalr, state, -1, 0);
+     for (int i = 0; i < lalr->closure_size; i++) {
+         int item = lalr->closure[i];
+         if (next_symbol(lalr, item) >= 0) {
+             continue;
+         }
+         int production = lalr->item_production[item];
+         LookaheadSet la = lalr->closure_la[item];
+
+         if (production == lalr->accept_production) {
+             if (la & LA_BIT(TOKEN_EOF)) {
+                 row[TOKEN_EOF] = (uint16_t)automaton_create_action(ACTION_ACCEPT, 0);
+             }
+             continue;
+         }
+
+         for (int t = 0; t < GRAMMAR_TERMINALS; t++) {
+             if (!(la & LA_BIT(t))) {
+                 continue;
+             }
+             int existing = row[t];
+             ActionType type = action_type_of(existing);
+
+             if (type == ACTION_ERROR) {
+                 row[t] = (uint16_t)automaton_create_action(ACTION_REDUCE, production);
+             } else if (type == ACTION_SHIFT) {
+                 char* rule = rule_string(lalr, production);
+                 log_error("Conflict in state %d on %s: shift/reduce with rule %d (%s), using shift",
+                           state, token_type_to_string((TokenType)t), production, rule);
+                 free(rule);
+                 report->shift_reduce++;
+             } else if (type == ACTION_REDUCE) {
+                 int other = action_value_of(existing);
+                 int kept = other < production ? other : production;
+                 log_error("Conflict in state %d on %s: reduce/reduce between rules %d and %d, using rule %d",
+                           state, token_type_to_string((TokenType)t), other, production, kept);
+                 row[t] = (uint16_t)automaton_create_action(ACTION_REDUCE, kept);
+                 report->reduce_reduce++;
+             } else {
+                 log_error("Conflict in state %d on %s: accept/reduce with rule %d, using accept",
+                           state, token_type_to_string((TokenType)t), production);
+                 report->reduce_reduce++;
+             }
+         }
+     }
+ }
+
+ /**
+  * Write the sets and states in readable form
+  */
+ static void write_listing(FILE* out, const Lalr* lalr) {
+     fprintf(out, "Non-terminals:\n");
+     for (int nt = 0; nt < lalr->num_non_terminals; nt++) {
+         fprintf(out, "  %-12s nullable=%s FIRST=", symbol_name(lalr, GRAMMAR_NT(nt)),
+                 lalr->nullable[nt] ? "yes" : "no");
+         print_set(out, lalr->first[nt]);
+         fprintf(out, " FOLLOW=");
+         print_set(out, lalr->follow[nt]);
+         fprintf(out, "\n");
+     }
+
+     for (int state = 0; state < lalr->num_states; state++) {
+         fprintf(out, "\nState %d:\n", state);
+         for (int k = lalr->kernel_start[state]; k < lalr->kernel_start[state + 1]; k++) {
+             fprintf(out, "  ");
+             print_item(out, lalr, lalr->kernel_items[k]);
+             fprintf(out, ", ");
+             print_set(out, lalr->lookaheads[k]);
+             fprintf(out, "\n");
+         }
+         for (int x = 0; x < lalr->num_symbols; x++) {
+             int target = lalr->transitions[state * lalr->num_symbols + x];
+             if (target >= 0) {
+                 fprintf(out, "    %s -> %d\n", symbol_name(lalr, x), target);
+             }
+         }
+     }
+ }
+
+ /**
+  * Release the generator state
+  */
+ static void lalr_free(Lalr* lalr) {
+     free(lalr->lhs);
+     free(lalr->rhs);
+     free(lalr->rhs_length);
+     free(lalr->nt_first);
+     free(lalr->nt_productions);
+     free(lalr->item_base);
+     free(lalr->item_production);
+     free(lalr->item_dot);
+     free(lalr->nullable);
+     free(lalr->first);
+     free(lalr->follow);
+     free(lalr->kernel_start);
+     free(lalr->kernel_items);
+     free(lalr->transitions);
+     free(lalr->hash_buckets);
+     free(lalr->hash_next);
+     free(lalr->lookaheads);
+     free(lalr->links);
+     free(lalr->closure);
+     free(lalr->closure_la);
+     free(lalr->item_stamp);
+     free(lalr->nt_stamp);
+     free(lalr->worklist);
+     free(lalr->queued);
+     free(lalr->buckets);
+     free(lalr->bucket_start);
+ }
+
+ /**
+  * Build LALR(1) parsing tables for a grammar
+  */
+ ParsingTables* lalr_build(const Grammar* grammar, LalrReport* report, FILE* listing) {
+     LalrReport summary = { 0, 0, 0 };
+     Lalr lalr;
+     memset(&lalr, 0, sizeof(lalr));
+     lalr.grammar = grammar;
+
+     if (!grammar || grammar->num_rules == 0) {
+         log_error("Cannot build tables for an empty grammar");
+         return NULL;
+     }
+     if (grammar->num_rules > ACTION_VALUE_MAX) {
+         log_error("Grammar has %d rules, at most %d are supported", grammar->num_rules,
+                   ACTION_VALUE_MAX);
+         return NULL;
+     }
+
+     setup_productions(&lalr);
+     compute_first_follow(&lalr);
+     build_states(&lalr);
+
+     if (lalr.num_states > ACTION_VALUE_MAX) {
+         log_error("Grammar needs %d states, at most %d are supported", lalr.num_states,
+                   ACTION_VALUE_MAX);
+         lalr_free(&lalr);
+         return NULL;
+     }
+
+     compute_lookaheads(&lalr);
+     summary.num_states = lalr.num_states;
+
+     // Action and goto tables in the same layout as the built-in ones
+     uint16_t* actions = (uint16_t*)safe_malloc(sizeof(uint16_t) * lalr.num_states * NUM_TERMINALS);
+     int16_t* gotos = (int16_t*)safe_malloc(sizeof(int16_t) * lalr.num_states * lalr.num_non_terminals);
+     for (int i = 0; i < lalr.num_states * NUM_TERMINALS; i++) {
+         actions[i] = (uint16_t)automaton_create_action(ACTION_ERROR, 0);
+     }
+     for (int state = 0; state < lalr.num_states; state++) {
+         fill_actions(&lalr, state, actions, &summary);
+         for (int nt = 0; nt < lalr.num_non_terminals; nt++) {
+             int target = lalr.transitions[state * lalr.num_symbols + GRAMMAR_NT(nt)];
+             gotos[state * lalr.num_non_terminals + nt] = (int16_t)target;
+         }
+     }
+
+     // Productions with right-hand sides in the Production encoding
+     // (terminals as TokenType, non-terminals as their index)
+     Production* productions = (Production*)safe_malloc(sizeof(Production) * (lalr.num_productions + 1));
+     for (int p = 0; p <= lalr.num_productions; p++) {
+         int* rhs = NULL;
+         if (lalr.rhs_length[p] > 0) {
+             rhs = (int*)safe_malloc(sizeof(int) * lalr.rhs_length[p]);
+             for (int i = 0; i < lalr.rhs_length[p]; i++) {
+                 int symbol = lalr.rhs[p][i];
+                 rhs[i] = GRAMMAR_IS_NT(symbol) ? GRAMMAR_NT_INDEX(symbol) : symbol;
+             }
+         }
+         productions[p].lhs = lalr.lhs[p];
+         productions[p].rhs = rhs;
+         productions[p].rhs_length = lalr.rhs_length[p];
+         productions[p].rule_string = (p == 0 && lalr.accept_production != 0)
+                                      ? safe_strdup("")
+                                      : rule_string(&lalr, p);
+     }
+
+     const char** names = (const char**)safe_malloc(sizeof(char*) * lalr.num_non_terminals);
+     for (int nt = 0; nt < lalr.num_non_terminals; nt++) {
+         names[nt] = safe_strdup(symbol_name(&lalr, GRAMMAR_NT(nt)));
+     }
+
+     ParsingTables* tables = (ParsingTables*)safe_malloc(sizeof(ParsingTables));
+     tables->action_table = actions;
+     tables->goto_table = gotos;
+     tables->num_states = lalr.num_states;
+     tables->num_terminals = NUM_TERMINALS;
+     tables->num_non_terminals = lalr.num_non_terminals;
+     tables->non_terminal_names = names;
+     tables->productions = productions;
+     tables->num_productions = lalr.num_productions;
+     tables->is_static = false;
+     tables->cache_map = NULL;
+     tables->cache_size = 0;
+     automaton_build_expected(tables);
+
+     if (listing) {
+         write_listing(listing, &lalr);
+     }
+
+     lalr_free(&lalr);
+
+     if (report) {
+         *report = summary;
+     }
+     return tables;
+ }
+
+ /**
+  * Read a grammar file and build its LALR(1) tables
+  */
+ ParsingTables* lalr_build_from_file(const char* filename, LalrReport* report) {
+     Grammar* grammar = grammar_load(filename);
+     if (!grammar) {
+         return NULL;
+     }
+
+     ParsingTables* tables = lalr_build(grammar, report, NULL);
+     grammar_free(grammar);
+     return tables;
+ }
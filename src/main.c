@@ -10,45 +10,196 @@
  #include <stdbool.h>
  #include "../include/parser.h"
  #include "../include/utils.h"
+ #include "../include/lalr.h"
+ #include "../include/table_cache.h"
+ #include "../include/batch.h"
+ #include "../include/split.h"
+ #include "../include/incremental.h"
+ #include "../include/collapse.h"
+ #include "../include/automaton.h"
+ 
+ // Longest line of an edit script
+ #define EDIT_MAX_LINE 4096
+ 
+ // Most tokens inserted by one edit
+ #define EDIT_MAX_TOKENS 256
  
  /**
   * Print program usage information
   */
  void print_usage(const char* program_name) {
-     printf("Usage: %s <input_file>\n", program_name);
+     printf("Usage: %s [options] <input_file>\n", program_name);
+     printf("       %s --batch [options] [<file|directory>...]\n", program_name);
      printf("  <input_file>: Path to the input file (.cscn)\n");
      printf("  Output will be saved to <input_file>_p3dbg.txt\n");
+     printf("Options:\n");
+     printf("  --trace=<level>: off, summary, file, console or binary (default: console)\n");
+     printf("  --mmap: Memory-map the input file and scan it in place\n");
+     printf("  --stream: Recycle consumed tokens instead of keeping the whole input\n");
+     printf("  --eval: Evaluate the expression while parsing and print its value\n");
+     printf("  --ast: Build the syntax tree while parsing and print it\n");
+     printf("  --recover[=<n>]: Recover from syntax errors and report up to n of them (default: %d)\n",
+            PARSER_DEFAULT_MAX_ERRORS);
+     printf("  --batch: Parse many files with one parser, paths from stdin when none are given\n");
+     printf("  --split[=<category>]: Parse each line of the input as its own expression in parallel, or the\n");
+     printf("          tokens between delimiter tokens of the category (such as SEMI for <;, SEMI>)\n");
+     printf("  --jobs=<n>: Worker threads for --batch and --split (default: one per processor)\n");
+     printf("  --edits <file>: Apply the edits of a script to the input, reparsing incrementally\n");
+     printf("  --grammar <file>: Build LALR(1) tables from a grammar file instead of the built-in ones\n");
+     printf("  --table-cache <file>: Map the --grammar tables from a cache file, rebuilt when the grammar changes\n");
+     printf("  --stats[=<file>]: Print performance counters as JSON (to the file if given)\n");
+     printf("  --collapse-units: Skip the reductions by unit productions such as t -> f (not with --ast)\n");
+     printf("  --async-io: Read the input ahead and write the text trace on background threads\n");
+     printf("  --log-level=<level>: debug, info, warn, error or off (default: debug with --trace=console,\n");
+     printf("          info otherwise)\n");
+     printf("  --log-file=<file>: Append log messages to the file instead of stderr\n");
+     printf("  --fast: Parse the built-in grammar with the generated engine (no step trace, --eval, --ast,\n");
+     printf("          --recover or --stats)\n");
  }
  
  /**
-  * Generate output filename from input filename
-  * Follows the format: <input_basename>_p3dbg.txt
+  * Parse a trace level name
+  * Returns false if the name is not recognised
   */
- char* generate_output_filename(const char* input_file) {
-     // Extract the base filename without path
-     char* base_name = strrchr(input_file, '/');
-     if (base_name == NULL) {
-         base_name = strrchr(input_file, '\\');
+ static bool parse_trace_level(const char* name, TraceLevel* level) {
+     static const char* names[] = { "off", "summary", "file", "console" };
+     
+     for (int i = 0; i <= TRACE_CONSOLE; i++) {
+         if (strcmp(name, names[i]) == 0) {
+             *level = (TraceLevel)i;
+             return true;
+         }
      }
+     return false;
+ }
+ 
+ /**
+  * Read the "<lexeme, TYPE>" tokens of an edit line
+  * Lexemes point into the line, returns the number of tokens or -1
+  */
+ static int parse_edit_tokens(char* text, Token* tokens, int max_tokens) {
+     int count = 0;
      
-     if (base_name != NULL) {
-         base_name++; // Skip the slash
+     while ((text = strchr(text, '<')) != NULL) {
+         char* comma = strchr(text, ',');
+         char* close = comma ? strchr(comma, '>') : NULL;
+         if (!close || count == max_tokens) {
+             return -1;
+         }
+         
+         char* lexeme = text + 1;
+         char* type = comma + 1;
+         while (*type == ' ') {
+             type++;
+         }
+         char* type_end = close;
+         while (type_end > type && type_end[-1] == ' ') {
+             type_end--;
+         }
+         
+         Token* token = &tokens[count++];
+         token->type = token_type_from_text(type, (int)(type_end - type));
+         token->lexeme = lexeme;
+         token->length = (int)(comma - lexeme);
+         token->owns_lexeme = false;
+         token->line_number = 0;
+         token->position = 0;
+         token->next = NULL;
+         text = close + 1;
+     }
+     return count;
+ }
+ 
+ /**
+  * Print the state of an incremental parse after a load or edit
+  */
+ static void print_incremental_result(const IncrementalParse* parse, const char* label) {
+     printf("%s: ", label);
+     if (parse->success) {
+         printf("ACCEPT");
      } else {
-         base_name = (char*)input_file; // No path separator found
+         Token* token = incremental_error_token(parse);
+         printf("ERROR at token %d '%.*s' (line %d, position %d)", parse->error_token,
+                token->length, token->lexeme, token->line_number, token->position);
+     }
+     printf(", resumed at token %d, shifted %d of %d tokens%s\n",
+            parse->last_resumed, parse->last_shifted, parse->num_tokens,
+            parse->last_converged ? ", converged" : "");
+ }
+ 
+ /**
+  * Parse an input, then apply the edits of a script one by one
+  * Each script line is "<start> <removed> <lexeme, TYPE>...", replacing
+  * tokens start .. start + removed - 1 with the listed tokens
+  */
+ static int run_edit_script(const ParsingTables* tables, const char* input_file,
+                            const char* script_file, unsigned input_flags) {
+     FILE* script = fopen(script_file, "r");
+     if (!script) {
+         fprintf(stderr, "Error: Could not open edit script %s\n", script_file);
+         return EXIT_FAILURE;
      }
      
-     // Find extension and remove it if present
-     char* basename_copy = safe_strdup(base_name);
-     char* dot = strrchr(basename_copy, '.');
-     if (dot != NULL) {
-         *dot = '\0'; // Truncate at the dot
+     IncrementalParse* parse = incremental_create(tables);
+     if (!incremental_load(parse, input_file, input_flags)) {
+         incremental_free(parse);
+         fclose(script);
+         return EXIT_FAILURE;
      }
+     print_incremental_result(parse, "Initial parse");
      
-     // Create output filename: <basename>_p3dbg.txt
-     char* output_file = string_format("%s_p3dbg.txt", basename_copy);
-     free(basename_copy);
+     char line[EDIT_MAX_LINE];
+     Token tokens[EDIT_MAX_TOKENS];
+     int edit = 0;
+     int line_number = 0;
+     bool failed = false;
+     while (!failed && fgets(line, sizeof(line), script)) {
+         line_number++;
+         line[strcspn(line, "\r\n")] = '\0';
+         if (line[0] == '\0' || line[0] == '#') {
+             continue;
+         }
+         
+         int start = 0;
+         int removed = 0;
+         int consumed = 0;
+         int count = -1;
+         if (sscanf(line, "%d %d%n", &start, &removed, &consumed) == 2) {
+             count = parse_edit_tokens(line + consumed, tokens, EDIT_MAX_TOKENS);
+         }
+         if (count < 0 || !incremental_edit(parse, start, removed, tokens, count)) {
+             fprintf(stderr, "Error: Invalid edit at %s:%d\n", script_file, line_number);
+             failed = true;
+             break;
+         }
+         
+         char label[32];
+         snprintf(label, sizeof(label), "Edit %d", ++edit);
+         print_incremental_result(parse, label);
+     }
      
-     return output_file;
+     bool success = !failed && parse->success;
+     incremental_free(parse);
+     fclose(script);
+     return success ? EXIT_SUCCESS : EXIT_FAILURE;
+ }
+ 
+ /**
+  * Write the counters as JSON to a file, or to fallback when no file is given
+  */
+ static void write_stats(const ParseStats* stats, const char* stats_file, FILE* fallback) {
+     if (!stats_file) {
+         parse_stats_print_json(stats, fallback);
+         return;
+     }
+     
+     FILE* out = fopen(stats_file, "w");
+     if (!out) {
+         fprintf(stderr, "Error: Could not write statistics to %s\n", stats_file);
+         return;
+     }
+     parse_stats_print_json(stats, out);
+     fclose(out);
  }
  
  /**
@@ -56,28 +207,302 @@
   */
  int main(int argc, char* argv[]) {
 
-     if (argc != 2) {
+     TraceLevel trace_level = TRACE_CONSOLE; // Full trace by default as per the design document
+     bool trace_given = false;
+     bool binary_trace = false;
+     unsigned input_flags = 0;
+     const char* grammar_file = NULL;
+     const char* table_cache = NULL;
+     const char* edits_file = NULL;
+     bool batch = false;
+     bool split = false;
+     const char* delimiter = NULL;
+     int jobs = 0;
+     bool eval = false;
+     bool ast = false;
+     int max_errors = 1;
+     bool stats = false;
+     const char* stats_file = NULL;
+     bool fast = false;
+     bool async_io = false;
+     bool collapse = false;
+     int log_level = -1;
+     const char* log_file = NULL;
+     
+     // Positional arguments, at most one unless in batch mode
+     const char** inputs = (const char**)safe_malloc(sizeof(char*) * argc);
+     int input_count = 0;
+     
+     for (int i = 1; i < argc; i++) {
+         if (strncmp(argv[i], "--trace=", 8) == 0) {
+             // A binary trace replaces the text one, see tools/p3trace.c
+             binary_trace = strcmp(argv[i] + 8, "binary") == 0;
+             if (binary_trace) {
+                 trace_level = TRACE_OFF;
+             } else if (!parse_trace_level(argv[i] + 8, &trace_level)) {
+                 fprintf(stderr, "Error: Unknown trace level '%s'\n", argv[i] + 8);
+                 free(inputs);
+                 return EXIT_FAILURE;
+             }
+             trace_given = true;
+         } else if (strcmp(argv[i], "--mmap") == 0) {
+             input_flags |= TOKEN_STREAM_MMAP;
+         } else if (strcmp(argv[i], "--stream") == 0) {
+             input_flags |= TOKEN_STREAM_STREAMING;
+         } else if (strcmp(argv[i], "--async-io") == 0) {
+             input_flags |= TOKEN_STREAM_PREFETCH;
+             async_io = true;
+         } else if (strcmp(argv[i], "--grammar") == 0 && i + 1 < argc) {
+             grammar_file = argv[++i];
+         } else if (strcmp(argv[i], "--table-cache") == 0 && i + 1 < argc) {
+             table_cache = argv[++i];
+         } else if (strcmp(argv[i], "--edits") == 0 && i + 1 < argc) {
+             edits_file = argv[++i];
+         } else if (strcmp(argv[i], "--eval") == 0) {
+             eval = true;
+         } else if (strcmp(argv[i], "--ast") == 0) {
+             ast = true;
+         } else if (strcmp(argv[i], "--recover") == 0) {
+             max_errors = PARSER_DEFAULT_MAX_ERRORS;
+         } else if (strncmp(argv[i], "--recover=", 10) == 0) {
+             max_errors = atoi(argv[i] + 10);
+             if (max_errors < 1) {
+                 fprintf(stderr, "Error: Invalid error limit '%s'\n", argv[i] + 10);
+                 free(inputs);
+                 return EXIT_FAILURE;
+             }
+         } else if (strcmp(argv[i], "--stats") == 0) {
+             stats = true;
+         } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+             stats = true;
+             stats_file = argv[i] + 8;
+         } else if (strcmp(argv[i], "--collapse-units") == 0) {
+             collapse = true;
+         } else if (strncmp(argv[i], "--log-level=", 12) == 0) {
+             if (!log_level_from_name(argv[i] + 12, &log_level)) {
+                 fprintf(stderr, "Error: Unknown log level '%s'\n", argv[i] + 12);
+                 free(inputs);
+                 return EXIT_FAILURE;
+             }
+         } else if (strncmp(argv[i], "--log-file=", 11) == 0 && argv[i][11] != '\0') {
+             log_file = argv[i] + 11;
+         } else if (strcmp(argv[i], "--fast") == 0) {
+             fast = true;
+         } else if (strcmp(argv[i], "--batch") == 0) {
+             batch = true;
+         } else if (strcmp(argv[i], "--split") == 0) {
+             split = true;
+         } else if (strncmp(argv[i], "--split=", 8) == 0 && argv[i][8] != '\0') {
+             split = true;
+             delimiter = argv[i] + 8;
+         } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+             jobs = atoi(argv[i] + 7);
+             if (jobs < 1) {
+                 fprintf(stderr, "Error: Invalid job count '%s'\n", argv[i] + 7);
+                 free(inputs);
+                 return EXIT_FAILURE;
+             }
+         } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+             fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+             print_usage(argv[0]);
+             free(inputs);
+             return EXIT_FAILURE;
+         } else {
+             inputs[input_count++] = argv[i];
+         }
+     }
+     
+     if (batch) {
+         // One debug file per input is rarely wanted, so no trace unless asked
+         if (!trace_given) {
+             trace_level = TRACE_OFF;
+         }
+         // "-" alone reads the manifest from stdin, like no paths at all
+         if (input_count == 1 && strcmp(inputs[0], "-") == 0) {
+             input_count = 0;
+         }
+     } else if (input_count != 1 || (split && edits_file)) {
          print_usage(argv[0]);
+         free(inputs);
+         return EXIT_FAILURE;
+     }
+     
+     // The expressions are parsed on several threads, none writes a trace
+     if (split) {
+         if (batch) {
+             fprintf(stderr, "Error: --split and --batch cannot be combined\n");
+             free(inputs);
+             return EXIT_FAILURE;
+         }
+         if (binary_trace || (trace_given && trace_level > TRACE_OFF)) {
+             fprintf(stderr, "Error: --split writes no trace, use --trace=off\n");
+             free(inputs);
+             return EXIT_FAILURE;
+         }
+         trace_level = TRACE_OFF;
+     }
+     
+     // The built-in tables are compiled in, only generated ones are cached
+     if (table_cache && !grammar_file) {
+         fprintf(stderr, "Error: --table-cache needs --grammar\n");
+         free(inputs);
+         return EXIT_FAILURE;
+     }
+     
+     // Both keep their result in the semantic value of each stack entry
+     if (eval && ast) {
+         fprintf(stderr, "Error: --eval and --ast cannot be combined\n");
+         free(inputs);
+         return EXIT_FAILURE;
+     }
+     
+     // The tree would lack the nodes of the skipped reductions
+     if (collapse && ast) {
+         fprintf(stderr, "Error: --collapse-units and --ast cannot be combined\n");
+         free(inputs);
          return EXIT_FAILURE;
      }
-  
-     const char* input_file = argv[1];
-     char* output_file = generate_output_filename(input_file);
 
-     bool debug_mode = true; // Always enable debug mode as per the design document
+     // The console trace comes with the scanner's debug messages
+     if (log_level < 0) {
+         log_level = trace_level >= TRACE_CONSOLE ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO;
+     }
+     log_set_level(log_level);
+     if (log_file) {
+         // Flushed and closed when the process exits
+         FILE* log_out = fopen(log_file, "a");
+         if (!log_out) {
+             fprintf(stderr, "Error: Could not open log file %s\n", log_file);
+             free(inputs);
+             return EXIT_FAILURE;
+         }
+         log_set_sink(log_file_sink, log_out);
+     }
 
      // Create parser
-     Parser* parser = parser_create(debug_mode);
+     Parser* parser = parser_create(trace_level);
    
      if (!parser) {
          fprintf(stderr, "Error: Failed to create parser\n");
-         free(output_file);
+         free(inputs);
          return EXIT_FAILURE;
      }
+     parser->input_flags = input_flags;
+     parser->max_errors = max_errors;
+     parser->binary_trace = binary_trace;
+     parser->grammar_file = grammar_file;
+     parser->collect_stats = stats;
+     parser->fast_engine = fast;
+     parser->async_trace = async_io;
+     
+     // Replace the built-in tables, the parser frees the generated ones
+     if (grammar_file) {
+         LalrReport report;
+         TableCacheStatus cache_status = TABLE_CACHE_MISSING;
+         ParsingTables* tables = table_cache
+                                 ? table_cache_build(grammar_file, table_cache, &report, &cache_status)
+                                 : lalr_build_from_file(grammar_file, &report);
+         if (!tables) {
+             fprintf(stderr, "Error: Failed to build tables from %s\n", grammar_file);
+             parser_free(parser);
+             free(inputs);
+             return EXIT_FAILURE;
+         }
+         if (report.shift_reduce + report.reduce_reduce > 0) {
+             fprintf(stderr, "Warning: %s has %d shift/reduce and %d reduce/reduce conflicts\n",
+                     grammar_file, report.shift_reduce, report.reduce_reduce);
+         }
+         if (table_cache && cache_status != TABLE_CACHE_LOADED) {
+             LOG_INFO("%s table cache %s", cache_status == TABLE_CACHE_MISSING ? "Created" : "Rebuilt",
+                      table_cache);
+         }
+         parser->tables = tables;
+     }
+     
+     // The expression actions go by production number, so a grammar
+     // file must have the same rules in the same order (as grammars/expr.bnf does)
+     if (eval) {
+         if (!automaton_same_productions(parser->tables, automaton_builtin())) {
+             fprintf(stderr, "Error: --eval needs the rules of the expression grammar\n");
+             parser_free(parser);
+             free(inputs);
+             return EXIT_FAILURE;
+         }
+         parser->actions = semantic_expr_actions();
+     }
+     if (ast) {
+         parser->ast_builder = ast_builder_create();
+     }
+     
+     // After the actions are set, only units that pass their value on go
+     if (collapse) {
+         CollapseReport report;
+         ParsingTables* collapsed = collapse_unit_productions(parser->tables, parser->actions, &report);
+         free_parsing_tables(parser->tables);
+         parser->tables = collapsed;
+         parser->owns_tables = true;
+         if (trace_level >= TRACE_CONSOLE) {
+             printf("Collapsed %d unit productions, %d states instead of %d\n",
+                    report.units_removed, report.states_after, report.states_before);
+         }
+     }
+     if (fast && !parser_uses_engine(parser)) {
+         fprintf(stderr, "Warning: --fast does not apply to these options, using the table-driven loop\n");
+     }
+     
+     if (batch) {
+         BatchSummary summary = batch_run(parser, inputs, input_count, stdin, stdout,
+                                          jobs > 0 ? jobs : batch_default_jobs());
+         fflush(stdout);
+         fprintf(stderr, "Batch: %d files, %d accepted, %d failed in %.3f s with %d thread%s (%.0f files/sec)\n",
+                 summary.files, summary.accepted, summary.failed, summary.seconds,
+                 summary.threads, summary.threads == 1 ? "" : "s",
+                 summary.seconds > 0 ? summary.files / summary.seconds : 0.0);
+         if (summary.stats) {
+             // The result lines keep stdout, the totals go to stderr by default
+             write_stats(summary.stats, stats_file, stderr);
+             parse_stats_free(summary.stats);
+         }
+         parser_free(parser);
+         free(inputs);
+         return summary.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+     }
+     
+     const char* input_file = inputs[0];
+     
+     if (split) {
+         SplitSummary summary = split_run(parser, input_file, delimiter, stdout,
+                                          jobs > 0 ? jobs : batch_default_jobs());
+         fflush(stdout);
+         fprintf(stderr, "Split: %d expressions, %d accepted, %d failed in %.3f s with %d thread%s (%.0f expressions/sec)\n",
+                 summary.expressions, summary.accepted, summary.failed, summary.seconds,
+                 summary.threads, summary.threads == 1 ? "" : "s",
+                 summary.seconds > 0 ? summary.expressions / summary.seconds : 0.0);
+         if (summary.stats) {
+             write_stats(summary.stats, stats_file, stderr);
+             parse_stats_free(summary.stats);
+         }
+         parser_free(parser);
+         free(inputs);
+         return summary.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+     }
+     
+     if (edits_file) {
+         int status = run_edit_script(parser->tables, input_file, edits_file, input_flags);
+         parser_free(parser);
+         free(inputs);
+         return status;
+     }
+     
+     char* output_file = binary_trace ? generate_trace_filename(input_file)
+                                      : generate_output_filename(input_file);
      
      printf("Starting parser...\n");
      printf("Input file: %s\n", input_file);
-     printf("Output file: %s\n", output_file);
+     // No file is written without a trace, an old one must not look current
+     if (trace_level >= TRACE_SUMMARY || binary_trace) {
+         printf("Output file: %s\n", output_file);
+     }
      
      // Parse input
      ParseResult result = parser_parse(parser, input_file, output_file);
@@ -86,27 +511,46 @@
      if (result.success) {
          printf("\nParsing completed successfully.\n");
          printf("Steps taken: %d\n", result.steps_taken);
-         printf("Output saved to %s\n", output_file);
+         if (result.has_value) {
+             printf("Value: %.15g\n", result.value.number);
+         }
+         if (result.ast) {
+             printf("Syntax tree (%u nodes):\n", result.ast->num_nodes);
+             ast_print(result.ast, parser->tables->non_terminal_names, stdout);
+         }
+         if (trace_level >= TRACE_SUMMARY || binary_trace) {
+             printf("Output saved to %s\n", output_file);
+         }
      } else {
          fprintf(stderr, "\nParsing failed!\n");
-         if (result.error_message) {
-             fprintf(stderr, "Error: %s\n", result.error_message);
-         }
-         if (result.error_line > 0) {
-             fprintf(stderr, "Error occurred at line %d\n", result.error_line);
+         if (result.error_count > 1) {
+             // Recovery went on after the first error, list them all
+             fprintf(stderr, "%d syntax errors%s:\n", result.error_count,
+                     result.error_count >= max_errors ? " (limit reached)" : "");
+             for (int i = 0; i < result.error_count; i++) {
+                 fprintf(stderr, "Error: %s\n", result.errors[i].message);
+             }
+         } else {
+             if (result.error_message) {
+                 fprintf(stderr, "Error: %s\n", result.error_message);
+             }
+             if (result.error_line > 0) {
+                 fprintf(stderr, "Error occurred at line %d\n", result.error_line);
+             }
          }
      }
      
-     // Clean up
-     if (result.error_message) {
-         free(result.error_message);
-     }
-     if (result.debug_trace) {
-         free(result.debug_trace);
+     if (result.stats) {
+         write_stats(result.stats, stats_file, stdout);
      }
      
+     // Clean up
+     bool success = result.success;
+     parse_result_free(&result);
+     
      parser_free(parser);
      free(output_file);
+     free(inputs);
      
-     return result.success ? EXIT_SUCCESS : EXIT_FAILURE;
- }
\ No newline at end of file
+     return success ? EXIT_SUCCESS : EXIT_FAILURE;
+ }
@@ -9,24 +9,61 @@
  #include <string.h>
  #include "../include/parser.h"
  #include "../include/automaton.h"
+ #include "../include/engine.h"
+ #include "../include/async_io.h"
  #include "../include/utils.h"
  
  // Forward declarations
  static void init_parser_stack(Parser* parser);
- static char* get_input_position_string(TokenStream* stream);
+ static void reset_parser_stack(Parser* parser);
+ static void close_debug_file(Parser* parser);
+ static void record_error(Parser* parser, ParseResult* result, Token* token, int state);
+ static bool recover_from_error(Parser* parser, bool skip_current);
+ static void write_trace_record(Parser* parser, TraceOperation operation, int param,
+                                int popped, int next_state);
+ static void write_reduce_record(Parser* parser, int production_num);
+static Token* advance_input(Parser* parser);
+static uint64_t stats_clock(const Parser* parser);
+static void stats_count_push(Parser* parser);
+static int run_engine(Parser* parser, ParseResult* result);
+static ParseResult new_result(void);
+static void begin_stats(Parser* parser, uint64_t* started, uint64_t* allocations);
+static int run_parse(Parser* parser, ParseResult* result);
+static void end_stats(Parser* parser, ParseResult* result, uint64_t started, uint64_t allocations);
  
  /**
   * Create and initialize parser
   */
- Parser* parser_create(bool debug_mode) {
+ Parser* parser_create(TraceLevel trace_level) {
      Parser* parser = (Parser*)safe_malloc(sizeof(Parser));
      parser->stack = stack_create();
      parser->input = NULL;
-     parser->tables = automaton_init();
-     parser->debug_mode = debug_mode;
+     parser->tables = automaton_builtin(); // Shared static tables, nothing to build
+     parser->owns_tables = true;
+     parser->actions = NULL;
+     parser->ast_builder = NULL;
+     parser->trace_level = trace_level;
+     parser->input_flags = 0;
      parser->debug_file = NULL;
+     parser->async_trace = false;
+     parser->trace_pipe = NULL;
+     parser->binary_trace = false;
+     parser->grammar_file = NULL;
+     parser->trace_writer = NULL;
+     parser->token_index = 0;
      parser->current_state = 0;
      parser->error_count = 0;
+     parser->max_errors = 1;
+     parser->recovering = false;
+     parser->step_number = 0;
+     strbuf_init(&parser->trace_text);
+     strbuf_init(&parser->trace_action);
+     parser->collect_stats = false;
+     parser->stats = NULL;
+     parser->fast_engine = false;
+     parser->engine_states = NULL;
+     parser->engine_capacity = 0;
+     parser->buffer_input = NULL;
      
      // Initialize stack with initial state and EOF token
      init_parser_stack(parser);
@@ -34,6 +71,27 @@
      return parser;
  }
  
+ /**
+  * Create a parser with the tables and options of another
+  */
+ Parser* parser_create_worker(const Parser* parser) {
+     Parser* worker = parser_create(parser->trace_level);
+     worker->tables = parser->tables;
+     worker->owns_tables = false;
+     worker->input_flags = parser->input_flags;
+     worker->actions = parser->actions;
+     worker->max_errors = parser->max_errors;
+     worker->binary_trace = parser->binary_trace;
+     worker->grammar_file = parser->grammar_file;
+     worker->collect_stats = parser->collect_stats;
+     worker->fast_engine = parser->fast_engine;
+     worker->async_trace = parser->async_trace;
+     if (parser->ast_builder) {
+         worker->ast_builder = ast_builder_create();
+     }
+     return worker;
+ }
+ 
  /**
   * Free parser resources
   */
@@ -43,13 +101,24 @@
      }
      
      stack_free(parser->stack);
+     ast_builder_free(parser->ast_builder);
+     strbuf_free(&parser->trace_text);
+     strbuf_free(&parser->trace_action);
+     parse_stats_free(parser->stats);
+     free(parser->engine_states);
+     token_stream_free(parser->buffer_input);
      
+     if (parser->trace_pipe) {
+         async_writer_close(parser->trace_pipe);
+     }
      if (parser->debug_file) {
          fclose(parser->debug_file);
      }
      
-     // Free parsing tables
-     free_parsing_tables(parser->tables);
+     // Free parsing tables unless another parser owns them
+     if (parser->owns_tables) {
+         free_parsing_tables(parser->tables);
+     }
      
      // Input stream is closed separately
      
@@ -60,153 +129,173 @@
   * Main parsing function
   */
  ParseResult parser_parse(Parser* parser, const char* input_file, const char* output_file) {
-     ParseResult result = {
-         .success = false,
-         .error_line = 0,
-         .error_message = NULL,
-         .debug_trace = NULL,
-         .steps_taken = 0
-     };
+     ParseResult result = new_result();
      
      if (!parser) {
          result.error_message = safe_strdup("Parser not initialized");
          return result;
      }
+     parser_reset(parser);
      
-     // Open debug file if specified
-     if (output_file && parser->debug_mode) {
+     // Open debug file if specified and something will be written to it
+     if (output_file && parser->binary_trace) {
+         parser->trace_writer = trace_writer_open(output_file, input_file, parser->grammar_file);
+         if (!parser->trace_writer) {
+             result.error_message = string_format("Failed to open trace file: %s", output_file);
+             return result;
+         }
+     } else if (output_file && parser->trace_level >= TRACE_SUMMARY) {
          parser->debug_file = fopen(output_file, "w");
          if (!parser->debug_file) {
              result.error_message = string_format("Failed to open debug file: %s", output_file);
              return result;
          }
+         // Only the per-step trace is worth a thread, NULL keeps writing in place
+         if (parser->async_trace && parser->trace_level >= TRACE_FILE) {
+             parser->trace_pipe = async_writer_open(parser->debug_file);
+         }
      }
      
-     // Open input file
-     parser->input = token_stream_create(input_file);
+     // Counters of this parse, handed to the result at the end
+     uint64_t parse_started = 0;
+     uint64_t allocations_before = 0;
+     begin_stats(parser, &parse_started, &allocations_before);
+     
+     // Open input file, scanner progress is only shown with a console trace
+     unsigned input_flags = parser->input_flags;
+     if (parser->trace_level >= TRACE_CONSOLE) {
+         input_flags |= TOKEN_STREAM_VERBOSE;
+     }
+     uint64_t open_started = stats_clock(parser);
+     parser->input = token_stream_open(input_file, input_flags);
      if (!parser->input) {
          result.error_message = string_format("Failed to open input file: %s", input_file);
+         close_debug_file(parser);
+         parse_stats_free(parser->stats);
+         parser->stats = NULL;
          return result;
      }
+     if (parser->stats) {
+         parser->stats->scan_ns += monotonic_ns() - open_started;
+     }
      
-     // Main parsing loop
-     int step = 0;
-     bool done = false;
+     int step = run_parse(parser, &result);
      
-     while (!done && parser->input->current) {
-         Token* current_token = parser->input->current;
-         StackElement* top = stack_peek(parser->stack);
-         
-         if (!top) {
-             result.error_message = safe_strdup("Stack underflow");
-             break;
-         }
-         
-         int state = top->state;
-         int action_value = get_action(parser->tables, state, current_token->type);
-         ActionType action_type = automaton_get_action_type(action_value);
-         int action_param = automaton_get_action_value(action_value);
-         
-         step++;
-         
-         // Get debugging information
-         char* stack_str = stack_to_string(parser->stack);
-         char* input_pos = get_input_position_string(parser->input);
-         char* action_str = automaton_action_to_string(action_value, parser->tables);
-         
-         switch (action_type) {
-             case ACTION_SHIFT:
-                 // Write debug output
-                 write_debug_output(parser, "SHIFT", action_str);
-                 
-                 // Perform shift operation
-                 if (!perform_shift(parser, action_param, current_token)) {
-                     result.error_message = safe_strdup("Shift operation failed");
-                     done = true;
-                     break;
-                 }
-                 
-                 // Get next token
-                 get_next_token(parser->input);
-                 break;
-                 
-             case ACTION_REDUCE:
-                 // Write debug output
-                 write_debug_output(parser, "REDUCE", action_str);
-                 
-                 // Perform reduce operation
-                 if (!perform_reduce(parser, action_param)) {
-                     result.error_message = safe_strdup("Reduce operation failed");
-                     done = true;
-                     break;
-                 }
-                 break;
-                 
-             case ACTION_ACCEPT:
-                 // Write debug output
-                 write_debug_output(parser, "ACCEPT", "Input accepted");
-                 
-                 result.success = true;
-                 done = true;
-                 break;
-                 
-             case ACTION_ERROR:
-             default:
-                 // Write debug output
-                 write_debug_output(parser, "ERROR", "Invalid syntax");
-                 
-                 result.error_line = current_token->line_number;
-                 result.error_message = string_format("Syntax error at line %d, position %d: unexpected token '%s'",
-                                                    current_token->line_number,
-                                                    current_token->position,
-                                                    current_token->lexeme);
-                 parser->error_count++;
-                 done = true;
-                 break;
-         }
-         
-         free(stack_str);
-         free(input_pos);
-         free(action_str);
+     // Summary line for runs that skip the per-step trace
+     if (parser->trace_level == TRACE_SUMMARY && parser->debug_file) {
+         fprintf(parser->debug_file, "Result: %s\nSteps taken: %d\n",
+                 result.success ? "ACCEPT" : "ERROR", step);
      }
-     
-     result.steps_taken = step;
+     close_debug_file(parser);
      
      // Clean up token stream
      token_stream_free(parser->input);
      parser->input = NULL;
      
+     end_stats(parser, &result, parse_started, allocations_before);
      return result;
  }
  
  /**
-  * Free parsing tables resources
+  * Parse the tokens of an open stream
   */
- void free_parsing_tables(ParsingTables* tables) {
-     if (!tables) {
-         return;
-     }
+ ParseResult parser_parse_stream(Parser* parser, TokenStream* input) {
+     ParseResult result = new_result();
      
-     // Free action table
-     for (int i = 0; i < tables->num_states; i++) {
-         free(tables->action_table[i]);
+     if (!parser || !input) {
+         result.error_message = safe_strdup(parser ? "No input stream" : "Parser not initialized");
+         return result;
      }
-     free(tables->action_table);
+     parser_reset(parser);
+     
+     uint64_t parse_started = 0;
+     uint64_t allocations_before = 0;
+     begin_stats(parser, &parse_started, &allocations_before);
+     
+     // The stream stays the caller's
+     parser->input = input;
+     run_parse(parser, &result);
+     parser->input = NULL;
      
-     // Free goto table
-     for (int i = 0; i < tables->num_states; i++) {
-         free(tables->goto_table[i]);
+     end_stats(parser, &result, parse_started, allocations_before);
+     return result;
+ }
+ 
+ /**
+  * Parse tokens in memory with the parser's pooled stream
+  */
+ ParseResult parser_parse_buffer(Parser* parser, const char* data, size_t size) {
+     if (!parser) {
+         return parser_parse_stream(NULL, NULL);
      }
-     free(tables->goto_table);
      
-     // Free productions
-     for (int i = 0; i <= tables->num_productions; i++) {
-         free(tables->productions[i].rhs);
-         free(tables->productions[i].rule_string);
+     // The flags the stream keeps, it is only reopened when they change
+     unsigned flags = (parser->input_flags & TOKEN_STREAM_STREAMING) | TOKEN_STREAM_MMAP;
+     if (parser->trace_level >= TRACE_CONSOLE) {
+         flags |= TOKEN_STREAM_VERBOSE;
+     }
+     if (parser->buffer_input && parser->buffer_input->flags == flags) {
+         token_stream_reset_buffer(parser->buffer_input, data, size, 1, 0);
+     } else {
+         token_stream_free(parser->buffer_input);
+         parser->buffer_input = token_stream_open_buffer(data, size, 1, 0, flags);
+     }
+     return parser_parse_stream(parser, parser->buffer_input);
+ }
+ 
+ /**
+  * Return the parser to the initial state, keeping its memory
+  */
+ void parser_reset(Parser* parser) {
+     if (!parser) {
+         return;
      }
-     free(tables->productions);
      
-     free(tables);
+     // Start from the bottom element, a previous parse may have stopped
+     // with symbols on the stack
+     reset_parser_stack(parser);
+     parser->recovering = false;
+     parser->token_index = 0;
+     parser->step_number = 0;
+     strbuf_clear(&parser->trace_text);
+     strbuf_clear(&parser->trace_action);
+     if (parser->ast_builder) {
+         ast_builder_clear(parser->ast_builder);
+     }
+ }
+ 
+ /**
+  * Check whether parser_parse runs the generated engine
+  */
+ bool parser_uses_engine(const Parser* parser) {
+     return parser->fast_engine && engine_supports(parser->tables) &&
+            parser->trace_level < TRACE_FILE && !parser->binary_trace &&
+            !parser->actions && !parser->ast_builder &&
+            parser->max_errors == 1 && !parser->collect_stats;
+ }
+ 
+ /**
+  * Free everything held by a parse result
+  */
+ void parse_result_free(ParseResult* result) {
+     if (!result) {
+         return;
+     }
+     free(result->error_message);
+     free(result->debug_trace);
+     for (int i = 0; i < result->error_count; i++) {
+         free(result->errors[i].message);
+     }
+     free(result->errors);
+     ast_free(result->ast);
+     parse_stats_free(result->stats);
+     result->error_message = NULL;
+     result->debug_trace = NULL;
+     result->errors = NULL;
+     result->error_count = 0;
+     result->error_capacity = 0;
+     result->ast = NULL;
+     result->stats = NULL;
  }
  
  /**
@@ -217,11 +306,25 @@
          return false;
      }
      
-     // Push the current token and new state onto the stack
-     bool result = stack_push(parser->stack, state, token);
+     // Push the current token and new state onto the stack, terminals
+     // have no value of their own (actions read their lexemes) but get
+     // a leaf when a tree is built
+     bool result;
+     if (parser->ast_builder) {
+         SemValue leaf = { .node = ast_builder_leaf(parser->ast_builder, token) };
+         result = stack_push_value(parser->stack, state, token, leaf);
+     } else if (parser->actions) {
+         result = stack_push_value(parser->stack, state, token, (SemValue){ 0 });
+     } else {
+         result = stack_push(parser->stack, state, token);
+     }
      
      if (result) {
          parser->current_state = state;
+         if (parser->stats) {
+             parser->stats->shifts++;
+             stats_count_push(parser);
+         }
      }
      
      return result;
@@ -234,48 +337,77 @@
  * Perform reduce operation
  */
 bool perform_reduce(Parser* parser, int production_num) {
-    if (!parser || !parser->tables || production_num <= 0 || production_num > parser->tables->num_productions) {
+    if (!parser || !parser->tables || !parser->input ||
+        production_num <= 0 || production_num > parser->tables->num_productions) {
         return false;
     }
     
-    Production* production = &parser->tables->productions[production_num];
+    const Production* production = &parser->tables->productions[production_num];
     
-    // Pop rhs_length symbols from the stack
-    for (int i = 0; i < production->rhs_length; i++) {
-        StackElement* element = stack_pop(parser->stack);
-        if (!element) {
-            log_error("Stack underflow during reduction");
-            return false;
+    // Hand the popped symbols back to the input before dropping them
+    int size = stack_size(parser->stack);
+    if (production->rhs_length > size) {
+        log_error("Stack underflow during reduction");
+        return false;
+    }
+    
+    // Run the reduce action while the right-hand side is still in place
+    SemValue value = { 0 };
+    if (parser->ast_builder) {
+        value.node = ast_builder_node(parser->ast_builder, production->lhs, production_num,
+                                      parser->stack, size - production->rhs_length,
+                                      production->rhs_length);
+    } else if (parser->actions && parser->actions[production_num]) {
+        value = parser->actions[production_num](parser->stack, size - production->rhs_length);
+    }
+    
+    for (int i = size - production->rhs_length; i < size; i++) {
+        Token* symbol = stack_symbol_at(parser->stack, i);
+        if (symbol != &parser->bottom_token) {
+            token_stream_release(parser->input, symbol);
         }
-        free(element);
+    }
+    
+    // Pop rhs_length symbols from the stack
+    if (!stack_pop_n(parser->stack, production->rhs_length)) {
+        log_error("Stack underflow during reduction");
+        return false;
     }
     
     // Get the state at the top of the stack
-    StackElement* top = stack_peek(parser->stack);
-    if (!top) {
+    int state = stack_top_state(parser->stack);
+    if (state < 0) {
         log_error("Stack underflow after reduction");
         return false;
     }
     
-    int state = top->state;
-    
     // Get the goto state for the LHS non-terminal
-    int goto_state = get_goto_state(parser->tables, state, production->lhs);
+    int goto_state = tables_goto(parser->tables, state, production->lhs);
     if (goto_state < 0) {
         log_error("Invalid goto state for non-terminal %d from state %d", production->lhs, state);
         return false;
     }
     
-    // Create a token for the LHS non-terminal with proper type and name
-    Token* lhs_token = token_create(TOKEN_NON_TERMINAL, 
-                                   get_non_terminal_name(production->lhs), 
-                                   0, 0);
+    // Create a token for the LHS non-terminal in the input's arena,
+    // the name lives as long as the tables so it is not copied
+    const char* name = parser->tables->non_terminal_names
+                       ? parser->tables->non_terminal_names[production->lhs]
+                       : get_non_terminal_name(production->lhs);
+    Token* lhs_token = token_stream_new_token(parser->input, TOKEN_NON_TERMINAL,
+                                              name, (int)strlen(name), 0, 0, false);
     
     // Push the goto state and LHS non-terminal
-    bool result = stack_push(parser->stack, goto_state, lhs_token);
+    bool result = (parser->actions || parser->ast_builder)
+                  ? stack_push_value(parser->stack, goto_state, lhs_token, value)
+                  : stack_push(parser->stack, goto_state, lhs_token);
     
     if (result) {
         parser->current_state = goto_state;
+        if (parser->stats) {
+            parser->stats->reduces++;
+            parser->stats->production_reduces[production_num]++;
+            stats_count_push(parser);
+        }
     }
     
     return result;
@@ -285,73 +417,283 @@ bool perform_reduce(Parser* parser, int production_num) {
   * Write debugging information to output file/console
   */
  void write_debug_output(Parser* parser, const char* operation, const char* action) {
-    static int step_number = 0;
-    step_number++;
+    if (!parser || parser->trace_level < TRACE_FILE) {
+        return;
+    }
+    
+    int step_number = ++parser->step_number;
+    uint64_t started = stats_clock(parser);
     
-    char* stack_str = stack_to_string(parser->stack);
-    char* input_pos = get_input_position_string(parser->input);
+    // Render the whole step in one pass into the parser's buffer, which
+    // keeps its memory from step to step
+    StrBuf* text = &parser->trace_text;
+    strbuf_clear(text);
+    strbuf_append_str(text, "Step ");
+    strbuf_append_int(text, step_number);
+    strbuf_append_str(text, ":\nCurrent State: ");
+    strbuf_append_int(text, parser->current_state);
+    strbuf_append_str(text, "\nStack Contents: ");
+    size_t stack_start = text->length;
+    stack_append_string(parser->stack, text);
+    int stack_length = (int)(text->length - stack_start);
+    strbuf_append_str(text, "\nInput Position: ");
+    size_t input_start = text->length;
+    token_stream_append_position(text, parser->input, TRACE_INPUT_TOKENS);
+    int input_length = (int)(text->length - input_start);
+    strbuf_append_str(text, "\nOperation: ");
+    strbuf_append_str(text, operation);
+    strbuf_append_str(text, "\nAction: ");
+    strbuf_append_str(text, action);
+    strbuf_append(text, "\n\n", 2);
     
-    // Always print to console regardless of debug_mode
-    printf("Step %d:\n", step_number);
-    printf("Current State: %d\n", parser->current_state);
-    printf("Stack Contents: %s\n", stack_str);
-    printf("Input Position: %s\n", input_pos);
-    printf("Operation: %s\n", operation);
-    printf("Action: %s\n\n", action);
+    bool console = parser->trace_level >= TRACE_CONSOLE;
+    
+    // Step trace to console
+    if (console) {
+        fwrite(text->data, 1, text->length, stdout);
+    }
     
      
      // Debug output to file (format as specified in the design document)
-     if (parser->debug_file) {
-         fprintf(parser->debug_file, "Step %d:\n", step_number);
-         fprintf(parser->debug_file, "Current State: %d\n", parser->current_state);
-         fprintf(parser->debug_file, "Stack Contents: %s\n", stack_str);
-         fprintf(parser->debug_file, "Input Position: %s\n", input_pos);
-         fprintf(parser->debug_file, "Operation: %s\n", operation);
-         fprintf(parser->debug_file, "Action: %s\n\n", action);
+     if (parser->trace_pipe) {
+         async_writer_write(parser->trace_pipe, text->data, text->length);
+     } else if (parser->debug_file) {
+         fwrite(text->data, 1, text->length, parser->debug_file);
      }
      
-     // Debug output to console if enabled
-     if (parser->debug_mode) {
-         log_debug(true, "Step %d:", step_number);
-         log_debug(true, "Current State: %d", parser->current_state);
-         log_debug(true, "Stack Contents: %s", stack_str);
-         log_debug(true, "Input Position: %s", input_pos);
-         log_debug(true, "Operation: %s", operation);
-         log_debug(true, "Action: %s", action);
-         log_debug(true, "--------------------");
+     // Debug log copy of the step
+     if (console) {
+         LOG_DEBUG("Step %d:", step_number);
+         LOG_DEBUG("Current State: %d", parser->current_state);
+         LOG_DEBUG("Stack Contents: %.*s", stack_length, text->data + stack_start);
+         LOG_DEBUG("Input Position: %.*s", input_length, text->data + input_start);
+         LOG_DEBUG("Operation: %s", operation);
+         LOG_DEBUG("Action: %s", action);
+         LOG_DEBUG("--------------------");
      }
      
-     free(stack_str);
-     free(input_pos);
+     if (parser->stats) {
+         parser->stats->trace_ns += monotonic_ns() - started;
+     }
  }
  
  /**
   * Get action from parsing table
   */
- int get_action(ParsingTables* tables, int state, TokenType token_type) {
+ int get_action(const ParsingTables* tables, int state, TokenType token_type) {
     if (!tables || state < 0 || state >= tables->num_states || 
-        (int)token_type >= tables->num_terminals) {
+        (int)token_type < 0 || (int)token_type >= tables->num_terminals) {
         // Return error action
         return automaton_create_action(ACTION_ERROR, 0);
     }
     
-    return tables->action_table[state][token_type];
+    return tables_action(tables, state, token_type);
  }
  
 /**
  * Get goto state from parsing table
  */
-int get_goto_state(ParsingTables* tables, int state, int non_terminal) {
+int get_goto_state(const ParsingTables* tables, int state, int non_terminal) {
     if (!tables || state < 0 || state >= tables->num_states || 
         non_terminal < 0 || non_terminal >= tables->num_non_terminals) {
         return -1;
     }
     
-    return tables->goto_table[state][non_terminal];
+    return tables_goto(tables, state, non_terminal);
 }
 
 /* Internal function implementations */
 
+/**
+ * Result of a parse that has not started
+ */
+static ParseResult new_result(void) {
+    ParseResult result = {
+        .success = false,
+        .error_line = 0,
+        .error_position = 0,
+        .error_message = NULL,
+        .debug_trace = NULL,
+        .steps_taken = 0,
+        .has_value = false,
+        .value = { 0 },
+        .ast = NULL,
+        .errors = NULL,
+        .error_count = 0,
+        .error_capacity = 0,
+        .stats = NULL
+    };
+    return result;
+}
+
+/**
+ * Start the counters of a parse when they are collected
+ */
+static void begin_stats(Parser* parser, uint64_t* started, uint64_t* allocations) {
+    if (parser->collect_stats) {
+        parser->stats = parse_stats_create(parser->tables->num_productions);
+        parser->stats->parses = 1;
+        parser->stats->max_stack_depth = stack_size(parser->stack);
+        *started = monotonic_ns();
+        *allocations = allocation_count();
+    }
+}
+
+/**
+ * Parse parser->input to the end, returns the number of steps
+ */
+static int run_parse(Parser* parser, ParseResult* result) {
+    // Main parsing loop
+    int step = 0;
+    parser->step_number = 0;
+    bool done = false;
+    uint64_t loop_started = stats_clock(parser);
+    uint64_t scan_before_loop = parser->stats ? parser->stats->scan_ns : 0;
+    
+    // The generated engine does the whole parse, the loop is skipped
+    if (parser_uses_engine(parser)) {
+        step = run_engine(parser, result);
+        done = true;
+    }
+    
+    while (!done && parser->input->current) {
+        Token* current_token = parser->input->current;
+        int state = stack_top_state(parser->stack);
+        
+        if (state < 0) {
+            result->error_message = safe_strdup("Stack underflow");
+            break;
+        }
+
+        int action_value = tables_action(parser->tables, state, current_token->type);
+        ActionType action_type = action_type_of(action_value);
+        int action_param = action_value_of(action_value);
+        
+        step++;
+        
+        // Only render the action when a full trace is requested
+        const char* action_str = NULL;
+        if (parser->trace_level >= TRACE_FILE) {
+            uint64_t render_started = stats_clock(parser);
+            strbuf_clear(&parser->trace_action);
+            automaton_append_action(&parser->trace_action, action_value, parser->tables);
+            action_str = parser->trace_action.data;
+            if (parser->stats) {
+                parser->stats->trace_ns += monotonic_ns() - render_started;
+            }
+        }
+        
+        switch (action_type) {
+            case ACTION_SHIFT:
+                // Write debug output
+                write_debug_output(parser, "SHIFT", action_str);
+                write_trace_record(parser, TRACE_SHIFT, action_param, 0, action_param);
+                
+                // Perform shift operation
+                if (!perform_shift(parser, action_param, current_token)) {
+                    result->error_message = safe_strdup("Shift operation failed");
+                    done = true;
+                    break;
+                }
+                
+                // Get next token
+                advance_input(parser);
+                parser->recovering = false;
+                break;
+                
+            case ACTION_REDUCE:
+                // Write debug output
+                write_debug_output(parser, "REDUCE", action_str);
+                write_reduce_record(parser, action_param);
+                
+                // Perform reduce operation
+                if (!perform_reduce(parser, action_param)) {
+                    result->error_message = safe_strdup("Reduce operation failed");
+                    done = true;
+                    break;
+                }
+                break;
+                
+            case ACTION_ACCEPT:
+                // Write debug output
+                write_debug_output(parser, "ACCEPT", "Input accepted");
+                write_trace_record(parser, TRACE_ACCEPT, 0, 0, -1);
+                done = true;
+                
+                // Reached after recovering from errors, only the errors count
+                if (parser->error_count > 0) {
+                    break;
+                }
+                
+                // The start symbol's value (or node) is on top of the stack
+                if (parser->ast_builder) {
+                    uint32_t root = stack_value_at(parser->stack, stack_size(parser->stack) - 1).node;
+                    result->ast = ast_builder_finish(parser->ast_builder, root);
+                } else if (parser->actions) {
+                    result->value = stack_value_at(parser->stack, stack_size(parser->stack) - 1);
+                    result->has_value = true;
+                }
+                result->success = true;
+                break;
+                
+            case ACTION_ERROR:
+            default:
+                // Write debug output
+                write_debug_output(parser, "ERROR", "Invalid syntax");
+                write_trace_record(parser, TRACE_ERROR, 0, 0, -1);
+                
+                // Errors before the next shift belong to the one being recovered from
+                if (!parser->recovering) {
+                    record_error(parser, result, current_token, state);
+                }
+                if (parser->error_count >= parser->max_errors ||
+                    !recover_from_error(parser, parser->recovering)) {
+                    done = true;
+                } else {
+                    parser->recovering = true;
+                }
+                break;
+        }
+        
+    }
+    
+    result->steps_taken = step;
+    
+    // Input cut short by a read error fails whatever its tokens parsed to
+    if (parser->input->read_failed) {
+        free(result->error_message);
+        result->success = false;
+        result->error_line = parser->input->line;
+        result->error_position = parser->input->position;
+        result->error_message = safe_strdup("Read error in input file");
+    }
+    
+    // Everything in the loop that is neither scanning nor tracing
+    if (parser->stats) {
+        ParseStats* stats = parser->stats;
+        uint64_t loop_ns = monotonic_ns() - loop_started;
+        uint64_t other_ns = (stats->scan_ns - scan_before_loop) + stats->trace_ns;
+        stats->dispatch_ns = loop_ns > other_ns ? loop_ns - other_ns : 0;
+        stats->steps = (uint64_t)step;
+        stats->tokens_scanned = (uint64_t)parser->input->token_count;
+        stats->bytes_read = (uint64_t)parser->input->bytes_read;
+    }
+    
+    return step;
+}
+
+/**
+ * Hand the counters of the finished parse to the result
+ */
+static void end_stats(Parser* parser, ParseResult* result, uint64_t started, uint64_t allocations) {
+    if (parser->stats) {
+        parser->stats->allocations = allocation_count() - allocations;
+        parser->stats->total_ns = monotonic_ns() - started;
+        result->stats = parser->stats;
+        parser->stats = NULL;
+    }
+}
+
 /**
  * Initialize the parser stack with initial state
  */
@@ -360,8 +702,15 @@ static void init_parser_stack(Parser* parser) {
         return;
     }
     
-    // Create a dummy EOF token
-    Token* eof_token = token_create(TOKEN_EOF, "$", 0, 0);
+    // Dummy EOF token, embedded in the parser so it needs no allocation
+    Token* eof_token = &parser->bottom_token;
+    eof_token->type = TOKEN_EOF;
+    eof_token->lexeme = "$";
+    eof_token->length = 1;
+    eof_token->owns_lexeme = false;
+    eof_token->line_number = 0;
+    eof_token->position = 0;
+    eof_token->next = NULL;
     
     // Push initial state and EOF token
     stack_push(parser->stack, 0, eof_token);
@@ -369,32 +718,256 @@ static void init_parser_stack(Parser* parser) {
 }
 
 /**
- * Get a string representation of the current input position
+ * Add a syntax error to the result, the first one also fills error_*
+ * The expected tokens of the rejecting state are table lookups
  */
-static char* get_input_position_string(TokenStream* stream) {
-    if (!stream || !stream->current) {
-        return safe_strdup("End of Input");
+static void record_error(Parser* parser, ParseResult* result, Token* token, int state) {
+    char* message = string_format("Syntax error at line %d, position %d: unexpected token '%.*s', %s",
+                                  token->line_number, token->position,
+                                  token->length, token->lexeme,
+                                  tables_expected_message(parser->tables, state));
+    
+    if (parser->error_count == 0) {
+        result->error_line = token->line_number;
+        result->error_position = token->position;
+        result->error_message = safe_strdup(message);
     }
     
-    // Show current token and next few tokens
-    char* result = safe_strdup("");
-    Token* current = stream->current;
-    int count = 0;
+    // --recover=<n> takes any limit, so grow geometrically
+    if (result->error_count == result->error_capacity) {
+        result->error_capacity = result->error_capacity ? result->error_capacity * 2 : 4;
+        result->errors = (ParseError*)safe_realloc(result->errors,
+                                                   sizeof(ParseError) * result->error_capacity);
+    }
+    ParseError* error = &result->errors[result->error_count++];
+    error->line = token->line_number;
+    error->position = token->position;
+    error->expected = tables_expected(parser->tables, state);
+    error->message = message;
     
-    while (current && count < 5) {
-        char* token_str = token_to_string(current);
-        
-        // Add separator
-        if (count > 0) {
-            result = string_append(result, " ");
+    parser->error_count++;
+}
+
+/**
+ * Token that a state must have an action for to resume after an error
+ */
+typedef struct {
+    const ParsingTables* tables;
+    TokenType type;
+} ResumeToken;
+
+/**
+ * Check whether a state can go on with the token of a ResumeToken
+ */
+static bool can_resume(int state, const void* context) {
+    const ResumeToken* resume = (const ResumeToken*)context;
+    return action_type_of(tables_action(resume->tables, state, resume->type)) != ACTION_ERROR;
+}
+
+/**
+ * Give a popped symbol back to the input, unless it is the bottom marker
+ */
+static void release_symbol(Token* symbol, void* context) {
+    Parser* parser = (Parser*)context;
+    if (symbol != &parser->bottom_token) {
+        token_stream_release(parser->input, symbol);
+    }
+}
+
+/**
+ * Panic mode: skip input tokens until some state on the stack has an
+ * action for the current one, then pop down to the topmost such state.
+ * ')' and the end of input (the usual synchronizing tokens) are taken
+ * by any state below an open parenthesis or an expression, but resuming
+ * on any acceptable token also finds the errors that follow a top-level
+ * one instead of skipping the rest of the input. skip_current drops the
+ * current token first, for a token that failed again right after a
+ * recovery. Returns false if the input cannot be resumed.
+ */
+static bool recover_from_error(Parser* parser, bool skip_current) {
+    TokenStream* input = parser->input;
+    int skipped = 0;
+    int keep = 0;
+    
+    if (skip_current) {
+        if (input->current->type == TOKEN_EOF) {
+            return false;
+        }
+        token_stream_release(input, advance_input(parser));
+        skipped++;
+    }
+    
+    for (;;) {
+        if (!input->current) {
+            return false;
         }
         
-        result = string_append(result, token_str);
-        free(token_str);
-        
-        current = current->next;
-        count++;
+        // Topmost state that can go on with this token, in one walk down the stack
+        ResumeToken resume = { parser->tables, input->current->type };
+        keep = stack_find_top_state(parser->stack, can_resume, &resume) + 1;
+        if (keep > 0) {
+            break;
+        }
+        if (resume.type == TOKEN_EOF) {
+            return false;
+        }
+        token_stream_release(input, advance_input(parser));
+        skipped++;
     }
     
-    return result;
-}
\ No newline at end of file
+    int popped = stack_size(parser->stack) - keep;
+    stack_pop_n_visit(parser->stack, popped, release_symbol, parser);
+    parser->current_state = stack_top_state(parser->stack);
+    
+    if (parser->trace_level >= TRACE_FILE) {
+        char* action = string_format("Skipped %d tokens, popped %d states, resuming at '%.*s'",
+                                     skipped, popped, input->current->length, input->current->lexeme);
+        write_debug_output(parser, "RECOVER", action);
+        free(action);
+    }
+    write_trace_record(parser, TRACE_RECOVER, skipped, popped, -1);
+    return true;
+}
+
+/**
+ * Drop everything above the bottom element so the parser can be reused
+ */
+static void reset_parser_stack(Parser* parser) {
+    int size = stack_size(parser->stack);
+    
+    if (size == 0) {
+        init_parser_stack(parser);
+    } else {
+        stack_pop_n(parser->stack, size - 1);
+    }
+    parser->current_state = 0;
+    parser->error_count = 0;
+}
+
+/**
+ * Close the debug file opened by parser_parse
+ */
+static void close_debug_file(Parser* parser) {
+    if (parser->trace_pipe) {
+        if (!async_writer_close(parser->trace_pipe)) {
+            log_error("Failed to write the debug file");
+        }
+        parser->trace_pipe = NULL;
+    }
+    if (parser->debug_file) {
+        fclose(parser->debug_file);
+        parser->debug_file = NULL;
+    }
+    if (parser->trace_writer) {
+        if (!trace_writer_close(parser->trace_writer)) {
+            log_error("Failed to write the trace file");
+        }
+        parser->trace_writer = NULL;
+    }
+}
+
+/**
+ * Append a step to the binary trace, next_state < 0 when nothing is pushed
+ * Called before the step is performed, except for TRACE_RECOVER
+ */
+static void write_trace_record(Parser* parser, TraceOperation operation, int param,
+                               int popped, int next_state) {
+    if (!parser->trace_writer) {
+        return;
+    }
+    uint64_t started = stats_clock(parser);
+    
+    TraceRecord record = {
+        .token = parser->token_index,
+        .popped = (uint32_t)popped,
+        .state = (uint16_t)parser->current_state,
+        .next_state = (uint16_t)(next_state < 0 ? 0 : next_state),
+        .param = (uint16_t)(param > UINT16_MAX ? UINT16_MAX : param),
+        .operation = (uint8_t)operation,
+        .pushed = next_state < 0 ? 0 : 1
+    };
+    trace_writer_add(parser->trace_writer, &record);
+    if (parser->stats) {
+        parser->stats->trace_ns += monotonic_ns() - started;
+    }
+}
+
+/**
+ * Trace record of a reduction, its goto state is looked up in advance
+ */
+static void write_reduce_record(Parser* parser, int production_num) {
+    if (!parser->trace_writer || production_num <= 0 ||
+        production_num > parser->tables->num_productions) {
+        return;
+    }
+    
+    const Production* production = &parser->tables->productions[production_num];
+    int below = stack_size(parser->stack) - 1 - production->rhs_length;
+    int goto_state = below >= 0
+                     ? get_goto_state(parser->tables, stack_state_at(parser->stack, below), production->lhs)
+                     : -1;
+    write_trace_record(parser, TRACE_REDUCE, production_num, production->rhs_length,
+                       goto_state < 0 ? 0 : goto_state);
+}
+
+/**
+ * Move to the next input token, returns the consumed one
+ */
+static Token* advance_input(Parser* parser) {
+    uint64_t started = stats_clock(parser);
+    Token* token = get_next_token(parser->input);
+    parser->token_index++;
+    if (parser->stats) {
+        parser->stats->scan_ns += monotonic_ns() - started;
+    }
+    return token;
+}
+
+/**
+ * Parse the open input with the generated engine, returns the steps taken
+ */
+static int run_engine(Parser* parser, ParseResult* result) {
+    EngineRun run = {
+        .input = parser->input,
+        .states = parser->engine_states,
+        .capacity = parser->engine_capacity,
+        .steps = 0,
+        .error_token = NULL,
+        .error_state = 0
+    };
+    EngineStatus status = engine_run(&run);
+    parser->engine_states = run.states;
+    parser->engine_capacity = run.capacity;
+    
+    switch (status) {
+        case ENGINE_ACCEPTED:
+            result->success = true;
+            break;
+        case ENGINE_REJECTED:
+            record_error(parser, result, run.error_token, run.error_state);
+            break;
+        case ENGINE_FAILED:
+        default:
+            log_error("Invalid goto state in the generated engine");
+            result->error_message = safe_strdup("Reduce operation failed");
+            break;
+    }
+    return run.steps;
+}
+
+/**
+ * Clock reading for a phase time, 0 when no counters are collected
+ */
+static uint64_t stats_clock(const Parser* parser) {
+    return parser->stats ? monotonic_ns() : 0;
+}
+
+/**
+ * Track the deepest stack after a push
+ */
+static void stats_count_push(Parser* parser) {
+    int depth = stack_size(parser->stack);
+    if (depth > parser->stats->max_stack_depth) {
+        parser->stats->max_stack_depth = depth;
+    }
+}
@@ -0,0 +1,290 @@
+/**
+ * @file scan_simd.c
+ * @brief Vectorized byte scanning primitives
+ * @members: Group
+ *
+ * Each backend compares 16 or 32 input bytes at a time and turns the
+ * result into a bitmask: the first match is the lowest set bit and the
+ * newlines crossed are the popcount of the newline mask. The scalar
+ * functions are the reference implementation and handle the tails.
+ * Build with SCAN_SCALAR defined to use only the scalar code.
+ */
+
+ #include <stdint.h>
+ #include <stddef.h>
+ #include "../include/scan_simd.h"
+
+ #if !defined(SCAN_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+ #define SCAN_USE_SSE2
+ #include <emmintrin.h>
+ #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #define SCAN_USE_AVX2
+ #include <immintrin.h>
+ #endif
+ #elif !defined(SCAN_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+ #define SCAN_USE_NEON
+ #include <arm_neon.h>
+ #endif
+
+ /* Bit helpers (masks are never zero when these are called) */
+ #if defined(__GNUC__)
+ #define FIRST_BIT(mask) ((unsigned)__builtin_ctz(mask))
+ #define LAST_BIT(mask)  (31u - (unsigned)__builtin_clz(mask))
+ #define POPCOUNT(mask)  (__builtin_popcount(mask))
+ #else
+ static unsigned FIRST_BIT(uint32_t mask) { unsigned i = 0; while (!(mask & 1u)) { mask >>= 1; i++; } return i; }
+ static unsigned LAST_BIT(uint32_t mask) { unsigned i = 0; while (mask >>= 1) { i++; } return i; }
+ static int POPCOUNT(uint32_t mask) { int n = 0; while (mask) { mask &= mask - 1; n++; } return n; }
+ #endif
+
+ /**
+  * Record the newlines in mask (bit i = base[i] is '\n')
+  */
+ static inline void account_newlines(ScanLines* lines, const char* base, uint32_t mask) {
+     if (mask) {
+         lines->newlines += POPCOUNT(mask);
+         lines->line_start = base + LAST_BIT(mask) + 1;
+     }
+ }
+
+ /**
+  * Same test as isspace() in the C locale
+  */
+ static inline int is_space_byte(unsigned char c) {
+     return c == ' ' || (c >= '\t' && c <= '\r');
+ }
+
+ /* Scalar reference implementation */
+
+ static const char* scalar_skip_space(const char* pos, const char* end, ScanLines* lines) {
+     while (pos < end && is_space_byte((unsigned char)*pos)) {
+         if (*pos == '\n') {
+             lines->newlines++;
+             lines->line_start = pos + 1;
+         }
+         pos++;
+     }
+     return pos;
+ }
+
+ static const char* scalar_find2(const char* pos, const char* end, char a, char b) {
+     while (pos < end && *pos != a && *pos != b) {
+         pos++;
+     }
+     return pos;
+ }
+
+ static const char* scalar_find3(const char* pos, const char* end, char a, char b, char c) {
+     while (pos < end && *pos != a && *pos != b && *pos != c) {
+         pos++;
+     }
+     return pos;
+ }
+
+ /**
+  * Block loops shared by the vector backends. Each backend provides
+  * <name>_load, <name>_space_mask, <name>_eq_mask and <name>_any_mask
+  * for blocks of width bytes.
+  */
+ #define SCAN_DEFINE_LOOPS(name, width, ATTR)                                          \
+     ATTR static const char* name##_skip_space(const char* pos, const char* end,       \
+                                               ScanLines* lines) {                     \
+         while (end - pos >= (width)) {                                                \
+             name##_vec block = name##_load(pos);                                      \
+             uint32_t stop = ~name##_space_mask(block) & name##_FULL;                  \
+             uint32_t newline = name##_eq_mask(block, '\n');                           \
+             if (stop) {                                                               \
+                 unsigned index = FIRST_BIT(stop);                                     \
+                 account_newlines(lines, pos, newline & ((1u << index) - 1u));         \
+                 return pos + index;                                                   \
+             }                                                                         \
+             account_newlines(lines, pos, newline);                                    \
+             pos += (width);                                                           \
+         }                                                                             \
+         return scalar_skip_space(pos, end, lines);                                    \
+     }                                                                                 \
+                                                                                       \
+     ATTR static const char* name##_find2(const char* pos, const char* end,            \
+                                          char a, char b) {                            \
+         while (end - pos >= (width)) {                                                \
+             name##_vec block = name##_load(pos);                                      \
+             uint32_t match = name##_eq_mask(block, a) | name##_eq_mask(block, b);     \
+             if (match) {                                                              \
+                 return pos + FIRST_BIT(match);                                        \
+             }                                                                         \
+             pos += (width);                                                           \
+         }                                                                             \
+         return scalar_find2(pos, end, a, b);                                          \
+     }                                                                                 \
+                                                                                       \
+     ATTR static const char* name##_find3(const char* pos, const char* end,            \
+                                          char a, char b, char c) {                    \
+         while (end - pos >= (width)) {                                                \
+             name##_vec block = name##_load(pos);                                      \
+             uint32_t match = name##_eq_mask(block, a) | name##_eq_mask(block, b) |    \
+                              name##_eq_mask(block, c);                                \
+             if (match) {                                                              \
+                 return pos + FIRST_BIT(match);                                        \
+             }                                                                         \
+             pos += (width);                                                           \
+         }                                                                             \
+         return scalar_find3(pos, end, a, b, c);                                       \
+     }
+
+ #ifdef SCAN_USE_SSE2
+
+ /* SSE2: 16 bytes per block */
+
+ typedef __m128i sse2_vec;
+ #define sse2_FULL 0xFFFFu
+
+ static inline sse2_vec sse2_load(const char* pos) {
+     return _mm_loadu_si128((const __m128i*)pos);
+ }
+
+ static inline uint32_t sse2_eq_mask(sse2_vec block, char c) {
+     return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+ }
+
+ static inline uint32_t sse2_space_mask(sse2_vec block) {
+     // ' ' or '\t'..'\r': (c - '\t') as unsigned is at most 4
+     __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+     __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+     __m128i space = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+     return (uint32_t)_mm_movemask_epi8(_mm_or_si128(space, control));
+ }
+
+ SCAN_DEFINE_LOOPS(sse2, 16, )
+
+ #endif /* SCAN_USE_SSE2 */
+
+ #ifdef SCAN_USE_AVX2
+
+ /* AVX2: 32 bytes per block, selected at run time */
+
+ #define AVX2_ATTR __attribute__((target("avx2")))
+
+ typedef __m256i avx2_vec;
+ #define avx2_FULL 0xFFFFFFFFu
+
+ AVX2_ATTR static inline avx2_vec avx2_load(const char* pos) {
+     return _mm256_loadu_si256((const __m256i*)pos);
+ }
+
+ AVX2_ATTR static inline uint32_t avx2_eq_mask(avx2_vec block, char c) {
+     return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(c)));
+ }
+
+ AVX2_ATTR static inline uint32_t avx2_space_mask(avx2_vec block) {
+     __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+     __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+     __m256i space = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+     return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(space, control));
+ }
+
+ SCAN_DEFINE_LOOPS(avx2, 32, AVX2_ATTR)
+
+ #endif /* SCAN_USE_AVX2 */
+
+ #ifdef SCAN_USE_NEON
+
+ /* NEON: 16 bytes per block */
+
+ typedef uint8x16_t neon_vec;
+ #define neon_FULL 0xFFFFu
+
+ static inline neon_vec neon_load(const char* pos) {
+     return vld1q_u8((const uint8_t*)pos);
+ }
+
+ /**
+  * Collapse a byte-wise compare result into one bit per byte
+  */
+ static inline uint32_t neon_movemask(uint8x16_t compare) {
+     static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128,
+                                       1, 2, 4, 8, 16, 32, 64, 128 };
+     uint8x16_t masked = vandq_u8(compare, vld1q_u8(bits));
+     uint8x16_t sum = vpaddq_u8(masked, masked);
+     sum = vpaddq_u8(sum, sum);
+     sum = vpaddq_u8(sum, sum);
+     return (uint32_t)vgetq_lane_u16(vreinterpretq_u16_u8(sum), 0);
+ }
+
+ static inline uint32_t neon_eq_mask(neon_vec block, char c) {
+     return neon_movemask(vceqq_u8(block, vdupq_n_u8((uint8_t)c)));
+ }
+
+ static inline uint32_t neon_space_mask(neon_vec block) {
+     uint8x16_t shifted = vsubq_u8(block, vdupq_n_u8('\t'));
+     uint8x16_t control = vcleq_u8(shifted, vdupq_n_u8(4));
+     uint8x16_t space = vceqq_u8(block, vdupq_n_u8(' '));
+     return neon_movemask(vorrq_u8(space, control));
+ }
+
+ SCAN_DEFINE_LOOPS(neon, 16, )
+
+ #endif /* SCAN_USE_NEON */
+
+ /* Backend selection */
+
+ #if defined(SCAN_USE_SSE2)
+ static const char* (*skip_space_impl)(const char*, const char*, ScanLines*) = sse2_skip_space;
+ static const char* (*find2_impl)(const char*, const char*, char, char) = sse2_find2;
+ static const char* (*find3_impl)(const char*, const char*, char, char, char) = sse2_find3;
+ static const char* backend_name = "sse2";
+ #elif defined(SCAN_USE_NEON)
+ static const char* (*skip_space_impl)(const char*, const char*, ScanLines*) = neon_skip_space;
+ static const char* (*find2_impl)(const char*, const char*, char, char) = neon_find2;
+ static const char* (*find3_impl)(const char*, const char*, char, char, char) = neon_find3;
+ static const char* backend_name = "neon";
+ #else
+ static const char* (*skip_space_impl)(const char*, const char*, ScanLines*) = scalar_skip_space;
+ static const char* (*find2_impl)(const char*, const char*, char, char) = scalar_find2;
+ static const char* (*find3_impl)(const char*, const char*, char, char, char) = scalar_find3;
+ static const char* backend_name = "scalar";
+ #endif
+
+ #ifdef SCAN_USE_AVX2
+ /**
+  * Switch to the AVX2 loops before main() if the CPU supports them
+  */
+ __attribute__((constructor)) static void scan_select_backend(void) {
+     __builtin_cpu_init();
+     if (__builtin_cpu_supports("avx2")) {
+         skip_space_impl = avx2_skip_space;
+         find2_impl = avx2_find2;
+         find3_impl = avx2_find3;
+         backend_name = "avx2";
+     }
+ }
+ #endif
+
+ /**
+  * Skip whitespace
+  */
+ const char* scan_skip_space(const char* pos, const char* end, ScanLines* lines) {
+     lines->newlines = 0;
+     lines->line_start = NULL;
+     return skip_space_impl(pos, end, lines);
+ }
+
+ /**
+  * Find the first of two bytes
+  */
+ const char* scan_find2(const char* pos, const char* end, char a, char b) {
+     return find2_impl(pos, end, a, b);
+ }
+
+ /**
+  * Find the first of three bytes
+  */
+ const char* scan_find3(const char* pos, const char* end, char a, char b, char c) {
+     return find3_impl(pos, end, a, b, c);
+ }
+
+ /**
+  * Name of the active backend
+  */
+ const char* scan_backend_name(void) {
+     return backend_name;
+ }
@@ -0,0 +1,82 @@
+/**
+ * @file semantic.c
+ * @brief Reduce actions evaluating arithmetic expressions
+ * @members: Group
+ */
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/semantic.h"
+
+ // Longest NUM lexeme converted, longer ones are truncated
+ #define SEMANTIC_MAX_LITERAL 63
+
+ /**
+  * x → y: pass the value through
+  */
+ SemValue semantic_copy(Stack* stack, int base) {
+     return stack_value_at(stack, base);
+ }
+
+ /**
+  * e → e + t
+  */
+ static SemValue action_add(Stack* stack, int base) {
+     SemValue value;
+     value.number = stack_value_at(stack, base).number + stack_value_at(stack, base + 2).number;
+     return value;
+ }
+
+ /**
+  * t → t * f
+  */
+ static SemValue action_multiply(Stack* stack, int base) {
+     SemValue value;
+     value.number = stack_value_at(stack, base).number * stack_value_at(stack, base + 2).number;
+     return value;
+ }
+
+ /**
+  * f → (e)
+  */
+ static SemValue action_group(Stack* stack, int base) {
+     return stack_value_at(stack, base + 1);
+ }
+
+ /**
+  * f → NUM: convert the lexeme, which need not be NUL-terminated
+  */
+ static SemValue action_literal(Stack* stack, int base) {
+     Token* token = stack_symbol_at(stack, base);
+     char literal[SEMANTIC_MAX_LITERAL + 1];
+     int length = token && token->length < SEMANTIC_MAX_LITERAL ? token->length : SEMANTIC_MAX_LITERAL;
+     SemValue value;
+
+     if (!token) {
+         value.number = 0;
+         return value;
+     }
+     memcpy(literal, token->lexeme, length);
+     literal[length] = '\0';
+     value.number = strtod(literal, NULL);
+     return value;
+ }
+
+ // Actions by production number, matching grammar_productions in automaton.c
+ static const SemanticAction EXPR_ACTIONS[] = {
+     NULL,            // Dummy production
+     semantic_copy,   // 1. s → e
+     action_add,      // 2. e → e + t
+     semantic_copy,   // 3. e → t
+     action_multiply, // 4. t → t * f
+     semantic_copy,   // 5. t → f
+     action_group,    // 6. f → (e)
+     action_literal   // 7. f → NUM
+ };
+
+ /**
+  * Reduce actions evaluating the built-in expression grammar
+  */
+ const SemanticAction* semantic_expr_actions(void) {
+     return EXPR_ACTIONS;
+ }
@@ -0,0 +1,286 @@
+/**
+ * @file split.c
+ * @brief Split mode: parse the independent expressions of one file in parallel
+ * @members: Group
+ *
+ * The boundaries are found in one pass over the mapping, which only
+ * looks for newlines or, with a delimiter, for '<' and the category of
+ * the token it opens. Every expression is a slice of the mapping with
+ * the line and position it starts at. The workers take blocks of
+ * SPLIT_BLOCK slices from a shared counter, so no lock is needed and an
+ * expensive expression only holds up its own block. Each result goes to
+ * the slot of its expression and the lines are written in input order
+ * at the end.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <ctype.h>
+ #include <stdatomic.h>
+ #include "../include/split.h"
+ #include "../include/scan_simd.h"
+ #include "../include/workers.h"
+ #include "../include/utils.h"
+
+ // Expressions a worker takes from the counter at once
+ #define SPLIT_BLOCK 256
+
+ /**
+  * One expression: a slice of the mapped file
+  */
+ typedef struct {
+     size_t offset;  // First byte in the file
+     size_t length;  // Bytes of token text
+     int line;       // Line of the first byte
+     int position;   // Position of the first byte in its line
+ } SplitSlice;
+
+ /**
+  * Growable list of expressions
+  */
+ typedef struct {
+     SplitSlice* slices;
+     int count;
+     int capacity;
+ } SliceList;
+
+ /**
+  * State shared by the workers (only next is written concurrently)
+  */
+ typedef struct {
+     const char* data;     // Mapped file
+     const SplitSlice* slices;
+     WorkerResult* results;
+     TokenStream** inputs; // Buffer stream of each worker, moved from expression to expression
+     int count;            // Expressions
+     _Atomic int next;     // First expression of the next block to take
+ } SplitShared;
+
+ /**
+  * Add the expression from start to end unless it is blank
+  */
+ static void slice_list_add(SliceList* list, const char* data, const char* start, const char* end,
+                            int line, int position) {
+     // Start at the first token, which is the line reported for the expression
+     for (; start < end && isspace((unsigned char)*start); start++) {
+         if (*start == '\n') {
+             line++;
+             position = 0;
+         } else {
+             position++;
+         }
+     }
+     if (start == end) {
+         return;
+     }
+     if (list->count == list->capacity) {
+         list->capacity = list->capacity ? list->capacity * 2 : 1024;
+         list->slices = (SplitSlice*)safe_realloc(list->slices, sizeof(SplitSlice) * list->capacity);
+     }
+     SplitSlice* slice = &list->slices[list->count++];
+     slice->offset = (size_t)(start - data);
+     slice->length = (size_t)(end - start);
+     slice->line = line;
+     slice->position = position;
+ }
+
+ /**
+  * One expression per line
+  */
+ static void split_lines(SliceList* list, const char* data, size_t size) {
+     const char* pos = data;
+     const char* end = data + size;
+
+     for (int line = 1; pos < end; line++) {
+         const char* newline = (const char*)memchr(pos, '\n', (size_t)(end - pos));
+         const char* line_end = newline ? newline : end;
+         slice_list_add(list, data, pos, line_end, line, 0);
+         pos = newline ? newline + 1 : end;
+     }
+ }
+
+ /**
+  * End of the well-formed token opened by the '<' at open (as the scanner
+  * reads it), NULL if there is none; category receives its category
+  */
+ static const char* token_end(const char* open, const char* end, const char** category,
+                              size_t* category_length) {
+     // Lexeme up to the first comma, not empty
+     const char* lexeme = open + 1;
+     const char* pos = scan_find3(lexeme, end, ',', '>', '\n');
+     if (pos == end || *pos != ',' || pos == lexeme) {
+         return NULL;
+     }
+
+     // Optional whitespace on the same line, then the category up to '>'
+     pos++;
+     while (pos < end && *pos != '\n' && isspace((unsigned char)*pos)) {
+         pos++;
+     }
+     *category = pos;
+     pos = scan_find2(pos, end, '>', '\n');
+     if (pos == end || *pos != '>') {
+         return NULL;
+     }
+     *category_length = (size_t)(pos - *category);
+     return pos + 1;
+ }
+
+ /**
+  * Expressions between tokens of the delimiter category
+  */
+ static void split_tokens(SliceList* list, const char* data, size_t size, const char* delimiter) {
+     size_t delimiter_length = strlen(delimiter);
+     const char* end = data + size;
+     const char* pos = data;
+
+     // Line bookkeeping for the start of the next expression
+     int line = 1;
+     const char* line_start = data;
+     const char* start = data;
+     int start_line = 1;
+     int start_position = 0;
+
+     while (pos < end) {
+         const char* found = scan_find2(pos, end, '<', '\n');
+         if (found == end) {
+             break;
+         }
+         if (*found == '\n') {
+             line++;
+             line_start = found + 1;
+             pos = found + 1;
+             continue;
+         }
+
+         const char* category = NULL;
+         size_t category_length = 0;
+         const char* after = token_end(found, end, &category, &category_length);
+         if (!after) {
+             // Not a token, the scanner skips the '<' as well
+             pos = found + 1;
+             continue;
+         }
+         if (category_length == delimiter_length && memcmp(category, delimiter, delimiter_length) == 0) {
+             slice_list_add(list, data, start, found, start_line, start_position);
+             start = after;
+             start_line = line;
+             start_position = (int)(after - line_start);
+         }
+         pos = after;
+     }
+     slice_list_add(list, data, start, end, start_line, start_position);
+ }
+
+ /**
+  * Parse one expression into its result slot
+  */
+ static void parse_slice(WorkerThread* worker, TokenStream** input, const char* data,
+                         const SplitSlice* slice, WorkerResult* slot) {
+     // One stream per worker, so an expression costs no stream or arena allocation
+     if (*input) {
+         token_stream_reset_buffer(*input, data + slice->offset, slice->length,
+                                   slice->line, slice->position);
+     } else {
+         unsigned flags = worker->parser->input_flags & TOKEN_STREAM_STREAMING;
+         *input = token_stream_open_buffer(data + slice->offset, slice->length,
+                                           slice->line, slice->position, flags);
+     }
+     ParseResult result = parser_parse_stream(worker->parser, *input);
+     worker_result_store(slot, &result, worker->stats);
+ }
+
+ /**
+  * Worker loop: take blocks until every expression is taken
+  */
+ static void split_loop(WorkerThread* worker) {
+     SplitShared* shared = (SplitShared*)worker->shared;
+     TokenStream** input = &shared->inputs[worker->index];
+
+     for (;;) {
+         int first = atomic_fetch_add(&shared->next, SPLIT_BLOCK);
+         if (first >= shared->count) {
+             break;
+         }
+         int last = first + SPLIT_BLOCK < shared->count ? first + SPLIT_BLOCK : shared->count;
+         for (int i = first; i < last; i++) {
+             parse_slice(worker, input, shared->data, &shared->slices[i], &shared->results[i]);
+         }
+     }
+ }
+
+ /**
+  * Parse every expression of one input with one parser per worker
+  */
+ SplitSummary split_run(Parser* parser, const char* input_file, const char* delimiter,
+                        FILE* out, int jobs) {
+     SplitSummary summary = { 0, 0, 0, 0.0, 0, NULL };
+     double start = worker_now_seconds();
+
+     const char* data = NULL;
+     size_t size = 0;
+     if (!token_map_file(input_file, &data, &size)) {
+         log_error("Failed to map file: %s", input_file);
+         summary.failed = 1;
+         return summary;
+     }
+
+     SliceList list = { NULL, 0, 0 };
+     if (delimiter) {
+         split_tokens(&list, data, size, delimiter);
+     } else {
+         split_lines(&list, data, size);
+     }
+
+     if (jobs < 1) {
+         jobs = 1;
+     }
+     int blocks = (list.count + SPLIT_BLOCK - 1) / SPLIT_BLOCK;
+     if (jobs > blocks) {
+         jobs = blocks > 0 ? blocks : 1;
+     }
+
+     WorkerResult* results = (WorkerResult*)safe_malloc(sizeof(WorkerResult) * (list.count > 0 ? list.count : 1));
+     SplitShared shared = {
+         .data = data,
+         .slices = list.slices,
+         .results = results,
+         .inputs = (TokenStream**)safe_malloc(sizeof(TokenStream*) * jobs),
+         .count = list.count
+     };
+     for (int w = 0; w < jobs; w++) {
+         shared.inputs[w] = NULL;
+     }
+     atomic_init(&shared.next, 0);
+     if (parser->collect_stats) {
+         summary.stats = parse_stats_create(parser->tables->num_productions);
+     }
+     worker_run(parser, jobs, "split", split_loop, &shared, summary.stats);
+     for (int w = 0; w < jobs; w++) {
+         token_stream_free(shared.inputs[w]);
+     }
+     free(shared.inputs);
+
+     // Result lines in input order
+     for (int i = 0; i < list.count; i++) {
+         WorkerResult* result = &results[i];
+         if (result->success) {
+             summary.accepted++;
+         } else {
+             summary.failed++;
+         }
+         fprintf(out, "%s:%d", input_file, list.slices[i].line);
+         worker_result_print(out, result);
+         free(result->message);
+     }
+     summary.expressions = list.count;
+     summary.threads = jobs;
+
+     free(results);
+     free(list.slices);
+     token_unmap_file(data, size);
+
+     summary.seconds = worker_now_seconds() - start;
+     return summary;
+ }
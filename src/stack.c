@@ -1,7 +1,10 @@
 /**
  * @file stack.c
- * @brief Implementation of stack functions
+ * @brief Implementation of stack functions (linked list version)
  * @members: Group 
+ *
+ * Only compiled in when STACK_IMPL_LINKED is defined; the default
+ * build uses the array-backed stack in stack_array.c.
  */
 
  #include <stdio.h>
@@ -10,6 +13,8 @@
  #include "../include/stack.h"
  #include "../include/utils.h"
  
+ #ifdef STACK_IMPL_LINKED
+ 
  /**
   * Create a new stack
   */
@@ -49,6 +54,7 @@
      StackElement* element = (StackElement*)safe_malloc(sizeof(StackElement));
      element->state = state;
      element->symbol = symbol; // Just store a reference, don't copy
+     element->value = (SemValue){ 0 };
      element->next = stack->top;
      
      stack->top = element;
@@ -57,6 +63,17 @@
      return true;
  }
  
+ /**
+  * Push a new element with a semantic value
+  */
+ bool stack_push_value(Stack* stack, int state, Token* symbol, SemValue value) {
+     if (!stack_push(stack, state, symbol)) {
+         return false;
+     }
+     stack->top->value = value;
+     return true;
+ }
+ 
  /**
   * Pop an element from the stack
   */
@@ -73,6 +90,44 @@
      return element;
  }
  
+ /**
+  * Pop several elements, freeing them
+  */
+ bool stack_pop_n(Stack* stack, int count) {
+     if (!stack || count < 0 || count > stack->size) {
+         return false;
+     }
+     
+     for (int i = 0; i < count; i++) {
+         StackElement* element = stack->top;
+         stack->top = element->next;
+         free(element);
+     }
+     stack->size -= count;
+     
+     return true;
+ }
+ 
+ /**
+  * Pop several elements, visiting their symbols from the top
+  */
+ bool stack_pop_n_visit(Stack* stack, int count, void (*visit)(Token* symbol, void* context),
+                        void* context) {
+     if (!stack || count < 0 || count > stack->size) {
+         return false;
+     }
+     
+     for (int i = 0; i < count; i++) {
+         StackElement* element = stack->top;
+         stack->top = element->next;
+         visit(element->symbol, context);
+         free(element);
+     }
+     stack->size -= count;
+     
+     return true;
+ }
+ 
  /**
   * Peek at the top element without removing it
   */
@@ -84,6 +139,67 @@
      return stack->top;
  }
  
+ /**
+  * Get the state on top of the stack
+  */
+ int stack_top_state(Stack* stack) {
+     return stack_is_empty(stack) ? -1 : stack->top->state;
+ }
+ 
+ /**
+  * Find the element at a given index from the bottom
+  */
+ static StackElement* element_at(Stack* stack, int index) {
+     if (!stack || index < 0 || index >= stack->size) {
+         return NULL;
+     }
+     
+     StackElement* current = stack->top;
+     for (int i = stack->size - 1; i > index; i--) {
+         current = current->next;
+     }
+     return current;
+ }
+ 
+ /**
+  * Get the state at a given index from the bottom
+  */
+ int stack_state_at(Stack* stack, int index) {
+     StackElement* element = element_at(stack, index);
+     return element ? element->state : -1;
+ }
+ 
+ /**
+  * Find the topmost state satisfying a predicate in one walk from the top
+  */
+ int stack_find_top_state(Stack* stack, bool (*predicate)(int state, const void* context),
+                          const void* context) {
+     int index = stack_size(stack) - 1;
+     for (StackElement* current = stack ? stack->top : NULL; current; current = current->next) {
+         if (predicate(current->state, context)) {
+             return index;
+         }
+         index--;
+     }
+     return -1;
+ }
+ 
+ /**
+  * Get the symbol at a given index from the bottom
+  */
+ Token* stack_symbol_at(Stack* stack, int index) {
+     StackElement* element = element_at(stack, index);
+     return element ? element->symbol : NULL;
+ }
+ 
+ /**
+  * Get the semantic value at a given index from the bottom
+  */
+ SemValue stack_value_at(Stack* stack, int index) {
+     StackElement* element = element_at(stack, index);
+     return element ? element->value : (SemValue){ 0 };
+ }
+ 
  /**
   * Check if stack is empty
   */
@@ -102,39 +218,51 @@
   * Get a string representation of the stack
   */
  char* stack_to_string(Stack* stack) {
-     if (!stack) {
-         return safe_strdup("[]");
+     StrBuf out;
+     strbuf_init(&out);
+     stack_append_string(stack, &out);
+     return strbuf_detach(&out);
+ }
+ 
+ /**
+  * Reverse the links of a chain of elements, returns its new first element
+  */
+ static StackElement* reverse_elements(StackElement* first) {
+     StackElement* reversed = NULL;
+     while (first) {
+         StackElement* next = first->next;
+         first->next = reversed;
+         reversed = first;
+         first = next;
      }
-     
-     char* result = safe_strdup("[");
-     StackElement* current = stack->top;
-     
-     // Build string from top to bottom
-     StackElement** elements = (StackElement**)safe_malloc(sizeof(StackElement*) * stack->size);
-     int count = 0;
-     
-     while (current) {
-         elements[count++] = current;
-         current = current->next;
+     return reversed;
+ }
+ 
+ /**
+  * Append the stack as [[state symbol] ...], bottom first
+  */
+ void stack_append_string(Stack* stack, StrBuf* out) {
+     strbuf_append_char(out, '[');
+     if (!stack) {
+         strbuf_append_char(out, ']');
+         return;
      }
      
-     // Append elements in reverse order
-     for (int i = count - 1; i >= 0; i--) {
-         char* token_str = token_to_string(elements[i]->symbol);
-         char* element_str = string_format("[%d %s]", elements[i]->state, token_str);
-         
-         if (i < count - 1) {
-             result = string_append(result, " ");
+     // Walk from the bottom by reversing the links, restored afterwards
+     StackElement* bottom = reverse_elements(stack->top);
+     for (StackElement* current = bottom; current; current = current->next) {
+         if (current != bottom) {
+             strbuf_append_char(out, ' ');
          }
-         
-         result = string_append(result, element_str);
-         
-         free(token_str);
-         free(element_str);
+         strbuf_append_char(out, '[');
+         strbuf_append_int(out, current->state);
+         strbuf_append_char(out, ' ');
+         token_append_string(out, current->symbol);
+         strbuf_append_char(out, ']');
      }
+     stack->top = reverse_elements(bottom);
      
-     result = string_append(result, "]");
-     free(elements);
-     
-     return result;
- }
\ No newline at end of file
+     strbuf_append_char(out, ']');
+ }
+ 
+ #endif /* STACK_IMPL_LINKED */
@@ -0,0 +1,262 @@
+/**
+ * @file stack_array.c
+ * @brief Implementation of stack functions (contiguous array version)
+ * @members: Group
+ *
+ * States and symbols live in two parallel arrays that grow geometrically,
+ * so push and pop never touch the allocator in the steady state.
+ * Build with STACK_IMPL_LINKED defined to use the linked list in stack.c.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/stack.h"
+ #include "../include/utils.h"
+
+ #ifndef STACK_IMPL_LINKED
+
+ // Initial number of slots allocated for a new stack
+ #define STACK_INITIAL_CAPACITY 64
+
+ /**
+  * Grow the arrays so that at least one more element fits
+  */
+ static void stack_grow(Stack* stack) {
+     int capacity = stack->capacity * 2;
+
+     stack->states = (int*)safe_realloc(stack->states, sizeof(int) * capacity);
+     stack->symbols = (Token**)safe_realloc(stack->symbols, sizeof(Token*) * capacity);
+     if (stack->values) {
+         stack->values = (SemValue*)safe_realloc(stack->values, sizeof(SemValue) * capacity);
+     }
+     stack->capacity = capacity;
+ }
+
+ /**
+  * Create a new stack
+  */
+ Stack* stack_create() {
+     Stack* stack = (Stack*)safe_malloc(sizeof(Stack));
+     stack->states = (int*)safe_malloc(sizeof(int) * STACK_INITIAL_CAPACITY);
+     stack->symbols = (Token**)safe_malloc(sizeof(Token*) * STACK_INITIAL_CAPACITY);
+     stack->values = NULL;
+     stack->size = 0;
+     stack->capacity = STACK_INITIAL_CAPACITY;
+     stack->view.state = -1;
+     stack->view.symbol = NULL;
+     stack->view.value = (SemValue){ 0 };
+     stack->view.next = NULL;
+     return stack;
+ }
+
+ /**
+  * Free stack memory
+  */
+ void stack_free(Stack* stack) {
+     if (!stack) {
+         return;
+     }
+
+     // Tokens belong to the token stream, only the arrays are freed
+     free(stack->states);
+     free(stack->symbols);
+     free(stack->values);
+     free(stack);
+ }
+
+ /**
+  * Push a new element onto the stack
+  */
+ bool stack_push(Stack* stack, int state, Token* symbol) {
+     if (!stack) {
+         return false;
+     }
+
+     if (stack->size == stack->capacity) {
+         stack_grow(stack);
+     }
+
+     stack->states[stack->size] = state;
+     stack->symbols[stack->size] = symbol; // Just store a reference, don't copy
+     stack->size++;
+
+     return true;
+ }
+
+ /**
+  * Push a new element with a semantic value
+  */
+ bool stack_push_value(Stack* stack, int state, Token* symbol, SemValue value) {
+     if (!stack) {
+         return false;
+     }
+     
+     // Parsers that never evaluate do not pay for the values array
+     if (!stack->values) {
+         stack->values = (SemValue*)safe_malloc(sizeof(SemValue) * stack->capacity);
+     }
+     if (!stack_push(stack, state, symbol)) {
+         return false;
+     }
+     stack->values[stack->size - 1] = value;
+     return true;
+ }
+ 
+ /**
+  * Pop an element from the stack
+  * The returned element is a heap copy to keep the stack.h contract
+  */
+ StackElement* stack_pop(Stack* stack) {
+     if (!stack || stack_is_empty(stack)) {
+         return NULL;
+     }
+
+     stack->size--;
+
+     StackElement* element = (StackElement*)safe_malloc(sizeof(StackElement));
+     element->state = stack->states[stack->size];
+     element->symbol = stack->symbols[stack->size];
+     element->value = stack->values ? stack->values[stack->size] : (SemValue){ 0 };
+     element->next = NULL;
+     return element;
+ }
+
+ /**
+  * Pop several elements in one step
+  */
+ bool stack_pop_n(Stack* stack, int count) {
+     if (!stack || count < 0 || count > stack->size) {
+         return false;
+     }
+
+     stack->size -= count;
+     return true;
+ }
+
+ /**
+  * Pop several elements, visiting their symbols from the top
+  */
+ bool stack_pop_n_visit(Stack* stack, int count, void (*visit)(Token* symbol, void* context),
+                        void* context) {
+     if (!stack || count < 0 || count > stack->size) {
+         return false;
+     }
+
+     for (int i = stack->size - 1; i >= stack->size - count; i--) {
+         visit(stack->symbols[i], context);
+     }
+     stack->size -= count;
+     return true;
+ }
+
+ /**
+  * Peek at the top element without removing it
+  */
+ StackElement* stack_peek(Stack* stack) {
+     if (!stack || stack_is_empty(stack)) {
+         return NULL;
+     }
+
+     stack->view.state = stack->states[stack->size - 1];
+     stack->view.symbol = stack->symbols[stack->size - 1];
+     stack->view.value = stack->values ? stack->values[stack->size - 1] : (SemValue){ 0 };
+     return &stack->view;
+ }
+
+ /**
+  * Get the state on top of the stack
+  */
+ int stack_top_state(Stack* stack) {
+     return stack_is_empty(stack) ? -1 : stack->states[stack->size - 1];
+ }
+
+ /**
+  * Get the state at a given index from the bottom
+  */
+ int stack_state_at(Stack* stack, int index) {
+     if (!stack || index < 0 || index >= stack->size) {
+         return -1;
+     }
+     return stack->states[index];
+ }
+
+ /**
+  * Find the topmost state satisfying a predicate
+  */
+ int stack_find_top_state(Stack* stack, bool (*predicate)(int state, const void* context),
+                          const void* context) {
+     for (int i = stack_size(stack) - 1; i >= 0; i--) {
+         if (predicate(stack->states[i], context)) {
+             return i;
+         }
+     }
+     return -1;
+ }
+
+ /**
+  * Get the symbol at a given index from the bottom
+  */
+ Token* stack_symbol_at(Stack* stack, int index) {
+     if (!stack || index < 0 || index >= stack->size) {
+         return NULL;
+     }
+     return stack->symbols[index];
+ }
+
+ /**
+  * Get the semantic value at a given index from the bottom
+  */
+ SemValue stack_value_at(Stack* stack, int index) {
+     if (!stack || !stack->values || index < 0 || index >= stack->size) {
+         return (SemValue){ 0 };
+     }
+     return stack->values[index];
+ }
+ 
+ /**
+  * Check if stack is empty
+  */
+ bool stack_is_empty(Stack* stack) {
+     return !stack || stack->size == 0;
+ }
+
+ /**
+  * Get the number of elements in the stack
+  */
+ int stack_size(Stack* stack) {
+     return stack ? stack->size : 0;
+ }
+
+ /**
+  * Get a string representation of the stack
+  */
+ char* stack_to_string(Stack* stack) {
+     StrBuf out;
+     strbuf_init(&out);
+     stack_append_string(stack, &out);
+     return strbuf_detach(&out);
+ }
+
+ /**
+  * Append the stack as [[state symbol] ...], bottom first
+  */
+ void stack_append_string(Stack* stack, StrBuf* out) {
+     strbuf_append_char(out, '[');
+
+     // Elements are already stored bottom to top
+     for (int i = 0; stack && i < stack->size; i++) {
+         if (i > 0) {
+             strbuf_append_char(out, ' ');
+         }
+         strbuf_append_char(out, '[');
+         strbuf_append_int(out, stack->states[i]);
+         strbuf_append_char(out, ' ');
+         token_append_string(out, stack->symbols[i]);
+         strbuf_append_char(out, ']');
+     }
+
+     strbuf_append_char(out, ']');
+ }
+
+ #endif /* STACK_IMPL_LINKED */
@@ -0,0 +1,86 @@
+/**
+ * @file stats.c
+ * @brief Performance counters of a parse
+ * @members: Group
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <inttypes.h>
+ #include "../include/stats.h"
+ #include "../include/utils.h"
+
+ /**
+  * Create zeroed counters
+  */
+ ParseStats* parse_stats_create(int num_productions) {
+     ParseStats* stats = (ParseStats*)safe_malloc(sizeof(ParseStats));
+     *stats = (ParseStats){ 0 };
+     stats->num_productions = num_productions > 0 ? num_productions : 0;
+     stats->production_reduces = (uint64_t*)safe_malloc(sizeof(uint64_t) * (stats->num_productions + 1));
+     for (int i = 0; i <= stats->num_productions; i++) {
+         stats->production_reduces[i] = 0;
+     }
+     return stats;
+ }
+
+ /**
+  * Free counters
+  */
+ void parse_stats_free(ParseStats* stats) {
+     if (!stats) {
+         return;
+     }
+     free(stats->production_reduces);
+     free(stats);
+ }
+
+ /**
+  * Add the counters of a parse to a total
+  */
+ void parse_stats_add(ParseStats* total, const ParseStats* stats) {
+     total->parses += stats->parses;
+     total->steps += stats->steps;
+     total->shifts += stats->shifts;
+     total->reduces += stats->reduces;
+     for (int i = 1; i <= stats->num_productions && i <= total->num_productions; i++) {
+         total->production_reduces[i] += stats->production_reduces[i];
+     }
+     if (stats->max_stack_depth > total->max_stack_depth) {
+         total->max_stack_depth = stats->max_stack_depth;
+     }
+     total->tokens_scanned += stats->tokens_scanned;
+     total->bytes_read += stats->bytes_read;
+     total->allocations += stats->allocations;
+     total->scan_ns += stats->scan_ns;
+     total->dispatch_ns += stats->dispatch_ns;
+     total->trace_ns += stats->trace_ns;
+     total->total_ns += stats->total_ns;
+ }
+
+ /**
+  * Write the counters as one JSON object
+  */
+ void parse_stats_print_json(const ParseStats* stats, FILE* out) {
+     fprintf(out, "{\n");
+     fprintf(out, "  \"parses\": %" PRIu64 ",\n", stats->parses);
+     fprintf(out, "  \"steps\": %" PRIu64 ",\n", stats->steps);
+     fprintf(out, "  \"shifts\": %" PRIu64 ",\n", stats->shifts);
+     fprintf(out, "  \"reduces\": %" PRIu64 ",\n", stats->reduces);
+     fprintf(out, "  \"reduces_by_production\": [");
+     for (int i = 1; i <= stats->num_productions; i++) {
+         fprintf(out, "%s%" PRIu64, i > 1 ? ", " : "", stats->production_reduces[i]);
+     }
+     fprintf(out, "],\n");
+     fprintf(out, "  \"max_stack_depth\": %d,\n", stats->max_stack_depth);
+     fprintf(out, "  \"tokens_scanned\": %" PRIu64 ",\n", stats->tokens_scanned);
+     fprintf(out, "  \"bytes_read\": %" PRIu64 ",\n", stats->bytes_read);
+     fprintf(out, "  \"allocations\": %" PRIu64 ",\n", stats->allocations);
+     fprintf(out, "  \"time_ns\": {\n");
+     fprintf(out, "    \"scan\": %" PRIu64 ",\n", stats->scan_ns);
+     fprintf(out, "    \"dispatch\": %" PRIu64 ",\n", stats->dispatch_ns);
+     fprintf(out, "    \"trace\": %" PRIu64 ",\n", stats->trace_ns);
+     fprintf(out, "    \"total\": %" PRIu64 "\n", stats->total_ns);
+     fprintf(out, "  }\n");
+     fprintf(out, "}\n");
+ }
@@ -0,0 +1,146 @@
+/**
+ * @file strbuf.c
+ * @brief Implementation of the growable string builder
+ * @members: Group
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <stdarg.h>
+ #include "../include/strbuf.h"
+ #include "../include/utils.h"
+
+ // Capacity of the first allocation
+ #define STRBUF_INITIAL_CAPACITY 256
+
+ /**
+  * Initialize an empty builder
+  */
+ void strbuf_init(StrBuf* buf) {
+     buf->data = NULL;
+     buf->length = 0;
+     buf->capacity = 0;
+ }
+
+ /**
+  * Free the text of a builder
+  */
+ void strbuf_free(StrBuf* buf) {
+     free(buf->data);
+     strbuf_init(buf);
+ }
+
+ /**
+  * Empty the builder, keeping its memory
+  */
+ void strbuf_clear(StrBuf* buf) {
+     buf->length = 0;
+     if (buf->data) {
+         buf->data[0] = '\0';
+     }
+ }
+
+ /**
+  * Grow the buffer to hold extra more bytes and the terminator
+  */
+ void strbuf_reserve(StrBuf* buf, size_t extra) {
+     size_t needed = buf->length + extra + 1;
+     if (needed <= buf->capacity) {
+         return;
+     }
+
+     size_t capacity = buf->capacity ? buf->capacity : STRBUF_INITIAL_CAPACITY;
+     while (capacity < needed) {
+         capacity *= 2;
+     }
+     buf->data = (char*)safe_realloc(buf->data, capacity);
+     buf->capacity = capacity;
+ }
+
+ /**
+  * Append bytes of known length
+  */
+ void strbuf_append(StrBuf* buf, const char* text, size_t length) {
+     strbuf_reserve(buf, length);
+     memcpy(buf->data + buf->length, text, length);
+     buf->length += length;
+     buf->data[buf->length] = '\0';
+ }
+
+ /**
+  * Append a NUL-terminated string
+  */
+ void strbuf_append_str(StrBuf* buf, const char* text) {
+     strbuf_append(buf, text, strlen(text));
+ }
+
+ /**
+  * Append one character
+  */
+ void strbuf_append_char(StrBuf* buf, char c) {
+     strbuf_reserve(buf, 1);
+     buf->data[buf->length++] = c;
+     buf->data[buf->length] = '\0';
+ }
+
+ /**
+  * Append an integer in decimal, without going through printf
+  */
+ void strbuf_append_int(StrBuf* buf, long value) {
+     char digits[24];
+     int count = 0;
+     unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+
+     do {
+         digits[count++] = (char)('0' + magnitude % 10);
+         magnitude /= 10;
+     } while (magnitude > 0);
+
+     strbuf_reserve(buf, (size_t)count + 1);
+     if (value < 0) {
+         buf->data[buf->length++] = '-';
+     }
+     while (count > 0) {
+         buf->data[buf->length++] = digits[--count];
+     }
+     buf->data[buf->length] = '\0';
+ }
+
+ /**
+  * Append printf-style formatted text
+  */
+ void strbuf_appendf(StrBuf* buf, const char* format, ...) {
+     va_list args;
+     va_start(args, format);
+
+     // Format in place when it fits, otherwise grow once and format again
+     va_list args_copy;
+     va_copy(args_copy, args);
+     strbuf_reserve(buf, 0);
+     size_t room = buf->capacity - buf->length;
+     int length = vsnprintf(buf->data + buf->length, room, format, args_copy);
+     va_end(args_copy);
+
+     if (length < 0) {
+         buf->data[buf->length] = '\0';
+         va_end(args);
+         return;
+     }
+     if ((size_t)length >= room) {
+         strbuf_reserve(buf, (size_t)length);
+         vsnprintf(buf->data + buf->length, (size_t)length + 1, format, args);
+     }
+     buf->length += (size_t)length;
+     va_end(args);
+ }
+
+ /**
+  * Take the text out of the builder
+  */
+ char* strbuf_detach(StrBuf* buf) {
+     strbuf_reserve(buf, 0);
+     char* text = buf->data;
+     strbuf_init(buf);
+     return text;
+ }
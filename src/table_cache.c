@@ -0,0 +1,471 @@
+/**
+ * @file table_cache.c
+ * @brief Binary cache of the parsing tables built from a grammar file
+ * @members: Group
+ *
+ * The file is assembled in memory and written at once. Loading checks
+ * the header, then one pass over the payload computes the checksum and
+ * a second one checks the ranges of the action, goto and production
+ * entries, so a bad file is rejected instead of steering the parse loop
+ * out of its tables. Nothing is copied: the tables point into the
+ * mapping until free_parsing_tables unmaps it.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #ifndef _WIN32
+ #include <unistd.h>
+ #endif
+ #include "../include/table_cache.h"
+ #include "../include/automaton.h"
+ #include "../include/utils.h"
+
+ // First bytes of every cache file
+ #define TABLE_CACHE_MAGIC "P3TABLE"
+
+ // Written as is, reads back differently on a host of the other byte order
+ #define TABLE_CACHE_BYTE_ORDER 0x01020304u
+
+ // String offset of a NULL string
+ #define TABLE_CACHE_NO_STRING UINT32_MAX
+
+ // Alignment of every section
+ #define TABLE_CACHE_ALIGN 8
+
+ // FNV-1a parameters
+ #define FNV_OFFSET_BASIS 14695981039346656037ull
+ #define FNV_PRIME 1099511628211ull
+
+ /**
+  * File header, every offset is from the start of the file
+  */
+ typedef struct {
+     char magic[8];            // TABLE_CACHE_MAGIC
+     uint32_t version;         // TABLE_CACHE_VERSION
+     uint32_t byte_order;      // TABLE_CACHE_BYTE_ORDER
+     uint64_t source_hash;     // Hash of the grammar source
+     uint64_t checksum;        // table_cache_hash of the bytes after the header
+     uint64_t file_size;       // Bytes in the file, header included
+     int32_t num_states;
+     int32_t num_terminals;
+     int32_t num_non_terminals;
+     int32_t num_productions;
+     int32_t shift_reduce;     // Conflicts of the build (LalrReport)
+     int32_t reduce_reduce;
+     uint32_t has_names;       // The tables have non-terminal names
+     uint32_t rhs_count;       // Symbols in the rhs section
+     uint64_t action_offset;
+     uint64_t goto_offset;
+     uint64_t expected_offset;
+     uint64_t production_offset;
+     uint64_t rhs_offset;
+     uint64_t name_offset;     // Only with has_names
+     uint64_t message_offset;
+     uint64_t string_offset;
+     uint64_t string_size;
+ } TableCacheHeader;
+
+ /**
+  * Production as stored in the file
+  */
+ typedef struct {
+     int32_t lhs;
+     int32_t rhs_length;
+     uint32_t rhs_start;   // First symbol in the rhs section
+     uint32_t rule;        // String offset of the rule text, or TABLE_CACHE_NO_STRING
+ } CachedProduction;
+
+ // Forward declarations
+ static uint64_t append_section(StrBuf* file, const void* data, size_t size);
+ static uint32_t append_string(StrBuf* strings, const char* text);
+ static bool write_file(const char* path, const StrBuf* file);
+ static TableCacheStatus check_header(const TableCacheHeader* header, size_t size, uint64_t source_hash);
+ static bool section_fits(const TableCacheHeader* header, uint64_t offset, uint64_t count, size_t element);
+ static bool check_tables(const TableCacheHeader* header, const char* data);
+ static ParsingTables* map_tables(const TableCacheHeader* header, const char* data, size_t size);
+
+ /**
+  * 64-bit FNV-1a hash
+  */
+ uint64_t table_cache_hash(const void* data, size_t size) {
+     const unsigned char* bytes = (const unsigned char*)data;
+     uint64_t hash = FNV_OFFSET_BASIS;
+     for (size_t i = 0; i < size; i++) {
+         hash = (hash ^ bytes[i]) * FNV_PRIME;
+     }
+     return hash;
+ }
+
+ /**
+  * Write tables to a cache file
+  */
+ bool table_cache_save(const ParsingTables* tables, const char* path, uint64_t source_hash,
+                       const LalrReport* report) {
+     TableCacheHeader header;
+     memset(&header, 0, sizeof(header));
+     memcpy(header.magic, TABLE_CACHE_MAGIC, sizeof(TABLE_CACHE_MAGIC));
+     header.version = TABLE_CACHE_VERSION;
+     header.byte_order = TABLE_CACHE_BYTE_ORDER;
+     header.source_hash = source_hash;
+     header.num_states = tables->num_states;
+     header.num_terminals = tables->num_terminals;
+     header.num_non_terminals = tables->num_non_terminals;
+     header.num_productions = tables->num_productions;
+     header.shift_reduce = report ? report->shift_reduce : 0;
+     header.reduce_reduce = report ? report->reduce_reduce : 0;
+     header.has_names = tables->non_terminal_names != NULL;
+
+     int num_states = tables->num_states;
+     int num_productions = tables->num_productions;
+     StrBuf strings;
+     strbuf_init(&strings);
+
+     // Productions and their right-hand sides, the strings are gathered on the way
+     CachedProduction* productions = (CachedProduction*)safe_malloc(sizeof(CachedProduction) * (num_productions + 1));
+     int rhs_count = 0;
+     for (int p = 0; p <= num_productions; p++) {
+         rhs_count += tables->productions[p].rhs_length;
+     }
+     int32_t* rhs = (int32_t*)safe_malloc(sizeof(int32_t) * (rhs_count > 0 ? rhs_count : 1));
+     rhs_count = 0;
+     for (int p = 0; p <= num_productions; p++) {
+         const Production* production = &tables->productions[p];
+         productions[p].lhs = production->lhs;
+         productions[p].rhs_length = production->rhs_length;
+         productions[p].rhs_start = (uint32_t)rhs_count;
+         productions[p].rule = append_string(&strings, production->rule_string);
+         for (int i = 0; i < production->rhs_length; i++) {
+             rhs[rhs_count++] = production->rhs[i];
+         }
+     }
+     header.rhs_count = (uint32_t)rhs_count;
+
+     uint32_t* names = (uint32_t*)safe_malloc(sizeof(uint32_t) * (tables->num_non_terminals + 1));
+     for (int nt = 0; header.has_names && nt < tables->num_non_terminals; nt++) {
+         names[nt] = append_string(&strings, tables->non_terminal_names[nt]);
+     }
+     uint32_t* messages = (uint32_t*)safe_malloc(sizeof(uint32_t) * num_states);
+     for (int state = 0; state < num_states; state++) {
+         messages[state] = append_string(&strings, tables_expected_message(tables, state));
+     }
+
+     // Header first, filled in once the offsets and the checksum are known
+     StrBuf file;
+     strbuf_init(&file);
+     append_section(&file, &header, sizeof(header));
+     header.action_offset = append_section(&file, tables->action_table,
+                                           sizeof(uint16_t) * num_states * tables->num_terminals);
+     header.goto_offset = append_section(&file, tables->goto_table,
+                                         sizeof(int16_t) * num_states * tables->num_non_terminals);
+     header.expected_offset = append_section(&file, tables->expected, sizeof(uint32_t) * num_states);
+     header.production_offset = append_section(&file, productions,
+                                               sizeof(CachedProduction) * (num_productions + 1));
+     header.rhs_offset = append_section(&file, rhs, sizeof(int32_t) * rhs_count);
+     if (header.has_names) {
+         header.name_offset = append_section(&file, names, sizeof(uint32_t) * tables->num_non_terminals);
+     }
+     header.message_offset = append_section(&file, messages, sizeof(uint32_t) * num_states);
+     header.string_offset = append_section(&file, strings.data, strings.length);
+     header.string_size = strings.length;
+     header.file_size = file.length;
+     header.checksum = table_cache_hash(file.data + sizeof(header), file.length - sizeof(header));
+     memcpy(file.data, &header, sizeof(header));
+
+     bool ok = write_file(path, &file);
+
+     strbuf_free(&file);
+     strbuf_free(&strings);
+     free(productions);
+     free(rhs);
+     free(names);
+     free(messages);
+     return ok;
+ }
+
+ /**
+  * Map tables from a cache file
+  */
+ ParsingTables* table_cache_load(const char* path, uint64_t source_hash, LalrReport* report,
+                                 TableCacheStatus* status) {
+     TableCacheStatus found = TABLE_CACHE_MISSING;
+     const char* data = NULL;
+     size_t size = 0;
+     ParsingTables* tables = NULL;
+
+     if (token_map_file(path, &data, &size)) {
+         // Mappings are page aligned, which every section relies on
+         const TableCacheHeader* header = (const TableCacheHeader*)data;
+         found = check_header(header, size, source_hash);
+         if (found == TABLE_CACHE_LOADED && !check_tables(header, data)) {
+             found = TABLE_CACHE_INVALID;
+         }
+         if (found == TABLE_CACHE_LOADED) {
+             tables = map_tables(header, data, size);
+             if (report) {
+                 report->num_states = header->num_states;
+                 report->shift_reduce = header->shift_reduce;
+                 report->reduce_reduce = header->reduce_reduce;
+             }
+         } else {
+             token_unmap_file(data, size);
+         }
+     }
+
+     if (status) {
+         *status = found;
+     }
+     return tables;
+ }
+
+ /**
+  * Tables of a grammar file, from the cache when it is up to date
+  */
+ ParsingTables* table_cache_build(const char* grammar_file, const char* cache_file,
+                                  LalrReport* report, TableCacheStatus* status) {
+     const char* source = NULL;
+     size_t source_size = 0;
+     if (!token_map_file(grammar_file, &source, &source_size)) {
+         log_error("Failed to open grammar file: %s", grammar_file);
+         return NULL;
+     }
+     uint64_t source_hash = table_cache_hash(source, source_size);
+     token_unmap_file(source, source_size);
+
+     ParsingTables* tables = table_cache_load(cache_file, source_hash, report, status);
+     if (tables) {
+         return tables;
+     }
+
+     LalrReport built;
+     tables = lalr_build_from_file(grammar_file, &built);
+     if (!tables) {
+         return NULL;
+     }
+     if (!table_cache_save(tables, cache_file, source_hash, &built)) {
+         log_error("Failed to write table cache: %s", cache_file);
+     }
+     if (report) {
+         *report = built;
+     }
+     return tables;
+ }
+
+ /* Internal function implementations */
+
+ /**
+  * Append a section at the next aligned offset, returns that offset
+  */
+ static uint64_t append_section(StrBuf* file, const void* data, size_t size) {
+     static const char padding[TABLE_CACHE_ALIGN] = { 0 };
+     size_t misaligned = file->length % TABLE_CACHE_ALIGN;
+     if (misaligned) {
+         strbuf_append(file, padding, TABLE_CACHE_ALIGN - misaligned);
+     }
+     uint64_t offset = file->length;
+     if (size > 0) {
+         strbuf_append(file, (const char*)data, size);
+     }
+     return offset;
+ }
+
+ /**
+  * Append a string with its terminator, returns its offset
+  */
+ static uint32_t append_string(StrBuf* strings, const char* text) {
+     if (!text) {
+         return TABLE_CACHE_NO_STRING;
+     }
+     uint32_t offset = (uint32_t)strings->length;
+     strbuf_append(strings, text, strlen(text) + 1);
+     return offset;
+ }
+
+ /**
+  * Write the file under a temporary name and rename it into place
+  */
+ static bool write_file(const char* path, const StrBuf* file) {
+ #ifdef _WIN32
+     char* temporary = string_format("%s.tmp", path);
+ #else
+     char* temporary = string_format("%s.tmp%ld", path, (long)getpid());
+ #endif
+     FILE* out = fopen(temporary, "wb");
+     bool ok = out != NULL;
+     if (out) {
+         ok = fwrite(file->data, 1, file->length, out) == file->length;
+         ok = fclose(out) == 0 && ok;
+     }
+ #ifdef _WIN32
+     // rename does not replace an existing file there
+     remove(path);
+ #endif
+     if (ok) {
+         ok = rename(temporary, path) == 0;
+     }
+     if (!ok) {
+         remove(temporary);
+     }
+     free(temporary);
+     return ok;
+ }
+
+ /**
+  * Check the header against the file and the expected source
+  */
+ static TableCacheStatus check_header(const TableCacheHeader* header, size_t size, uint64_t source_hash) {
+     if (size < sizeof(TableCacheHeader) ||
+         memcmp(header->magic, TABLE_CACHE_MAGIC, sizeof(TABLE_CACHE_MAGIC)) != 0 ||
+         header->byte_order != TABLE_CACHE_BYTE_ORDER) {
+         return TABLE_CACHE_INVALID;
+     }
+     if (header->version != TABLE_CACHE_VERSION || header->source_hash != source_hash) {
+         return TABLE_CACHE_STALE;
+     }
+     if (header->file_size != size ||
+         header->checksum != table_cache_hash((const char*)header + sizeof(TableCacheHeader),
+                                              size - sizeof(TableCacheHeader))) {
+         return TABLE_CACHE_INVALID;
+     }
+
+     // The parse loop indexes the action table by any TokenType
+     if (header->num_states <= 0 || header->num_terminals != TOKEN_NON_TERMINAL + 1 ||
+         header->num_non_terminals <= 0 || header->num_productions < 0) {
+         return TABLE_CACHE_INVALID;
+     }
+     uint64_t states = (uint64_t)header->num_states;
+     bool fits = section_fits(header, header->action_offset, states * (uint64_t)header->num_terminals, sizeof(uint16_t)) &&
+                 section_fits(header, header->goto_offset, states * (uint64_t)header->num_non_terminals, sizeof(int16_t)) &&
+                 section_fits(header, header->expected_offset, states, sizeof(uint32_t)) &&
+                 section_fits(header, header->production_offset, (uint64_t)header->num_productions + 1, sizeof(CachedProduction)) &&
+                 section_fits(header, header->rhs_offset, header->rhs_count, sizeof(int32_t)) &&
+                 (!header->has_names ||
+                  section_fits(header, header->name_offset, (uint64_t)header->num_non_terminals, sizeof(uint32_t))) &&
+                 section_fits(header, header->message_offset, states, sizeof(uint32_t)) &&
+                 section_fits(header, header->string_offset, header->string_size, 1);
+     return fits ? TABLE_CACHE_LOADED : TABLE_CACHE_INVALID;
+ }
+
+ /**
+  * Whether count elements at offset lie inside the file and are aligned
+  */
+ static bool section_fits(const TableCacheHeader* header, uint64_t offset, uint64_t count, size_t element) {
+     return offset >= sizeof(TableCacheHeader) && offset % TABLE_CACHE_ALIGN == 0 &&
+            offset <= header->file_size && count <= (header->file_size - offset) / element;
+ }
+
+ /**
+  * Check every state, production and string reference of the tables
+  */
+ static bool check_tables(const TableCacheHeader* header, const char* data) {
+     int num_states = header->num_states;
+     int num_productions = header->num_productions;
+
+     // Each string ends inside the string section
+     const char* strings = data + header->string_offset;
+     uint64_t string_size = header->string_size;
+     if (string_size > 0 && strings[string_size - 1] != '\0') {
+         return false;
+     }
+
+     const uint16_t* actions = (const uint16_t*)(data + header->action_offset);
+     for (int i = 0; i < num_states * header->num_terminals; i++) {
+         int value = action_value_of(actions[i]);
+         switch (action_type_of(actions[i])) {
+             case ACTION_SHIFT:
+                 if (value >= num_states) {
+                     return false;
+                 }
+                 break;
+             case ACTION_REDUCE:
+                 if (value < 1 || value > num_productions) {
+                     return false;
+                 }
+                 break;
+             default:
+                 break;
+         }
+     }
+
+     const int16_t* gotos = (const int16_t*)(data + header->goto_offset);
+     for (int i = 0; i < num_states * header->num_non_terminals; i++) {
+         if (gotos[i] < -1 || gotos[i] >= num_states) {
+             return false;
+         }
+     }
+
+     const CachedProduction* productions = (const CachedProduction*)(data + header->production_offset);
+     for (int p = 0; p <= num_productions; p++) {
+         const CachedProduction* production = &productions[p];
+         if (production->lhs < 0 || production->lhs >= header->num_non_terminals ||
+             production->rhs_length < 0 || production->rhs_start > header->rhs_count ||
+             (uint32_t)production->rhs_length > header->rhs_count - production->rhs_start ||
+             (production->rule != TABLE_CACHE_NO_STRING && production->rule >= string_size)) {
+             return false;
+         }
+     }
+
+     const uint32_t* names = (const uint32_t*)(data + header->name_offset);
+     for (int nt = 0; header->has_names && nt < header->num_non_terminals; nt++) {
+         if (names[nt] >= string_size) {
+             return false;
+         }
+     }
+     const uint32_t* messages = (const uint32_t*)(data + header->message_offset);
+     for (int state = 0; state < num_states; state++) {
+         if (messages[state] >= string_size) {
+             return false;
+         }
+     }
+     return true;
+ }
+
+ /**
+  * Tables pointing into a checked mapping
+  */
+ static ParsingTables* map_tables(const TableCacheHeader* header, const char* data, size_t size) {
+     int num_states = header->num_states;
+     int num_productions = header->num_productions;
+     const char* strings = data + header->string_offset;
+
+     const CachedProduction* cached = (const CachedProduction*)(data + header->production_offset);
+     const int32_t* rhs = (const int32_t*)(data + header->rhs_offset);
+     Production* productions = (Production*)safe_malloc(sizeof(Production) * (num_productions + 1));
+     for (int p = 0; p <= num_productions; p++) {
+         productions[p].lhs = cached[p].lhs;
+         productions[p].rhs = cached[p].rhs_length > 0 ? rhs + cached[p].rhs_start : NULL;
+         productions[p].rhs_length = cached[p].rhs_length;
+         productions[p].rule_string = cached[p].rule == TABLE_CACHE_NO_STRING ? NULL : strings + cached[p].rule;
+     }
+
+     const char** names = NULL;
+     if (header->has_names) {
+         const uint32_t* offsets = (const uint32_t*)(data + header->name_offset);
+         names = (const char**)safe_malloc(sizeof(char*) * header->num_non_terminals);
+         for (int nt = 0; nt < header->num_non_terminals; nt++) {
+             names[nt] = strings + offsets[nt];
+         }
+     }
+
+     const uint32_t* offsets = (const uint32_t*)(data + header->message_offset);
+     const char** messages = (const char**)safe_malloc(sizeof(char*) * num_states);
+     for (int state = 0; state < num_states; state++) {
+         messages[state] = strings + offsets[state];
+     }
+
+     ParsingTables* tables = (ParsingTables*)safe_malloc(sizeof(ParsingTables));
+     tables->action_table = (const uint16_t*)(data + header->action_offset);
+     tables->goto_table = (const int16_t*)(data + header->goto_offset);
+     tables->num_states = num_states;
+     tables->num_terminals = header->num_terminals;
+     tables->num_non_terminals = header->num_non_terminals;
+     tables->non_terminal_names = names;
+     tables->expected = (const uint32_t*)(data + header->expected_offset);
+     tables->expected_messages = messages;
+     tables->productions = productions;
+     tables->num_productions = num_productions;
+     tables->is_static = false;
+     tables->cache_map = data;
+     tables->cache_size = size;
+     return tables;
+ }
@@ -7,16 +7,63 @@
  #include <stdio.h>
  #include <stdlib.h>
  #include <string.h>
- #include <ctype.h>
+ #ifndef _WIN32
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #endif
  #include "../include/token.h"
+ #include "../include/async_io.h"
+ #include "../include/scan_simd.h"
  #include "../include/utils.h"
  
+ /**
+  * Components of one <lexeme, CATEGORY> token text
+  */
+ typedef struct {
+     const char* lexeme;   // Start of the lexeme
+     int lexeme_length;    // Length of the lexeme
+     const char* category; // Start of the category name
+     int category_length;  // Length of the category name
+     TokenType type;       // Token type for the category
+     int length;           // Length of the whole token text including '<' and '>'
+ } TokenText;
+ 
+ /**
+  * Recyclable token used in streaming mode
+  */
+ typedef struct TokenSlot {
+     Token token;                  // Must stay first, tokens are cast back to slots
+     struct TokenSlot* next_free;  // Free list link
+     struct TokenSlot* next_slot;  // Link in the list of all slots
+     char text[TOKEN_INLINE_LEXEME]; // Storage for short copied lexemes
+ } TokenSlot;
+ 
+ // Scanner progress, logged at LOG_LEVEL_DEBUG for streams opened with TOKEN_STREAM_VERBOSE
+ #define SCAN_LOG(stream, ...) do { \
+         if ((stream)->flags & TOKEN_STREAM_VERBOSE) { \
+             LOG_DEBUG(__VA_ARGS__); \
+         } \
+     } while (0)
+ 
  /**
   * Internal function declarations
   */
  static bool has_next_token(TokenStream* stream);
  static Token* peek_next_token(TokenStream* stream);
  static Token* scan_token(TokenStream* stream);
+ static char* read_line(TokenStream* stream, char* buffer, int size);
+ static bool refill_buffer(TokenStream* stream);
+ static Token* scan_token_mapped(TokenStream* stream);
+ static Token* scan_next(TokenStream* stream);
+ static bool scan_token_text(const char* start, const char* end, TokenText* text);
+ static bool map_input_file(TokenStream* stream, const char* filename);
+ static void unmap_input_file(TokenStream* stream);
+ static void start_stream(TokenStream* stream, unsigned flags, int line, int position);
+ static void rewind_stream(TokenStream* stream, int line, int position);
+ static void free_slot_lexemes(TokenStream* stream);
+ static void advance_position(TokenStream* stream, const char* from, const char* to, const ScanLines* lines);
  
  /**
   * Token type name mapping
@@ -56,12 +103,42 @@
   * Convert token type string to enum
   */
  TokenType token_type_from_string(const char* type_str) {
-     for (int i = 0; i <= TOKEN_NON_TERMINAL; i++) {
-         if (strcmp(type_str, TOKEN_TYPE_NAMES[i]) == 0) {
-             return (TokenType)i;
-         }
+     return token_type_from_text(type_str, (int)strlen(type_str));
+ }
+ 
+ /**
+  * Convert token type name of known length to enum
+  */
+ TokenType token_type_from_text(const char* text, int length) {
+     // Every name is unique by (length, first character), so at most
+     // one candidate has to be compared
+     TokenType candidate = TOKEN_INVALID;
+     
+     if (length <= 0) {
+         return TOKEN_INVALID;
+     }
+     
+     switch (length) {
+         case 3:
+             candidate = text[0] == 'N' ? TOKEN_NUM : TOKEN_EOF;
+             break;
+         case 4:
+             candidate = text[0] == 'P' ? TOKEN_PLUS : TOKEN_STAR;
+             break;
+         case 6:
+             candidate = text[0] == 'L' ? TOKEN_LPAREN : TOKEN_RPAREN;
+             break;
+         case 12:
+             candidate = TOKEN_NON_TERMINAL;
+             break;
+         default:
+             return TOKEN_INVALID;
+     }
+     
+     if (memcmp(text, TOKEN_TYPE_NAMES[candidate], length) != 0) {
+         return TOKEN_INVALID;
      }
-     return TOKEN_INVALID;
+     return candidate;
  }
  
  /**
@@ -71,18 +148,103 @@
      Token* token = (Token*)safe_malloc(sizeof(Token));
      token->type = type;
      token->lexeme = safe_strdup(lexeme);
+     token->length = (int)strlen(lexeme);
+     token->owns_lexeme = true;
+     token->line_number = line;
+     token->position = position;
+     token->next = NULL;
+     return token;
+ }
+ 
+ /**
+  * Create a token that references its lexeme in place
+  */
+ Token* token_create_view(TokenType type, const char* text, int length, int line, int position) {
+     Token* token = (Token*)safe_malloc(sizeof(Token));
+     token->type = type;
+     token->lexeme = text;
+     token->length = length;
+     token->owns_lexeme = false;
      token->line_number = line;
      token->position = position;
      token->next = NULL;
      return token;
  }
  
+ /**
+  * Create a token in the stream's arena
+  */
+ Token* token_stream_new_token(TokenStream* stream, TokenType type, const char* text, int length,
+                               int line, int position, bool copy) {
+     Token* token;
+     
+     if (stream->flags & TOKEN_STREAM_STREAMING) {
+         // Reuse a released slot, the pool only grows to the peak number of live tokens
+         TokenSlot* slot = stream->free_slots;
+         if (slot) {
+             stream->free_slots = slot->next_free;
+         } else {
+             slot = (TokenSlot*)arena_alloc(stream->arena, sizeof(TokenSlot));
+             slot->next_slot = stream->all_slots;
+             stream->all_slots = slot;
+         }
+         slot->next_free = NULL;
+         token = &slot->token;
+         token->owns_lexeme = false;
+         
+         if (!copy) {
+             token->lexeme = text;
+         } else if (length < TOKEN_INLINE_LEXEME) {
+             memcpy(slot->text, text, (size_t)length);
+             slot->text[length] = '\0';
+             token->lexeme = slot->text;
+         } else {
+             char* lexeme = (char*)safe_malloc((size_t)length + 1);
+             memcpy(lexeme, text, (size_t)length);
+             lexeme[length] = '\0';
+             token->lexeme = lexeme;
+             token->owns_lexeme = true;
+         }
+     } else {
+         token = (Token*)arena_alloc(stream->arena, sizeof(Token));
+         token->lexeme = copy ? arena_strndup(stream->arena, text, (size_t)length) : text;
+         token->owns_lexeme = false; // Released with the arena
+     }
+     
+     token->type = type;
+     token->length = length;
+     token->line_number = line;
+     token->position = position;
+     token->next = NULL;
+     return token;
+ }
+ 
+ /**
+  * Return a token to the stream's slot pool
+  */
+ void token_stream_release(TokenStream* stream, Token* token) {
+     if (!stream || !token || !(stream->flags & TOKEN_STREAM_STREAMING)) {
+         return;
+     }
+     
+     TokenSlot* slot = (TokenSlot*)token;
+     if (token->owns_lexeme) {
+         free((char*)token->lexeme);
+         token->owns_lexeme = false;
+     }
+     token->next = NULL;
+     slot->next_free = stream->free_slots;
+     stream->free_slots = slot;
+ }
+ 
  /**
   * Free token memory
   */
  void token_free(Token* token) {
      if (token) {
-         free(token->lexeme);
+         if (token->owns_lexeme) {
+             free((char*)token->lexeme);
+         }
          free(token);
      }
  }
@@ -101,48 +263,168 @@
   * Convert token to string representation
   */
  char* token_to_string(Token* token) {
+     StrBuf out;
+     strbuf_init(&out);
+     token_append_string(&out, token);
+     return strbuf_detach(&out);
+ }
+ 
+ /**
+  * Append the string representation of a token, <TYPE, "lexeme", line, position>
+  */
+ void token_append_string(StrBuf* out, const Token* token) {
      if (!token) {
-         return safe_strdup("NULL");
+         strbuf_append(out, "NULL", 4);
+         return;
      }
      
-     return string_format("<%s, \"%s\", %d, %d>", 
-                          token_type_to_string(token->type),
-                          token->lexeme,
-                          token->line_number,
-                          token->position);
+     strbuf_append_char(out, '<');
+     strbuf_append_str(out, token_type_to_string(token->type));
+     strbuf_append(out, ", \"", 3);
+     strbuf_append(out, token->lexeme, (size_t)token->length);
+     strbuf_append(out, "\", ", 3);
+     strbuf_append_int(out, token->line_number);
+     strbuf_append(out, ", ", 2);
+     strbuf_append_int(out, token->position);
+     strbuf_append_char(out, '>');
+ }
+ 
+ /**
+  * Append the current token and the next ones already read
+  */
+ void token_stream_append_position(StrBuf* out, TokenStream* stream, int max_tokens) {
+     if (!stream || !stream->current) {
+         strbuf_append_str(out, "End of Input");
+         return;
+     }
+     
+     Token* current = stream->current;
+     for (int count = 0; current && count < max_tokens; count++) {
+         if (count > 0) {
+             strbuf_append_char(out, ' ');
+         }
+         token_append_string(out, current);
+         current = current->next;
+     }
  }
  
  /**
   * Create a token stream from a file
   */
  TokenStream* token_stream_create(const char* filename) {
-     FILE* file = fopen(filename, "r");
-     if (!file) {
-         log_error("Failed to open file: %s", filename);
-         return NULL;
+     return token_stream_open(filename, TOKEN_STREAM_VERBOSE);
+ }
+ 
+ /**
+  * Create a token stream from a file with explicit mode flags
+  */
+ TokenStream* token_stream_open(const char* filename, unsigned flags) {
+     TokenStream* stream = (TokenStream*)safe_malloc(sizeof(TokenStream));
+     stream->input_file = NULL;
+     stream->prefetch = NULL;
+     stream->map_data = NULL;
+     stream->map_size = 0;
+     stream->map_pos = NULL;
+     stream->owns_map = false;
+     
+     if (flags & TOKEN_STREAM_MMAP) {
+         if (!map_input_file(stream, filename)) {
+             log_error("Failed to map file: %s", filename);
+             free(stream);
+             return NULL;
+         }
+     } else {
+         stream->input_file = fopen(filename, "r");
+         if (!stream->input_file) {
+             log_error("Failed to open file: %s", filename);
+             free(stream);
+             return NULL;
+         }
+         // Without a thread the file is simply read in place
+         if (flags & TOKEN_STREAM_PREFETCH) {
+             stream->prefetch = async_reader_open(stream->input_file);
+         }
      }
      
+     start_stream(stream, flags, 1, 0);
+     return stream;
+ }
+ 
+ /**
+  * Create a token stream over tokens already in memory
+  */
+ TokenStream* token_stream_open_buffer(const char* data, size_t size, int line, int position,
+                                       unsigned flags) {
      TokenStream* stream = (TokenStream*)safe_malloc(sizeof(TokenStream));
-     stream->input_file = file;
+     stream->input_file = NULL;
+     stream->prefetch = NULL;
+     stream->map_data = data;
+     stream->map_size = size;
+     stream->map_pos = data;
+     stream->owns_map = false;
+     
+     // Scanned in place like a mapped file
+     start_stream(stream, (flags & ~TOKEN_STREAM_PREFETCH) | TOKEN_STREAM_MMAP, line, position);
+     return stream;
+ }
+ 
+ /**
+  * Point a buffer stream at other tokens, keeping its memory
+  */
+ void token_stream_reset_buffer(TokenStream* stream, const char* data, size_t size, int line,
+                                int position) {
+     // Every token of the old buffer goes, the arena keeps its blocks
+     free_slot_lexemes(stream);
+     arena_reset(stream->arena);
+     
+     stream->map_data = data;
+     stream->map_size = size;
+     stream->map_pos = data;
+     rewind_stream(stream, line, position);
+ }
+ 
+ /**
+  * Initialize the scanner state of an opened stream and read its first token
+  */
+ static void start_stream(TokenStream* stream, unsigned flags, int line, int position) {
+     stream->flags = flags;
+     stream->arena = arena_create(0);
+     stream->buffer_size = stream->input_file ? TOKEN_LINE_BUFFER_SIZE : 0;
+     stream->buffer = stream->input_file ? (char*)safe_malloc(stream->buffer_size) : NULL;
+     rewind_stream(stream, line, position);
+ }
+ 
+ /**
+  * Clear the scanner state and read the first token, the arena is empty
+  */
+ static void rewind_stream(TokenStream* stream, int line, int position) {
      stream->head = NULL;
      stream->current = NULL;
      stream->token_count = 0;
+     stream->bytes_read = 0;
+     stream->read_failed = false;
+     stream->free_slots = NULL;
+     stream->all_slots = NULL;
+     if (stream->buffer) {
+         stream->buffer[0] = '\0';
+     }
+     stream->current_pos = NULL;
+     stream->line_end = NULL;
+     stream->line = line;
+     stream->position = position;
      stream->has_next = has_next_token;
      stream->peek_next = peek_next_token;
      
      // Read the first token
-     stream->current = scan_token(stream);
+     stream->current = scan_next(stream);
      if (stream->current) {
-         printf("First token: %s, type: %s\n", 
-                stream->current->lexeme, 
-                token_type_to_string(stream->current->type));
+         SCAN_LOG(stream, "First token: %.*s, type: %s", stream->current->length,
+                  stream->current->lexeme, token_type_to_string(stream->current->type));
      } else {
-         printf("No tokens read from file\n");
+         SCAN_LOG(stream, "No tokens read from file");
      }
      
      stream->head = stream->current;
-     
-     return stream;
  }
  
  /**
@@ -153,22 +435,33 @@
          return;
      }
      
-     // Free all tokens
-     Token* current = stream->head;
-     while (current) {
-         Token* next = current->next;
-         token_free(current);
-         current = next;
-     }
+     free_slot_lexemes(stream);
      
-     // Close file
+     // Free all tokens at once
+     arena_free(stream->arena);
+     
+     // Close file, the reader thread first
+     async_reader_close(stream->prefetch);
      if (stream->input_file) {
          fclose(stream->input_file);
      }
+     unmap_input_file(stream);
      
+     free(stream->buffer);
      free(stream);
  }
  
+ /**
+  * Free the long lexemes of recycled tokens, the only per-token heap memory
+  */
+ static void free_slot_lexemes(TokenStream* stream) {
+     for (TokenSlot* slot = stream->all_slots; slot; slot = slot->next_slot) {
+         if (slot->token.owns_lexeme) {
+             free((char*)slot->token.lexeme);
+         }
+     }
+ }
+ 
  /**
   * Get the next token from the stream
   */
@@ -185,16 +478,21 @@
              stream->current = stream->current->next;
          } else {
              // Read next token from file
-             Token* next_token = scan_token(stream);
+             Token* next_token = scan_next(stream);
              stream->current->next = next_token;
              stream->current = next_token;
              
              if (next_token) {
-                 printf("Next token: %s, type: %s\n", 
-                        next_token->lexeme, 
-                        token_type_to_string(next_token->type));
+                 SCAN_LOG(stream, "Next token: %.*s, type: %s", next_token->length,
+                          next_token->lexeme, token_type_to_string(next_token->type));
              }
          }
+         
+         // Streaming: the consumed token now belongs to the caller
+         if (stream->flags & TOKEN_STREAM_STREAMING) {
+             token->next = NULL;
+             stream->head = stream->current;
+         }
      }
      
      return token;
@@ -235,129 +533,326 @@
      return stream->current;
  }
  
+ /**
+  * Scan the next token with the scanner of the stream's mode and count it
+  */
+ static Token* scan_next(TokenStream* stream) {
+     Token* token;
+     if (stream->flags & TOKEN_STREAM_MMAP) {
+         token = scan_token_mapped(stream);
+         stream->bytes_read = (size_t)(stream->map_pos - stream->map_data);
+     } else {
+         token = scan_token(stream);
+     }
+     if (token) {
+         stream->token_count++;
+     }
+     return token;
+ }
+ 
+ /**
+  * Read up to a newline or size - 1 bytes into buffer, from the prefetch ring if there is one;
+  * NULL at the end of the input, which sets read_failed when a read error ended it
+  */
+ static char* read_line(TokenStream* stream, char* buffer, int size) {
+     char* line = stream->prefetch ? async_reader_gets(stream->prefetch, buffer, size)
+                                   : fgets(buffer, size, stream->input_file);
+     if (!line && !stream->read_failed) {
+         stream->read_failed = stream->prefetch ? async_reader_failed(stream->prefetch)
+                                                : ferror(stream->input_file) != 0;
+         if (stream->read_failed) {
+             log_error("Read error at line %d, the rest of the input is lost", stream->line);
+         }
+     }
+     return line;
+ }
+ 
+ /**
+  * Move the unscanned rest of the buffer to its start and read more input
+  * after it, false at the end of the input
+  */
+ static bool refill_buffer(TokenStream* stream) {
+     char* buffer = stream->buffer;
+     size_t kept = stream->current_pos ? (size_t)(stream->line_end - stream->current_pos) : 0;
+     if (kept > 0 && stream->current_pos != buffer) {
+         memmove(buffer, stream->current_pos, kept);
+     }
+     
+     // Only an unfinished token is kept, so a full buffer grows for the rest of it
+     if (kept + 1 >= stream->buffer_size) {
+         stream->buffer_size *= 2;
+         buffer = (char*)safe_realloc(buffer, stream->buffer_size);
+         stream->buffer = buffer;
+     }
+     stream->current_pos = buffer;
+     stream->line_end = buffer + kept;
+     *stream->line_end = '\0';
+     
+     if (read_line(stream, buffer + kept, (int)(stream->buffer_size - kept)) == NULL) {
+         return false;
+     }
+     size_t added = strlen(buffer + kept);
+     stream->line_end += added;
+     stream->bytes_read += added;
+     
+     SCAN_LOG(stream, "Read line: '%.*s'", (int)(stream->line_end - buffer), buffer);
+     return true;
+ }
+ 
  /**
   * Parse tokens from file
-  * Handles multiple tokens per line and properly formats them
+  * Handles multiple tokens per line and properly formats them. The buffer
+  * holds one line, or a part of a longer one; a token cut off by its end
+  * is completed by reading on before it is scanned.
   */
  static Token* scan_token(TokenStream* stream) {
      if (!stream || !stream->input_file) {
          return NULL;
      }
      
-     static int line = 1;
-     static int position = 0;
-     static char buffer[1024] = "";
-     static char* current_pos = NULL;
-     
-     // Initialize or read a new line if needed
-     if (buffer[0] == '\0' || current_pos == NULL || *current_pos == '\0') {
-         if (fgets(buffer, sizeof(buffer), stream->input_file) == NULL) {
-             printf("End of file reached\n");
-             return token_create(TOKEN_EOF, "EOF", line, position);
+     for (;;) {
+         // Read a new line when this one is used up
+         if (stream->current_pos == stream->line_end) {
+             if (!refill_buffer(stream)) {
+                 break;
+             }
+             continue;
          }
          
-         printf("Read line: '%s'\n", buffer);
-         current_pos = buffer;
-         position = 0;
-     }
-     
-     // Skip whitespace
-     while (*current_pos && isspace((unsigned char)*current_pos)) {
-         if (*current_pos == '\n') {
-             line++;
-             position = 0;
-         } else {
-             position++;
+         // Skip whitespace, newlines included
+         ScanLines lines;
+         char* pos = (char*)scan_skip_space(stream->current_pos, stream->line_end, &lines);
+         advance_position(stream, stream->current_pos, pos, &lines);
+         stream->current_pos = pos;
+         if (pos == stream->line_end) {
+             continue;
          }
-         current_pos++;
-     }
-     
-     // If end of line, reset for next line read
-     if (*current_pos == '\0') {
-         buffer[0] = '\0';
-         return scan_token(stream);
-     }
-     
-     // Check if token starts with '<'
-     if (*current_pos == '<') {
-         char* token_start = current_pos;
-         char* token_end = strchr(current_pos, '>');
          
-         if (token_end) {
-             // Extract token text
-             int token_len = token_end - token_start + 1;
-             char* token_text = (char*)safe_malloc(token_len + 1);
-             strncpy(token_text, token_start, token_len);
-             token_text[token_len] = '\0';
-             
-             printf("Processing token: '%s'\n", token_text);
+         // Check if token starts with '<'
+         if (*pos == '<') {
+             TokenText text;
              
-             // Parse token components
-             char lexeme[128] = "";
-             char category[128] = "";
-             
-             if (sscanf(token_text, "<%[^,], %[^>]>", lexeme, category) == 2) {
-                 printf("Parsed token: lexeme='%s', category='%s'\n", lexeme, category);
-                 
-                 // Cleanup
-                 free(token_text);
-                 
-                 // Convert category string to token type
-                 TokenType type = token_type_from_string(category);
+             if (scan_token_text(pos, stream->line_end, &text)) {
+                 SCAN_LOG(stream, "Parsed token: '%.*s', lexeme='%.*s', category='%.*s'",
+                          text.length, pos, text.lexeme_length, text.lexeme,
+                          text.category_length, text.category);
                  
                  // Update position for next call
-                 int token_position = position;
-                 position += token_len;
-                 current_pos = token_end + 1;
+                 int token_position = stream->position;
+                 stream->position += text.length;
+                 stream->current_pos += text.length;
                  
-                 // Create token
-                 return token_create(type, lexeme, line, token_position);
+                 // Create token, the line buffer is reused so the lexeme is copied
+                 return token_stream_new_token(stream, text.type, text.lexeme, text.lexeme_length,
+                                               stream->line, token_position, true);
              }
-             else if (sscanf(token_text, "<%[^,],%[^>]>", lexeme, category) == 2) {
-                 // Try alternative format with no space after comma
-                 printf("Parsed token (alt format): lexeme='%s', category='%s'\n", lexeme, category);
-                 
-                 // Cleanup
-                 free(token_text);
-                 
-                 // Convert category string to token type
-                 TokenType type = token_type_from_string(category);
-                 
-                 // Update position for next call
-                 int token_position = position;
-                 position += token_len;
-                 current_pos = token_end + 1;
-                 
-                 // Create token
-                 return token_create(type, lexeme, line, token_position);
+             
+             // Without a '>' before the end of a partial line the token may
+             // go on in the input, read the rest and try again
+             bool partial = stream->line_end[-1] != '\n';
+             if (partial && scan_find2(pos, stream->line_end, '>', '\n') == stream->line_end &&
+                 refill_buffer(stream)) {
+                 continue;
              }
+             pos = stream->current_pos;
+         }
+         
+         // If we get here, we couldn't parse a token at the current position
+         SCAN_LOG(stream, "Invalid token format at line %d, position %d: %.*s...",
+                  stream->line, stream->position, (int)(stream->line_end - pos < 10 ? stream->line_end - pos : 10), pos);
+         
+         // Skip to the next '<' or end of line, always making progress
+         const char* next = scan_find2(pos + 1, stream->line_end, '<', '\n');
+         stream->position += (int)(next - pos);
+         stream->current_pos = (char*)next;
+     }
+     
+     SCAN_LOG(stream, "End of file reached");
+     return token_stream_new_token(stream, TOKEN_EOF, "EOF", 3, stream->line, stream->position, false);
+ }
+ 
+ /**
+  * Scan the next token directly from the mapped file
+  * Lexemes are returned as views into the mapping, nothing is copied
+  */
+ static Token* scan_token_mapped(TokenStream* stream) {
+     const char* pos = stream->map_pos;
+     const char* end = stream->map_data + stream->map_size;
+     while (pos < end) {
+         // Skip whitespace
+         ScanLines lines;
+         const char* skipped = scan_skip_space(pos, end, &lines);
+         advance_position(stream, pos, skipped, &lines);
+         pos = skipped;
+         if (pos == end) {
+             break;
+         }
+         
+         // Token format: <lexeme, CATEGORY> on a single line
+         TokenText text;
+         if (*pos == '<' && scan_token_text(pos, end, &text)) {
+             SCAN_LOG(stream, "Parsed token: '%.*s', lexeme='%.*s', category='%.*s'",
+                      text.length, pos, text.lexeme_length, text.lexeme,
+                      text.category_length, text.category);
              
-             free(token_text);
+             // Update position for next call
+             int token_position = stream->position;
+             stream->position += text.length;
+             stream->map_pos = pos + text.length;
+             
+             return token_stream_new_token(stream, text.type, text.lexeme, text.lexeme_length,
+                                           stream->line, token_position, false);
          }
+         
+         // If we get here, we couldn't parse a token at the current position
+         SCAN_LOG(stream, "Invalid token format at line %d, position %d: %.*s...",
+                  stream->line, stream->position, (int)(end - pos < 10 ? end - pos : 10), pos);
+         
+         // Skip to the next '<' or end of line, always making progress
+         const char* next = scan_find2(pos + 1, end, '<', '\n');
+         stream->position += (int)(next - pos);
+         pos = next;
      }
      
-     // If we get here, we couldn't parse a token at the current position
-     printf("Invalid token format at line %d, position %d: %.10s...\n", 
-            line, position, current_pos);
+     stream->map_pos = pos;
      
-     // Skip to the next '<' or end of line
-     while (*current_pos && *current_pos != '<' && *current_pos != '\n') {
-         current_pos++;
-         position++;
+     SCAN_LOG(stream, "End of file reached");
+     return token_stream_new_token(stream, TOKEN_EOF, "EOF", 3, stream->line, stream->position, false);
+ }
+ 
+ /**
+  * Map the whole input file into memory
+  */
+ static bool map_input_file(TokenStream* stream, const char* filename) {
+     if (!token_map_file(filename, &stream->map_data, &stream->map_size)) {
+         return false;
+     }
+     stream->map_pos = stream->map_data;
+     stream->owns_map = true;
+     return true;
+ }
+ 
+ /**
+  * Release the mapping created by map_input_file
+  */
+ static void unmap_input_file(TokenStream* stream) {
+     if (stream->owns_map) {
+         token_unmap_file(stream->map_data, stream->map_size);
+     }
+     stream->map_data = NULL;
+     stream->map_size = 0;
+ }
+ 
+ /**
+  * Map a whole file read-only
+  */
+ bool token_map_file(const char* filename, const char** data, size_t* size) {
+     *data = NULL;
+     *size = 0;
+ #ifdef _WIN32
+     // No mmap: read the file into one buffer instead
+     FILE* file = fopen(filename, "rb");
+     if (!file) {
+         return false;
      }
      
-     // If we hit a newline, handle it
-     if (*current_pos == '\n') {
-         line++;
-         position = 0;
-         current_pos++;
-         
-         // If at end of buffer, reset for next line read
-         if (*current_pos == '\0') {
-             buffer[0] = '\0';
+     fseek(file, 0, SEEK_END);
+     long length = ftell(file);
+     fseek(file, 0, SEEK_SET);
+     
+     char* buffer = (char*)safe_malloc(length > 0 ? (size_t)length : 1);
+     size_t read = length > 0 ? fread(buffer, 1, (size_t)length, file) : 0;
+     fclose(file);
+     
+     *data = buffer;
+     *size = read;
+ #else
+     int fd = open(filename, O_RDONLY);
+     if (fd < 0) {
+         return false;
+     }
+     
+     struct stat info;
+     if (fstat(fd, &info) != 0) {
+         close(fd);
+         return false;
+     }
+     
+     if (info.st_size > 0) {
+         void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (mapping == MAP_FAILED) {
+             close(fd);
+             return false;
          }
+         madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+         *data = (const char*)mapping;
+         *size = (size_t)info.st_size;
+     }
+     close(fd);
+ #endif
+     return true;
+ }
+ 
+ /**
+  * Release a mapping made by token_map_file
+  */
+ void token_unmap_file(const char* data, size_t size) {
+     if (!data) {
+         return;
+     }
+ #ifdef _WIN32
+     (void)size;
+     free((char*)data);
+ #else
+     munmap((void*)data, size);
+ #endif
+ }
+ 
+ /**
+  * Split "<lexeme, CATEGORY>" starting at start into its components
+  * in a single forward pass. The comma may or may not be followed by
+  * whitespace; lexeme and category must be non-empty and the whole
+  * token must end before the end of the line.
+  */
+ static bool scan_token_text(const char* start, const char* end, TokenText* text) {
+     // Lexeme runs up to the first comma
+     text->lexeme = start + 1;
+     const char* pos = scan_find3(text->lexeme, end, ',', '>', '\n');
+     if (pos == end || *pos != ',' || pos == text->lexeme) {
+         return false;
+     }
+     text->lexeme_length = (int)(pos - text->lexeme);
+     pos++;
+     
+     // Optional whitespace after the comma, on the same line
+     const char* category_start = pos;
+     ScanLines lines;
+     pos = scan_skip_space(pos, end, &lines);
+     if (lines.newlines > 0) {
+         return false;
      }
      
-     // Try again recursively
-     return scan_token(stream);
- }
\ No newline at end of file
+     // Category runs up to the closing '>'
+     text->category = pos;
+     pos = scan_find2(pos, end, '>', '\n');
+     if (pos == end || *pos != '>' || pos == category_start) {
+         return false;
+     }
+     text->category_length = (int)(pos - text->category);
+     text->type = token_type_from_text(text->category, text->category_length);
+     text->length = (int)(pos - start + 1);
+     
+     return true;
+ }
+ 
+ /**
+  * Update line and position after skipping from..to
+  */
+ static void advance_position(TokenStream* stream, const char* from, const char* to, const ScanLines* lines) {
+     if (lines->newlines > 0) {
+         stream->line += lines->newlines;
+         stream->position = (int)(to - lines->line_start);
+     } else {
+         stream->position += (int)(to - from);
+     }
+ }
@@ -0,0 +1,231 @@
+/**
+ * @file trace.c
+ * @brief Compact binary step trace writer and reader
+ * @members: Group
+ *
+ * Records are encoded byte by byte in little-endian order, so a trace
+ * can be decoded on any machine. The writer fills one large buffer and
+ * hands it to the file unbuffered, one write per TRACE_BUFFER_SIZE bytes.
+ */
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/trace.h"
+ #include "../include/utils.h"
+
+ // Longest path accepted in a header
+ #define TRACE_MAX_PATH 4096
+
+ static void put_u16(unsigned char* out, uint16_t value) {
+     out[0] = (unsigned char)value;
+     out[1] = (unsigned char)(value >> 8);
+ }
+
+ static void put_u32(unsigned char* out, uint32_t value) {
+     out[0] = (unsigned char)value;
+     out[1] = (unsigned char)(value >> 8);
+     out[2] = (unsigned char)(value >> 16);
+     out[3] = (unsigned char)(value >> 24);
+ }
+
+ static uint16_t get_u16(const unsigned char* in) {
+     return (uint16_t)(in[0] | (in[1] << 8));
+ }
+
+ static uint32_t get_u32(const unsigned char* in) {
+     return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+ }
+
+ /**
+  * Write the buffered bytes to the file
+  */
+ static void flush_buffer(TraceWriter* writer) {
+     if (writer->used > 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) {
+         writer->failed = true;
+     }
+     writer->used = 0;
+ }
+
+ /**
+  * Write a length-prefixed string to the header
+  */
+ static void put_string(TraceWriter* writer, const char* text) {
+     uint32_t length = text ? (uint32_t)strlen(text) : 0;
+     put_u32(writer->buffer + writer->used, length);
+     writer->used += 4;
+     if (length > 0) {
+         memcpy(writer->buffer + writer->used, text, length);
+         writer->used += length;
+     }
+ }
+
+ /**
+  * Create a trace file and write its header
+  */
+ TraceWriter* trace_writer_open(const char* path, const char* input_file, const char* grammar_file) {
+     if ((input_file && strlen(input_file) > TRACE_MAX_PATH) ||
+         (grammar_file && strlen(grammar_file) > TRACE_MAX_PATH)) {
+         log_error("Path too long for the trace header");
+         return NULL;
+     }
+
+     FILE* file = fopen(path, "wb");
+     if (!file) {
+         return NULL;
+     }
+     // The writer does its own buffering
+     setvbuf(file, NULL, _IONBF, 0);
+
+     TraceWriter* writer = (TraceWriter*)safe_malloc(sizeof(TraceWriter));
+     writer->file = file;
+     writer->buffer = (unsigned char*)safe_malloc(TRACE_BUFFER_SIZE);
+     writer->used = 0;
+     writer->steps = 0;
+     writer->failed = false;
+
+     memcpy(writer->buffer, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+     writer->used = sizeof(TRACE_MAGIC);
+     put_u32(writer->buffer + writer->used, TRACE_VERSION);
+     put_u32(writer->buffer + writer->used + 4, TRACE_RECORD_SIZE);
+     writer->used += 8;
+     put_string(writer, input_file);
+     put_string(writer, grammar_file);
+     return writer;
+ }
+
+ /**
+  * Append a record
+  */
+ void trace_writer_add(TraceWriter* writer, TraceRecord* record) {
+     if (writer->used + TRACE_RECORD_SIZE > TRACE_BUFFER_SIZE) {
+         flush_buffer(writer);
+     }
+
+     record->step = ++writer->steps;
+     unsigned char* out = writer->buffer + writer->used;
+     put_u32(out, record->step);
+     put_u32(out + 4, record->token);
+     put_u32(out + 8, record->popped);
+     put_u16(out + 12, record->state);
+     put_u16(out + 14, record->next_state);
+     put_u16(out + 16, record->param);
+     out[18] = record->operation;
+     out[19] = record->pushed;
+     writer->used += TRACE_RECORD_SIZE;
+ }
+
+ /**
+  * Flush and close a trace file
+  */
+ bool trace_writer_close(TraceWriter* writer) {
+     if (!writer) {
+         return true;
+     }
+     flush_buffer(writer);
+     bool ok = !writer->failed;
+     if (fclose(writer->file) != 0) {
+         ok = false;
+     }
+     free(writer->buffer);
+     free(writer);
+     return ok;
+ }
+
+ /**
+  * Read a length-prefixed string of the header, NULL if empty
+  */
+ static bool read_string(FILE* file, char** text) {
+     unsigned char length_bytes[4];
+     if (fread(length_bytes, 1, 4, file) != 4) {
+         return false;
+     }
+     uint32_t length = get_u32(length_bytes);
+     if (length > TRACE_MAX_PATH) {
+         return false;
+     }
+
+     *text = NULL;
+     if (length == 0) {
+         return true;
+     }
+     *text = (char*)safe_malloc(length + 1);
+     if (fread(*text, 1, length, file) != length) {
+         free(*text);
+         *text = NULL;
+         return false;
+     }
+     (*text)[length] = '\0';
+     return true;
+ }
+
+ /**
+  * Open a trace file and read its header
+  */
+ TraceReader* trace_reader_open(const char* path) {
+     FILE* file = fopen(path, "rb");
+     if (!file) {
+         log_error("Could not open trace file %s", path);
+         return NULL;
+     }
+
+     unsigned char header[sizeof(TRACE_MAGIC) + 8];
+     if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+         memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+         log_error("%s is not a trace file", path);
+         fclose(file);
+         return NULL;
+     }
+     uint32_t version = get_u32(header + sizeof(TRACE_MAGIC));
+     uint32_t record_size = get_u32(header + sizeof(TRACE_MAGIC) + 4);
+     if (version != TRACE_VERSION || record_size != TRACE_RECORD_SIZE) {
+         log_error("%s: unsupported trace version %u", path, version);
+         fclose(file);
+         return NULL;
+     }
+
+     TraceReader* reader = (TraceReader*)safe_malloc(sizeof(TraceReader));
+     reader->file = file;
+     reader->input_file = NULL;
+     reader->grammar_file = NULL;
+     reader->truncated = false;
+     if (!read_string(file, &reader->input_file) || !read_string(file, &reader->grammar_file)) {
+         log_error("%s: truncated trace header", path);
+         trace_reader_close(reader);
+         return NULL;
+     }
+     return reader;
+ }
+
+ /**
+  * Read the next record
+  */
+ bool trace_reader_next(TraceReader* reader, TraceRecord* record) {
+     unsigned char in[TRACE_RECORD_SIZE];
+     size_t length = fread(in, 1, TRACE_RECORD_SIZE, reader->file);
+     if (length != TRACE_RECORD_SIZE) {
+         reader->truncated = length > 0;
+         return false;
+     }
+     record->step = get_u32(in);
+     record->token = get_u32(in + 4);
+     record->popped = get_u32(in + 8);
+     record->state = get_u16(in + 12);
+     record->next_state = get_u16(in + 14);
+     record->param = get_u16(in + 16);
+     record->operation = in[18];
+     record->pushed = in[19];
+     return true;
+ }
+
+ /**
+  * Close a trace reader
+  */
+ void trace_reader_close(TraceReader* reader) {
+     if (!reader) {
+         return;
+     }
+     fclose(reader->file);
+     free(reader->input_file);
+     free(reader->grammar_file);
+     free(reader);
+ }
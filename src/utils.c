@@ -8,9 +8,26 @@
  #include <stdlib.h>
  #include <string.h>
  #include <stdarg.h>
+ #include <time.h>
+ #include <stdatomic.h>
  #include "../include/utils.h"
  #include"../include/parser.h"
  
+ // Allocations of the current thread, see allocation_count
+ static _Thread_local uint64_t thread_allocations = 0;
+ 
+ // Messages up to this length are formatted on the stack
+ #define LOG_BUFFER_SIZE 512
+ 
+ // Run-time log threshold and destination
+ static _Atomic int log_level = LOG_LEVEL_INFO;
+ static LogSink log_sink = log_file_sink;
+ static void* log_sink_context = NULL;
+ 
+ static const char* LOG_LEVEL_NAMES[] = { "debug", "info", "warn", "error", "off" };
+ 
+ static void log_vmessage(int level, const char* format, va_list args);
+ 
  /**
   * Safe string duplication with error handling
   */
@@ -24,6 +41,7 @@
          log_error("Memory allocation failed (strdup)");
          exit(EXIT_FAILURE);
      }
+     thread_allocations++;
      
      return dup;
  }
@@ -37,6 +55,7 @@
          log_error("Memory allocation failed (malloc)");
          exit(EXIT_FAILURE);
      }
+     thread_allocations++;
      
      return ptr;
  }
@@ -50,42 +69,129 @@
          log_error("Memory allocation failed (realloc)");
          exit(EXIT_FAILURE);
      }
+     thread_allocations++;
      
      return new_ptr;
  }
  
  /**
-  * Log error message to stderr
+  * Set the least severe level logged at run time
   */
- void log_error(const char* format, ...) {
+ void log_set_level(int level) {
+     atomic_store_explicit(&log_level, level, memory_order_relaxed);
+ }
+ 
+ /**
+  * Least severe level logged at run time
+  */
+ int log_get_level(void) {
+     return atomic_load_explicit(&log_level, memory_order_relaxed);
+ }
+ 
+ /**
+  * Parse a level name
+  */
+ bool log_level_from_name(const char* name, int* level) {
+     for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_OFF; i++) {
+         if (strcmp(name, LOG_LEVEL_NAMES[i]) == 0) {
+             *level = i;
+             return true;
+         }
+     }
+     return false;
+ }
+ 
+ /**
+  * Send the log messages somewhere else
+  */
+ void log_set_sink(LogSink sink, void* context) {
+     log_sink = sink ? sink : log_file_sink;
+     log_sink_context = sink ? context : NULL;
+ }
+ 
+ /**
+  * Sink writing "LEVEL: message" lines to a FILE* (stderr for NULL)
+  */
+ void log_file_sink(int level, const char* message, void* context) {
+     FILE* out = context ? (FILE*)context : stderr;
+     static const char* prefixes[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+     
+     // One call per line, so lines of different threads do not interleave
+     fprintf(out, "%s: %s\n", prefixes[level < LOG_LEVEL_OFF ? level : LOG_LEVEL_ERROR], message);
+ }
+ 
+ /**
+  * Check whether a message of this level would be logged
+  */
+ bool log_enabled(int level) {
+     return level >= LOG_COMPILE_LEVEL && level >= log_get_level();
+ }
+ 
+ /**
+  * Format a message and pass it to the sink
+  */
+ void log_message(int level, const char* format, ...) {
      va_list args;
      va_start(args, format);
+     log_vmessage(level, format, args);
+     va_end(args);
+ }
+ 
+ /**
+  * Log error message (always compiled in)
+  */
+ void log_error(const char* format, ...) {
+     if (!log_enabled(LOG_LEVEL_ERROR)) {
+         return;
+     }
      
-     fprintf(stderr, "ERROR: ");
-     vfprintf(stderr, format, args);
-     fprintf(stderr, "\n");
-     
+     va_list args;
+     va_start(args, format);
+     log_vmessage(LOG_LEVEL_ERROR, format, args);
      va_end(args);
  }
  
  /**
-  * Log debug message to stderr if debug mode is enabled
+  * Log debug message if debug mode is enabled
   */
  void log_debug(bool debug_mode, const char* format, ...) {
-     if (!debug_mode) {
+     if (!debug_mode || !log_enabled(LOG_LEVEL_DEBUG)) {
          return;
      }
      
      va_list args;
      va_start(args, format);
-     
-     fprintf(stderr, "DEBUG: ");
-     vfprintf(stderr, format, args);
-     fprintf(stderr, "\n");
-     
+     log_vmessage(LOG_LEVEL_DEBUG, format, args);
      va_end(args);
  }
  
+ /**
+  * Format into a stack buffer (the heap for long messages) and call the sink
+  */
+ static void log_vmessage(int level, const char* format, va_list args) {
+     char buffer[LOG_BUFFER_SIZE];
+     va_list copy;
+     va_copy(copy, args);
+     int length = vsnprintf(buffer, sizeof(buffer), format, args);
+     
+     if (length < 0) {
+         va_end(copy);
+         return;
+     }
+     if ((size_t)length < sizeof(buffer)) {
+         log_sink(level, buffer, log_sink_context);
+     } else {
+         // Not safe_malloc: a failure would log again
+         char* message = (char*)malloc((size_t)length + 1);
+         if (message) {
+             vsnprintf(message, (size_t)length + 1, format, copy);
+             log_sink(level, message, log_sink_context);
+             free(message);
+         }
+     }
+     va_end(copy);
+ }
+ 
  /**
   * Format a string using printf-style formatting
   */
@@ -133,4 +239,69 @@
      strcat(original, append);
      
      return original;
- }
\ No newline at end of file
+ }
+ 
+ /**
+  * Output filename <input_basename>_p3dbg<extension>
+  */
+ static char* output_filename_with(const char* input_file, const char* extension) {
+     // Extract the base filename without path
+     char* base_name = strrchr(input_file, '/');
+     if (base_name == NULL) {
+         base_name = strrchr(input_file, '\\');
+     }
+     
+     if (base_name != NULL) {
+         base_name++; // Skip the slash
+     } else {
+         base_name = (char*)input_file; // No path separator found
+     }
+     
+     // Find extension and remove it if present
+     char* basename_copy = safe_strdup(base_name);
+     char* dot = strrchr(basename_copy, '.');
+     if (dot != NULL) {
+         *dot = '\0'; // Truncate at the dot
+     }
+     
+     // Create output filename: <basename>_p3dbg<extension>
+     char* output_file = string_format("%s_p3dbg%s", basename_copy, extension);
+     free(basename_copy);
+     
+     return output_file;
+ }
+ 
+ /**
+  * Generate output filename from input filename
+  * Follows the format: <input_basename>_p3dbg.txt
+  */
+ char* generate_output_filename(const char* input_file) {
+     return output_filename_with(input_file, ".txt");
+ }
+ 
+ /**
+  * Generate the binary trace filename: <input_basename>_p3dbg.bin
+  */
+ char* generate_trace_filename(const char* input_file) {
+     return output_filename_with(input_file, ".bin");
+ }
+ 
+ /**
+  * Allocations made by the calling thread
+  */
+ uint64_t allocation_count(void) {
+     return thread_allocations;
+ }
+ 
+ /**
+  * Nanoseconds from a monotonic clock
+  */
+ uint64_t monotonic_ns(void) {
+     struct timespec now;
+ #ifdef _WIN32
+     timespec_get(&now, TIME_UTC);
+ #else
+     clock_gettime(CLOCK_MONOTONIC, &now);
+ #endif
+     return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+ }
@@ -0,0 +1,134 @@
+/**
+ * @file workers.c
+ * @brief Worker threads and per-input results shared by batch and split mode
+ * @members: Group
+ *
+ * Both modes give every worker its own Parser sharing the read-only
+ * tables, let each parse write only the result slot of its input and
+ * write the lines in input order once the workers are done. How the
+ * inputs are handed out is left to the loop of the mode.
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <pthread.h>
+ #include "../include/workers.h"
+ #include "../include/utils.h"
+
+ /**
+  * What a started thread runs
+  */
+ typedef struct {
+     WorkerThread* worker;
+     WorkerLoop loop;
+ } WorkerStart;
+
+ /**
+  * Thread entry point of the workers started by worker_run
+  */
+ static void* worker_main(void* arg) {
+     WorkerStart* start = (WorkerStart*)arg;
+     start->loop(start->worker);
+     return NULL;
+ }
+
+ /**
+  * Run a loop on a number of workers
+  */
+ void worker_run(Parser* parser, int jobs, const char* name, WorkerLoop loop, void* shared,
+                 ParseStats* totals) {
+     WorkerThread* workers = (WorkerThread*)safe_malloc(sizeof(WorkerThread) * jobs);
+     WorkerStart* starts = (WorkerStart*)safe_malloc(sizeof(WorkerStart) * jobs);
+
+     for (int w = 0; w < jobs; w++) {
+         workers[w].shared = shared;
+         workers[w].index = w;
+         workers[w].stats = totals ? parse_stats_create(parser->tables->num_productions) : NULL;
+         // Worker 0 is the calling thread with the caller's parser
+         workers[w].parser = w == 0 ? parser : parser_create_worker(parser);
+         starts[w].worker = &workers[w];
+         starts[w].loop = loop;
+     }
+
+     int started = 1;
+     for (int w = 1; w < jobs; w++) {
+         if (pthread_create(&workers[w].thread, NULL, worker_main, &starts[w]) != 0) {
+             log_error("Could not start %s worker %d", name, w);
+             break;
+         }
+         started++;
+     }
+     loop(&workers[0]);
+
+     for (int w = 1; w < started; w++) {
+         pthread_join(workers[w].thread, NULL);
+     }
+     // A worker that failed to start may leave work behind, finish it here
+     loop(&workers[0]);
+
+     for (int w = 0; w < jobs; w++) {
+         if (w > 0) {
+             parser_free(workers[w].parser);
+         }
+         if (totals) {
+             parse_stats_add(totals, workers[w].stats);
+             parse_stats_free(workers[w].stats);
+         }
+     }
+     free(starts);
+     free(workers);
+ }
+
+ /**
+  * Move the outcome of a parse into its result slot
+  */
+ void worker_result_store(WorkerResult* slot, ParseResult* result, ParseStats* totals) {
+     slot->success = result->success;
+     slot->steps = result->steps_taken;
+     slot->line = result->error_line;
+     slot->position = result->error_position;
+     slot->message = result->success ? NULL : result->error_message;
+     slot->has_value = result->has_value;
+     slot->value = result->value.number;
+     slot->nodes = result->ast ? (int)result->ast->num_nodes : -1;
+     slot->errors = result->error_count;
+     if (totals && result->stats) {
+         parse_stats_add(totals, result->stats);
+     }
+
+     // The message now belongs to the slot
+     if (!result->success) {
+         result->error_message = NULL;
+     }
+     parse_result_free(result);
+ }
+
+ /**
+  * Write the rest of a result line after the name of its input
+  */
+ void worker_result_print(FILE* out, const WorkerResult* result) {
+     if (result->success) {
+         fprintf(out, " ACCEPT steps=%d", result->steps);
+         if (result->has_value) {
+             fprintf(out, " value=%.15g", result->value);
+         }
+         if (result->nodes >= 0) {
+             fprintf(out, " nodes=%d", result->nodes);
+         }
+         fputc('\n', out);
+     } else {
+         fprintf(out, " ERROR steps=%d", result->steps);
+         if (result->errors > 1) {
+             fprintf(out, " errors=%d", result->errors);
+         }
+         fprintf(out, " line=%d position=%d: %s\n", result->line, result->position,
+                 result->message ? result->message : "Unknown error");
+     }
+ }
+
+ /**
+  * Seconds from a monotonic clock
+  */
+ double worker_now_seconds(void) {
+     return (double)monotonic_ns() / 1e9;
+ }
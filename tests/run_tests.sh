@@ -0,0 +1,282 @@
+#!/bin/sh
+# Regression tests of the parser (run by "make test")
+#
+# Every case runs the parser from this directory and compares what it
+# prints, stdout and stderr together, with <name>_output.txt next to the
+# inputs, and its exit status with the one given for the case. The step
+# traces are turned off, so no debug file is written. DEBUG and INFO
+# messages are left out, a build with a higher LOG_LEVEL has none, and
+# so are the time and threads of the --batch and --split summaries and
+# the allocations and time_ns of --stats, which depend on the build.
+#
+# Usage: tests/run_tests.sh <parser> [<p3trace> [<p3bench>]]
+# The binary trace cases need the decoder and the parser reuse cases the
+# benchmark, each is skipped without it.
+# With UPDATE=1 the expected outputs are rewritten from the current ones.
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <parser> [<p3trace> [<p3bench>]]" >&2
+    exit 2
+fi
+
+# absolute <path>
+absolute() {
+    case "$1" in
+        /*) echo "$1" ;;
+        *) echo "$(pwd)/$1" ;;
+    esac
+}
+
+parser=$(absolute "$1")
+p3trace=
+if [ $# -ge 2 ]; then
+    p3trace=$(absolute "$2")
+fi
+p3bench=
+if [ $# -ge 3 ]; then
+    p3bench=$(absolute "$3")
+fi
+
+cd "$(dirname "$0")" || exit 2
+work=$(mktemp -d) || exit 2
+trap 'rm -rf "$work"' EXIT
+
+passed=0
+failed=0
+
+# run <label> <expected output> <exit status> <parser arguments...>
+run() {
+    label=$1
+    expected=$2
+    expected_status=$3
+    shift 3
+    "$parser" --trace=off "$@" > "$work/$label.raw" 2>&1
+    status=$?
+    # Files made in the work directory are named relative to it
+    grep -Ev '^(DEBUG|INFO): ' "$work/$label.raw" |
+        sed -e "s|$work/||g" -e 's/ in [0-9.]* s with [0-9]* threads* (.*)$//' \
+            -e '/"allocations": /d' -e '/"time_ns": {/,/}/d' > "$work/$label.txt"
+
+    if [ "$UPDATE" = 1 ] && [ "$label" = "$expected" ]; then
+        cp "$work/$label.txt" "${expected}_output.txt"
+    fi
+    if [ "$status" -ne "$expected_status" ]; then
+        echo "FAIL $label: exit status $status, expected $expected_status"
+        failed=$((failed + 1))
+    elif ! diff -u "${expected}_output.txt" "$work/$label.txt"; then
+        echo "FAIL $label: output differs from ${expected}_output.txt"
+        failed=$((failed + 1))
+    else
+        echo "ok   $label"
+        passed=$((passed + 1))
+    fi
+}
+
+# check <name> <exit status> <parser arguments...>
+check() {
+    name=$1
+    shift
+    run "$name" "$name" "$@"
+}
+
+# same <name> <grammar> <exit status> <parser arguments...>
+# The case <name> again with the tables of a grammar file, which must print the same
+same() {
+    name=$1
+    grammar=$2
+    expected_status=$3
+    shift 3
+    run "$name-$(basename "$grammar" .bnf)" "$name" "$expected_status" --grammar "$grammar" "$@"
+}
+
+# with <option> <name> <exit status> <parser arguments...>
+# The case <name> again with an option that must not change what is printed
+with() {
+    option=$1
+    name=$2
+    expected_status=$3
+    shift 3
+    run "$name$option" "$name" "$expected_status" "$option" "$@"
+}
+
+# cache <name> <created|kept|rewritten> <parser arguments...>
+# A case that also checks what it did to $work/expr.cache, which is
+# renamed into place when it is written
+cache() {
+    name=$1
+    expected_action=$2
+    shift 2
+    before=$(ls -i "$work/expr.cache" 2> /dev/null | cut -d ' ' -f 1)
+    check "$name" 0 "$@"
+    after=$(ls -i "$work/expr.cache" 2> /dev/null | cut -d ' ' -f 1)
+    if [ -z "$before" ]; then
+        action=created
+    elif [ "$before" = "$after" ]; then
+        action=kept
+    else
+        action=rewritten
+    fi
+    if [ "$action" != "$expected_action" ]; then
+        echo "FAIL $name: cache $action, expected $expected_action"
+        failed=$((failed + 1))
+    fi
+}
+
+# trace <name> <parser arguments...> <input>
+# The binary trace of a parse, decoded by p3trace, must be the text trace
+# of the same parse. Both are written to the work directory.
+trace() {
+    name=$1
+    shift
+    if [ -z "$p3trace" ]; then
+        echo "skip $name: no p3trace given"
+        return
+    fi
+    # The input is the last argument, the trace files are named after it
+    for input; do :; done
+    base=$(basename "$input" .cscn)
+    (cd "$work" && rm -f "${base}_p3dbg.txt" "${base}_p3dbg.bin" &&
+     "$parser" --trace=file "$@" > /dev/null 2>&1
+     "$parser" --trace=binary "$@" > /dev/null 2>&1
+     "$p3trace" "${base}_p3dbg.bin" > "$name.decoded" 2>&1)
+    if [ ! -s "$work/${base}_p3dbg.txt" ]; then
+        echo "FAIL $name: no text trace written"
+        failed=$((failed + 1))
+    elif ! diff -u "$work/${base}_p3dbg.txt" "$work/$name.decoded"; then
+        echo "FAIL $name: decoded binary trace differs from the text trace"
+        failed=$((failed + 1))
+    else
+        echo "ok   $name"
+        passed=$((passed + 1))
+    fi
+}
+
+# reuse <name> <input>
+# Parses with parser_parse_buffer on one parser, accepted ones must not
+# allocate after the first (checked by the reuse component of p3bench)
+reuse() {
+    name=$1
+    if [ -z "$p3bench" ]; then
+        echo "skip $name: no p3bench given"
+        return
+    fi
+    if "$p3bench" --repeat 5 --only reuse "$2" > "$work/$name.txt" 2>&1; then
+        echo "ok   $name"
+        passed=$((passed + 1))
+    else
+        cat "$work/$name.txt"
+        echo "FAIL $name: p3bench reuse failed"
+        failed=$((failed + 1))
+    fi
+}
+
+# Error recovery: every error with its line, position and expected tokens
+check test_recover 1 --recover test_recover.cscn
+check test_recover_limit 1 --recover=3 test_recover.cscn
+check test_recover_eof 1 --recover test_recover_eof.cscn
+
+# Incremental reparsing: where each edit resumed, what it shifted, whether it converged
+check test_edit 1 --edits test_edit.edits test_edit.cscn
+check test_edit_compact 0 --edits test_edit_compact.edits test_edit_compact.cscn
+
+# A lexeme and a line longer than the scanner's line buffer, read the same way by every scanner
+check test_long 0 test_long.cscn
+run test_long-mmap test_long 0 --mmap test_long.cscn
+run test_long-stream test_long 0 --stream test_long.cscn
+run test_long-async-io test_long 0 --async-io test_long.cscn
+
+# A read error fails the parse instead of ending the input: a directory
+# opens like a file on Linux, and then cannot be read
+mkdir "$work/dir.cscn"
+check test_read_error 1 "$work/dir.cscn"
+run test_read_error-async-io test_read_error 1 --async-io "$work/dir.cscn"
+run test_read_error-fast test_read_error 1 --fast "$work/dir.cscn"
+
+# Plain parses, evaluation and syntax trees of the sample inputs
+check test_input1 0 test_input1.cscn
+check test_input2 1 test_input2.cscn
+check test_input3 1 test_input3.cscn
+check test_input4 0 test_input4.cscn
+check test_eval1 0 --eval test_input1.cscn
+check test_eval2 1 --eval test_input2.cscn
+check test_eval3 1 --eval test_input3.cscn
+check test_eval4 0 --eval test_input4.cscn
+check test_ast1 0 --ast test_input1.cscn
+
+# Other ways of reading the input: same results, steps and errors
+for option in --mmap --stream --async-io; do
+    with $option test_input1 0 test_input1.cscn
+    with $option test_input2 1 test_input2.cscn
+    with $option test_eval1 0 --eval test_input1.cscn
+    with $option test_eval3 1 --eval test_input3.cscn
+    with $option test_eval4 0 --eval test_input4.cscn
+    with $option test_recover 1 --recover test_recover.cscn
+done
+
+# The generated engine of the built-in grammar: same results and steps
+with --fast test_input1 0 test_input1.cscn
+with --fast test_input2 1 test_input2.cscn
+with --fast test_input3 1 test_input3.cscn
+with --fast test_input4 0 test_input4.cscn
+with --fast test_long 0 test_long.cscn
+
+# Performance counters: steps, shifts, reductions by production, stack depth and input read
+check test_stats1 0 --stats test_input1.cscn
+check test_stats_recover 1 --stats --recover test_recover.cscn
+
+# Batch mode: one line per file in input order, recovering from errors,
+# with one worker and with workers stealing each other's files
+batch="--batch --recover test_input1.cscn test_input2.cscn test_input3.cscn test_input4.cscn test_recover.cscn"
+check test_batch 1 --jobs=1 $batch
+run test_batch-jobs4 test_batch 1 --jobs=4 $batch
+
+# Split mode: every expression parsed on its own, with the lines and
+# positions of the whole file, one per line and between SEMI tokens
+check test_split 1 --split --eval --jobs=2 test_split.cscn
+check test_split_semi 1 --split=SEMI --eval --jobs=2 test_split_semi.cscn
+
+# LALR(1) tables of grammars/expr.bnf: same steps, values and errors as the built-in ones,
+# and no conflict warning
+same test_eval1 ../grammars/expr.bnf 0 --eval test_input1.cscn
+same test_eval2 ../grammars/expr.bnf 1 --eval test_input2.cscn
+same test_eval3 ../grammars/expr.bnf 1 --eval test_input3.cscn
+same test_eval4 ../grammars/expr.bnf 0 --eval test_input4.cscn
+same test_recover ../grammars/expr.bnf 1 --recover test_recover.cscn
+same test_recover_eof ../grammars/expr.bnf 1 --recover test_recover_eof.cscn
+
+# Skipping unit reductions: fewer steps, the same results and values
+check test_collapse1 0 --collapse-units test_input1.cscn
+check test_collapse_eval1 0 --collapse-units --eval test_input1.cscn
+run test_collapse_eval2 test_eval2 1 --collapse-units --eval test_input2.cscn
+run test_collapse_eval3 test_eval3 1 --collapse-units --eval test_input3.cscn
+check test_collapse_eval4 0 --collapse-units --eval test_input4.cscn
+
+# A grammar with conflicts: their number, and the rules the resolution picks in the tree
+check test_conflict 0 --grammar test_conflict.bnf --ast test_conflict.cscn
+
+# Table cache: created when missing, then mapped; rebuilt when the grammar
+# changes, when a byte is flipped and when the file is cut short, and
+# mapped again after that
+cp ../grammars/expr.bnf "$work/expr.bnf"
+args="--grammar $work/expr.bnf --table-cache $work/expr.cache --eval test_input1.cscn"
+cache test_cache_missing created $args
+cache test_cache_loaded kept $args
+echo "# Changed" >> "$work/expr.bnf"
+cache test_cache_stale rewritten $args
+printf '\377' | dd of="$work/expr.cache" bs=1 seek=300 conv=notrunc 2> /dev/null
+cache test_cache_corrupt rewritten $args
+head -c 100 "$work/expr.cache" > "$work/expr.cache.part"
+mv "$work/expr.cache.part" "$work/expr.cache"
+cache test_cache_truncated rewritten $args
+cache test_cache_reloaded kept $args
+
+# Binary traces decode to the text trace, of an accepted and of a recovering parse
+trace test_trace_accept "$(pwd)/test_input1.cscn"
+trace test_trace_recover --recover "$(pwd)/test_recover.cscn"
+
+# A reused parser makes no allocation once its memory has grown to the input
+reuse test_reuse1 test_input1.cscn
+reuse test_reuse_long test_long.cscn
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,351 @@
+/**
+ * @file gen_tables.c
+ * @brief Build-time generator for the static parsing tables header
+ * @members: Group
+ *
+ * Builds the tables at run time with automaton_init, or with the LALR(1)
+ * generator from a grammar file, and prints them as C source on stdout.
+ * The Makefile runs this to produce expr_tables.h, and with --engine the
+ * parse loop specialized for the same tables, expr_engine.h (see engine.h).
+ *
+ * Usage: gen_tables [--grammar FILE] [--listing] [--engine] [prefix] > header.h
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <ctype.h>
+ #include "../include/automaton.h"
+ #include "../include/lalr.h"
+ #include "../include/token.h"
+
+ /**
+  * Print a string literal, escaping everything outside printable ASCII
+  * (octal escapes so following characters cannot extend them)
+  */
+ static void emit_string(FILE* out, const char* text) {
+     fputc('"', out);
+     for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+         if (*c == '"' || *c == '\\') {
+             fprintf(out, "\\%c", *c);
+         } else if (*c < 0x20 || *c >= 0x7F) {
+             fprintf(out, "\\%03o", *c);
+         } else {
+             fputc(*c, out);
+         }
+     }
+     fputc('"', out);
+ }
+
+ /**
+  * Include guard stem from the upper-cased prefix
+  */
+ static void make_guard(const char* prefix, char* guard, size_t size) {
+     size_t length = 0;
+     for (const char* c = prefix; *c && length < size - 1; c++) {
+         guard[length++] = (char)toupper((unsigned char)*c);
+     }
+     guard[length] = '\0';
+ }
+
+ /**
+  * Print the tables as static const definitions named <prefix>_*
+  */
+ static void emit_tables(FILE* out, const ParsingTables* tables, const char* prefix) {
+     int action_count = tables->num_states * tables->num_terminals;
+     int goto_count = tables->num_states * tables->num_non_terminals;
+
+     char guard[64];
+     make_guard(prefix, guard, sizeof(guard));
+
+     fprintf(out, "/* Generated by tools/gen_tables.c - do not edit */\n\n");
+     fprintf(out, "#ifndef %s_TABLES_H\n#define %s_TABLES_H\n\n", guard, guard);
+     fprintf(out, "#include \"parser.h\"\n\n");
+
+     // Action table, one row per state
+     fprintf(out, "static const uint16_t %s_action_table[%d] = {\n", prefix, action_count);
+     for (int state = 0; state < tables->num_states; state++) {
+         fprintf(out, "    ");
+         for (int token = 0; token < tables->num_terminals; token++) {
+             fprintf(out, "0x%04x,", tables->action_table[state * tables->num_terminals + token]);
+         }
+         fprintf(out, " /* state %d */\n", state);
+     }
+     fprintf(out, "};\n\n");
+
+     // Goto table, one row per state
+     fprintf(out, "static const int16_t %s_goto_table[%d] = {\n", prefix, goto_count);
+     for (int state = 0; state < tables->num_states; state++) {
+         fprintf(out, "    ");
+         for (int nt = 0; nt < tables->num_non_terminals; nt++) {
+             fprintf(out, "%d,", tables->goto_table[state * tables->num_non_terminals + nt]);
+         }
+         fprintf(out, " /* state %d */\n", state);
+     }
+     fprintf(out, "};\n\n");
+
+     // Right-hand sides
+     for (int i = 1; i <= tables->num_productions; i++) {
+         const Production* production = &tables->productions[i];
+         if (production->rhs_length == 0) {
+             continue;
+         }
+         fprintf(out, "static const int %s_rhs_%d[%d] = {", prefix, i, production->rhs_length);
+         for (int j = 0; j < production->rhs_length; j++) {
+             fprintf(out, " %d,", production->rhs[j]);
+         }
+         fprintf(out, " };\n");
+     }
+     fprintf(out, "\n");
+
+     // Productions, index 0 is the dummy entry
+     fprintf(out, "static const Production %s_productions[%d] = {\n", prefix, tables->num_productions + 1);
+     for (int i = 0; i <= tables->num_productions; i++) {
+         const Production* production = &tables->productions[i];
+         fprintf(out, "    { %d, ", production->lhs);
+         if (i > 0 && production->rhs_length > 0) {
+             fprintf(out, "%s_rhs_%d, ", prefix, i);
+         } else {
+             fprintf(out, "NULL, ");
+         }
+         fprintf(out, "%d, ", production->rhs_length);
+         emit_string(out, production->rule_string ? production->rule_string : "");
+         fprintf(out, " },\n");
+     }
+     fprintf(out, "};\n\n");
+
+     // Non-terminal names of generated grammars
+     if (tables->non_terminal_names) {
+         fprintf(out, "static const char* const %s_non_terminal_names[%d] = {\n",
+                 prefix, tables->num_non_terminals);
+         for (int i = 0; i < tables->num_non_terminals; i++) {
+             fprintf(out, "    ");
+             emit_string(out, tables->non_terminal_names[i]);
+             fprintf(out, ",\n");
+         }
+         fprintf(out, "};\n\n");
+     }
+
+     // Expected-token sets, so errors need no scan of the action row
+     fprintf(out, "static const uint32_t %s_expected[%d] = {\n", prefix, tables->num_states);
+     for (int state = 0; state < tables->num_states; state++) {
+         fprintf(out, "    0x%02x, /* state %d */\n", tables_expected(tables, state), state);
+     }
+     fprintf(out, "};\n\n");
+     fprintf(out, "static const char* const %s_expected_messages[%d] = {\n", prefix, tables->num_states);
+     for (int state = 0; state < tables->num_states; state++) {
+         fprintf(out, "    ");
+         emit_string(out, tables_expected_message(tables, state));
+         fprintf(out, ",\n");
+     }
+     fprintf(out, "};\n\n");
+
+     fprintf(out, "static const ParsingTables %s_tables = {\n", prefix);
+     fprintf(out, "    .action_table = %s_action_table,\n", prefix);
+     fprintf(out, "    .goto_table = %s_goto_table,\n", prefix);
+     fprintf(out, "    .num_states = %d,\n", tables->num_states);
+     fprintf(out, "    .num_terminals = %d,\n", tables->num_terminals);
+     fprintf(out, "    .num_non_terminals = %d,\n", tables->num_non_terminals);
+     if (tables->non_terminal_names) {
+         fprintf(out, "    .non_terminal_names = %s_non_terminal_names,\n", prefix);
+     }
+     fprintf(out, "    .expected = %s_expected,\n", prefix);
+     fprintf(out, "    .expected_messages = %s_expected_messages,\n", prefix);
+     fprintf(out, "    .productions = %s_productions,\n", prefix);
+     fprintf(out, "    .num_productions = %d,\n", tables->num_productions);
+     fprintf(out, "    .is_static = true\n");
+     fprintf(out, "};\n\n");
+
+     fprintf(out, "#endif /* %s_TABLES_H */\n", guard);
+ }
+
+ /**
+  * Print the case label of an action table column
+  */
+ static void emit_token_case(FILE* out, int token) {
+     if (token <= TOKEN_NON_TERMINAL) {
+         fprintf(out, "        case TOKEN_%s:\n", token_type_to_string((TokenType)token));
+     } else {
+         fprintf(out, "        case %d:\n", token);
+     }
+ }
+
+ /**
+  * Print a reduction folded with its goto: the state uncovered by the
+  * pop selects the goto state, which is pushed and jumped to directly
+  */
+ static void emit_reduce(FILE* out, const ParsingTables* tables, int production_num) {
+     const Production* production = &tables->productions[production_num];
+     int length = production->rhs_length;
+     bool* done = (bool*)calloc((size_t)tables->num_states, sizeof(bool));
+
+     fprintf(out, "            switch (ENGINE_BELOW(%d)) {\n", length);
+     for (int below = 0; below < tables->num_states; below++) {
+         int target = tables_goto(tables, below, production->lhs);
+         if (target < 0 || done[below]) {
+             continue;
+         }
+         // One case list per goto state
+         for (int other = below; other < tables->num_states; other++) {
+             if (!done[other] && tables_goto(tables, other, production->lhs) == target) {
+                 fprintf(out, "                case %d:\n", other);
+                 done[other] = true;
+             }
+         }
+         if (length > 0) {
+             fprintf(out, "                    ENGINE_REDUCE(%d, %d, %d);\n", production_num, length, target);
+         } else {
+             fprintf(out, "                    ENGINE_PUSH_GOTO(%d, %d);\n", production_num, target);
+         }
+         fprintf(out, "                    goto state_%d;\n", target);
+     }
+     fprintf(out, "                default:\n");
+     fprintf(out, "                    ENGINE_FAIL();\n");
+     fprintf(out, "            }\n");
+     free(done);
+ }
+
+ /**
+  * Print the parse loop specialized for the tables as a function named
+  * <prefix>_engine. Every state is a label, so the top state lives in the
+  * program counter; shifts jump straight to their target and every
+  * (state, production) reduction is inlined with its goto lookup. The
+  * ENGINE_* operations are macros of the including file (src/engine.c)
+  */
+ static void emit_engine(FILE* out, const ParsingTables* tables, const char* prefix) {
+     int num_states = tables->num_states;
+     int num_terminals = tables->num_terminals;
+
+     // Only states something jumps to get a label (-Wunused-label)
+     bool* targeted = (bool*)calloc((size_t)num_states, sizeof(bool));
+     for (int state = 0; state < num_states; state++) {
+         for (int token = 0; token < num_terminals; token++) {
+             int action = tables_action(tables, state, (TokenType)token);
+             if (action_type_of(action) == ACTION_SHIFT) {
+                 targeted[action_value_of(action)] = true;
+             }
+         }
+         for (int nt = 0; nt < tables->num_non_terminals; nt++) {
+             int target = tables_goto(tables, state, nt);
+             if (target >= 0) {
+                 targeted[target] = true;
+             }
+         }
+     }
+
+     char guard[64];
+     make_guard(prefix, guard, sizeof(guard));
+
+     fprintf(out, "/* Generated by tools/gen_tables.c - do not edit */\n\n");
+     fprintf(out, "#ifndef %s_ENGINE_H\n#define %s_ENGINE_H\n\n", guard, guard);
+     fprintf(out, "/* Parse loop of the %s tables, %d states, one label per state */\n\n",
+             prefix, num_states);
+     fprintf(out, "static EngineStatus %s_engine(EngineRun* run) {\n", prefix);
+     fprintf(out, "    ENGINE_ENTER();\n");
+
+     bool* emitted = (bool*)calloc((size_t)num_terminals, sizeof(bool));
+     for (int state = 0; state < num_states; state++) {
+         fprintf(out, "\n");
+         if (targeted[state]) {
+             fprintf(out, "state_%d:\n", state);
+         } else {
+             fprintf(out, "    /* state %d */\n", state);
+         }
+         fprintf(out, "    ENGINE_STEP();\n");
+         fprintf(out, "    switch (ENGINE_TOKEN()) {\n");
+
+         // Columns with the same action share one case list
+         for (int token = 0; token < num_terminals; token++) {
+             emitted[token] = false;
+         }
+         for (int token = 0; token < num_terminals; token++) {
+             int action = tables_action(tables, state, (TokenType)token);
+             if (emitted[token] || action_type_of(action) == ACTION_ERROR) {
+                 continue;
+             }
+             for (int other = token; other < num_terminals; other++) {
+                 if (!emitted[other] && tables_action(tables, state, (TokenType)other) == action) {
+                     emit_token_case(out, other);
+                     emitted[other] = true;
+                 }
+             }
+
+             int value = action_value_of(action);
+             switch (action_type_of(action)) {
+                 case ACTION_SHIFT:
+                     fprintf(out, "            ENGINE_SHIFT(%d);\n", value);
+                     fprintf(out, "            goto state_%d;\n", value);
+                     break;
+                 case ACTION_REDUCE:
+                     fprintf(out, "            /* reduce by production %d */\n", value);
+                     emit_reduce(out, tables, value);
+                     break;
+                 default:
+                     fprintf(out, "            ENGINE_ACCEPT();\n");
+                     break;
+             }
+         }
+         fprintf(out, "        default:\n");
+         fprintf(out, "            ENGINE_REJECT();\n");
+         fprintf(out, "    }\n");
+     }
+     fprintf(out, "}\n\n");
+     fprintf(out, "#endif /* %s_ENGINE_H */\n", guard);
+
+     free(emitted);
+     free(targeted);
+ }
+
+ /**
+  * Main function
+  */
+ int main(int argc, char* argv[]) {
+     const char* prefix = "expr";
+     const char* grammar_file = NULL;
+     bool listing = false;
+     bool engine = false;
+
+     for (int i = 1; i < argc; i++) {
+         if (strcmp(argv[i], "--grammar") == 0 && i + 1 < argc) {
+             grammar_file = argv[++i];
+         } else if (strcmp(argv[i], "--listing") == 0) {
+             listing = true;
+         } else if (strcmp(argv[i], "--engine") == 0) {
+             engine = true;
+         } else if (argv[i][0] == '-') {
+             fprintf(stderr, "Usage: %s [--grammar FILE] [--listing] [--engine] [prefix]\n", argv[0]);
+             return EXIT_FAILURE;
+         } else {
+             prefix = argv[i];
+         }
+     }
+
+     ParsingTables* tables = NULL;
+     if (grammar_file) {
+         Grammar* grammar = grammar_load(grammar_file);
+         if (grammar) {
+             LalrReport report;
+             tables = lalr_build(grammar, &report, listing ? stderr : NULL);
+             if (tables) {
+                 fprintf(stderr, "%s: %d states, %d shift/reduce and %d reduce/reduce conflicts\n",
+                         grammar_file, report.num_states, report.shift_reduce, report.reduce_reduce);
+             }
+             grammar_free(grammar);
+         }
+     } else {
+         tables = automaton_init();
+     }
+     if (!tables) {
+         fprintf(stderr, "Error: Failed to build parsing tables\n");
+         return EXIT_FAILURE;
+     }
+
+     if (engine) {
+         emit_engine(stdout, tables, prefix);
+     } else {
+         emit_tables(stdout, tables, prefix);
+     }
+     free_parsing_tables(tables);
+
+     return EXIT_SUCCESS;
+ }
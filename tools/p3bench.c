@@ -0,0 +1,431 @@
+/**
+ * @file p3bench.c
+ * @brief Benchmarks of the parse pipeline, one component at a time
+ * @members: Group
+ *
+ * For every input file these components are measured:
+ *
+ *     scan/stdio  get_next_token over the whole input with the line scanner
+ *     scan/mmap   the same on the memory-mapped input
+ *     parse       parser_parse without a trace, recovering from every error, per step
+ *     dispatch    parse loop time outside scanning (ParseStats), per step
+ *     fast        parser_parse with the generated engine (engine.h), per step
+ *     reuse       parser_parse_buffer on one parser and the mapped input, per step
+ *     reduce      perform_reduce calls of a table-driven parse
+ *     trace       write_debug_output of the first steps of that parse
+ *
+ * Each component runs --repeat times. The line shows the items counted
+ * (tokens, steps or calls), the time and throughput of the fastest run,
+ * and percentiles of the time per item over the samples. For scan,
+ * reduce and trace a sample is one call, with the cost of reading the
+ * clock subtracted. For parse and dispatch it is the average over a whole
+ * run, which is too fast per step to time one by one. fast, reduce and
+ * trace stop at the first syntax error, parse and dispatch go on with
+ * error recovery so malformed inputs are parsed to the end.
+ *
+ * reuse runs one parse more than --repeat and fails if an accepted parse
+ * after the first one allocates, since the parser keeps its stack and
+ * stream for the next call (see parser_parse_buffer).
+ *
+ * Usage: p3bench [--repeat N] [--trace-steps N] [--only NAME] <input.cscn>...
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <stdint.h>
+ #include <inttypes.h>
+ #include <limits.h>
+ #include "../include/parser.h"
+ #include "../include/automaton.h"
+ #include "../include/utils.h"
+
+ // Samples kept per component, later ones replace random earlier ones
+ #define BENCH_MAX_SAMPLES (1 << 20)
+
+ // Runs of every component unless --repeat is given
+ #define BENCH_DEFAULT_REPEAT 5
+
+ // Steps traced by the trace component unless --trace-steps is given
+ #define BENCH_DEFAULT_TRACE_STEPS 200000
+
+ // Clock reads used to measure their own cost
+ #define BENCH_CALIBRATION_READS 100000
+
+ static const char* OPERATION_NAMES[] = { "SHIFT", "REDUCE", "ACCEPT", "ERROR" };
+
+ /**
+  * Reservoir of timing samples in nanoseconds
+  */
+ typedef struct {
+     uint64_t* values;  // Kept samples
+     size_t count;      // Samples in values
+     uint64_t seen;     // Samples offered so far
+     uint64_t random;   // xorshift64 state for the replacement
+ } Samples;
+
+ /**
+  * Result of one component
+  */
+ typedef struct {
+     uint64_t items;    // Items of the fastest run
+     uint64_t best_ns;  // Time of the fastest run
+     Samples samples;   // Time per item
+ } Measure;
+
+ static void samples_init(Samples* samples) {
+     samples->values = (uint64_t*)safe_malloc(sizeof(uint64_t) * BENCH_MAX_SAMPLES);
+     samples->count = 0;
+     samples->seen = 0;
+     samples->random = 0x9E3779B97F4A7C15ull;
+ }
+
+ /**
+  * Offer a sample, every one has the same chance of being kept
+  */
+ static void samples_add(Samples* samples, uint64_t value) {
+     samples->seen++;
+     if (samples->count < BENCH_MAX_SAMPLES) {
+         samples->values[samples->count++] = value;
+         return;
+     }
+     samples->random ^= samples->random << 13;
+     samples->random ^= samples->random >> 7;
+     samples->random ^= samples->random << 17;
+     uint64_t slot = samples->random % samples->seen;
+     if (slot < BENCH_MAX_SAMPLES) {
+         samples->values[slot] = value;
+     }
+ }
+
+ static int compare_u64(const void* a, const void* b) {
+     uint64_t x = *(const uint64_t*)a;
+     uint64_t y = *(const uint64_t*)b;
+     return x < y ? -1 : x > y;
+ }
+
+ /**
+  * Value below which a fraction of the sorted samples lie
+  */
+ static uint64_t percentile(const Samples* samples, double fraction) {
+     if (samples->count == 0) {
+         return 0;
+     }
+     size_t index = (size_t)(fraction * (double)(samples->count - 1) + 0.5);
+     return samples->values[index];
+ }
+
+ /**
+  * Median cost of reading the clock twice, subtracted from every call sample
+  */
+ static uint64_t clock_overhead(void) {
+     Samples samples;
+     samples_init(&samples);
+     for (int i = 0; i < BENCH_CALIBRATION_READS; i++) {
+         uint64_t start = monotonic_ns();
+         samples_add(&samples, monotonic_ns() - start);
+     }
+     qsort(samples.values, samples.count, sizeof(uint64_t), compare_u64);
+     uint64_t overhead = percentile(&samples, 0.5);
+     free(samples.values);
+     return overhead;
+ }
+
+ /**
+  * Sample of one timed call, without the clock cost
+  */
+ static uint64_t call_time(uint64_t start, uint64_t end, uint64_t overhead) {
+     uint64_t elapsed = end - start;
+     return elapsed > overhead ? elapsed - overhead : 0;
+ }
+
+ /**
+  * Keep the fastest run
+  */
+ static void note_run(Measure* measure, uint64_t items, uint64_t elapsed) {
+     if (measure->best_ns == 0 || elapsed < measure->best_ns) {
+         measure->best_ns = elapsed;
+         measure->items = items;
+     }
+ }
+
+ /**
+  * Scan every token; one run times the whole scan, the other every call
+  */
+ static bool bench_scan(const char* path, unsigned flags, int repeat, uint64_t overhead, Measure* measure) {
+     for (int run = 0; run < repeat; run++) {
+         // Timed as a whole
+         uint64_t start = monotonic_ns();
+         TokenStream* stream = token_stream_open(path, flags | TOKEN_STREAM_STREAMING);
+         if (!stream) {
+             return false;
+         }
+         while (stream->current && stream->current->type != TOKEN_EOF) {
+             token_stream_release(stream, get_next_token(stream));
+         }
+         uint64_t elapsed = monotonic_ns() - start;
+         note_run(measure, (uint64_t)stream->token_count, elapsed);
+         token_stream_free(stream);
+
+         // Timed call by call
+         stream = token_stream_open(path, flags | TOKEN_STREAM_STREAMING);
+         if (!stream) {
+             return false;
+         }
+         while (stream->current && stream->current->type != TOKEN_EOF) {
+             uint64_t call_start = monotonic_ns();
+             Token* token = get_next_token(stream);
+             uint64_t call_end = monotonic_ns();
+             samples_add(&measure->samples, call_time(call_start, call_end, overhead));
+             token_stream_release(stream, token);
+         }
+         token_stream_free(stream);
+     }
+     return true;
+ }
+
+ /**
+  * Whole parses, with or without the counters, or with the generated
+  * engine, which has no error recovery
+  */
+ static bool bench_parse(const char* path, int repeat, bool dispatch, bool fast, Measure* measure) {
+     Parser* parser = parser_create(TRACE_OFF);
+     parser->collect_stats = dispatch;
+     parser->fast_engine = fast;
+     parser->max_errors = fast ? 1 : INT_MAX;
+
+     for (int run = 0; run < repeat; run++) {
+         uint64_t start = monotonic_ns();
+         ParseResult result = parser_parse(parser, path, NULL);
+         uint64_t elapsed = monotonic_ns() - start;
+         if (result.steps_taken == 0) {
+             parse_result_free(&result);
+             parser_free(parser);
+             return false;
+         }
+
+         uint64_t steps = (uint64_t)result.steps_taken;
+         if (dispatch) {
+             elapsed = result.stats->dispatch_ns;
+         }
+         note_run(measure, steps, elapsed);
+         samples_add(&measure->samples, elapsed / steps);
+         parse_result_free(&result);
+     }
+     parser_free(parser);
+     return true;
+ }
+
+ /**
+  * Parses of the mapped input with one parser, the first only grows its
+  * memory; false if the input cannot be read or a later accepted parse
+  * allocates
+  */
+ static bool bench_reuse(const char* path, int repeat, Measure* measure) {
+     const char* data = NULL;
+     size_t size = 0;
+     if (!token_map_file(path, &data, &size)) {
+         return false;
+     }
+
+     Parser* parser = parser_create(TRACE_OFF);
+     ParseResult result = parser_parse_buffer(parser, data, size);
+     parse_result_free(&result);
+
+     bool ok = true;
+     for (int run = 0; run < repeat && ok; run++) {
+         uint64_t allocations = allocation_count();
+         uint64_t start = monotonic_ns();
+         result = parser_parse_buffer(parser, data, size);
+         uint64_t elapsed = monotonic_ns() - start;
+         allocations = allocation_count() - allocations;
+         if (result.success && allocations > 0) {
+             fprintf(stderr, "%s: parse %d allocated %" PRIu64 " times after the first\n",
+                     path, run + 2, allocations);
+             ok = false;
+         }
+
+         uint64_t steps = result.steps_taken > 0 ? (uint64_t)result.steps_taken : 1;
+         note_run(measure, steps, elapsed);
+         samples_add(&measure->samples, elapsed / steps);
+         parse_result_free(&result);
+     }
+
+     parser_free(parser);
+     token_unmap_file(data, size);
+     return ok;
+ }
+
+ /**
+  * Table-driven parse through the public parser API, timing every
+  * perform_reduce (or every write_debug_output when tracing); total
+  * receives the time of the timed calls. False if the input cannot be read
+  */
+ static bool drive(const char* path, bool trace, uint64_t max_steps, uint64_t overhead,
+                   Samples* samples, uint64_t* total, uint64_t* calls) {
+     Parser* parser = parser_create(trace ? TRACE_FILE : TRACE_OFF);
+     parser->input = token_stream_open(path, TOKEN_STREAM_STREAMING);
+     if (!parser->input) {
+         parser_free(parser);
+         return false;
+     }
+     if (trace) {
+         parser->debug_file = fopen("/dev/null", "w");
+     }
+
+     TokenStream* input = parser->input;
+     uint64_t steps = 0;
+     *total = 0;
+     *calls = 0;
+
+     while (input->current && steps < max_steps) {
+         Token* token = input->current;
+         int action = get_action(parser->tables, stack_top_state(parser->stack), token->type);
+         ActionType type = action_type_of(action);
+         int value = action_value_of(action);
+         steps++;
+
+         if (trace) {
+             uint64_t start = monotonic_ns();
+             write_debug_output(parser, OPERATION_NAMES[type], "Benchmark step");
+             uint64_t elapsed = call_time(start, monotonic_ns(), overhead);
+             samples_add(samples, elapsed);
+             *total += elapsed;
+             (*calls)++;
+         }
+
+         if (type == ACTION_SHIFT) {
+             if (!perform_shift(parser, value, token)) {
+                 break;
+             }
+             get_next_token(input);
+         } else if (type == ACTION_REDUCE) {
+             uint64_t start = monotonic_ns();
+             bool ok = perform_reduce(parser, value);
+             uint64_t end = monotonic_ns();
+             if (!trace) {
+                 uint64_t elapsed = call_time(start, end, overhead);
+                 samples_add(samples, elapsed);
+                 *total += elapsed;
+                 (*calls)++;
+             }
+             if (!ok) {
+                 break;
+             }
+         } else {
+             break;
+         }
+     }
+
+     token_stream_free(parser->input);
+     parser->input = NULL;
+     parser_free(parser);
+     return true;
+ }
+
+ /**
+  * perform_reduce or write_debug_output calls
+  */
+ static bool bench_calls(const char* path, int repeat, bool trace, uint64_t trace_steps,
+                         uint64_t overhead, Measure* measure) {
+     for (int run = 0; run < repeat; run++) {
+         uint64_t calls;
+         uint64_t total;
+         if (!drive(path, trace, trace ? trace_steps : UINT64_MAX, overhead,
+                    &measure->samples, &total, &calls)) {
+             return false;
+         }
+         if (calls > 0) {
+             note_run(measure, calls, total);
+         }
+     }
+     return true;
+ }
+
+ /**
+  * Print the line of a component
+  */
+ static void report(const char* name, Measure* measure) {
+     Samples* samples = &measure->samples;
+     qsort(samples->values, samples->count, sizeof(uint64_t), compare_u64);
+
+     double seconds = (double)measure->best_ns / 1e9;
+     double per_second = seconds > 0 ? (double)measure->items / seconds : 0.0;
+     double per_item = measure->items > 0 ? (double)measure->best_ns / (double)measure->items : 0.0;
+
+     printf("  %-12s %12" PRIu64 " %10.2f %14.0f %9.1f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %9" PRIu64 "\n",
+            name, measure->items, seconds * 1e3, per_second, per_item,
+            percentile(samples, 0.50), percentile(samples, 0.90),
+            percentile(samples, 0.99), samples->count ? samples->values[samples->count - 1] : 0);
+ }
+
+ int main(int argc, char* argv[]) {
+     int repeat = BENCH_DEFAULT_REPEAT;
+     uint64_t trace_steps = BENCH_DEFAULT_TRACE_STEPS;
+     const char* only = NULL;
+     int first_input = argc;
+
+     for (int i = 1; i < argc; i++) {
+         if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+             repeat = atoi(argv[++i]);
+         } else if (strcmp(argv[i], "--trace-steps") == 0 && i + 1 < argc) {
+             trace_steps = strtoull(argv[++i], NULL, 10);
+         } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+             only = argv[++i];
+         } else if (argv[i][0] != '-') {
+             first_input = i;
+             break;
+         } else {
+             first_input = argc;
+             break;
+         }
+     }
+     if (first_input == argc || repeat < 1) {
+         fprintf(stderr, "Usage: %s [--repeat N] [--trace-steps N] [--only NAME] <input.cscn>...\n",
+                 argv[0]);
+         return EXIT_FAILURE;
+     }
+
+     uint64_t overhead = clock_overhead();
+     printf("Clock read: %" PRIu64 " ns (subtracted from call samples), best of %d runs\n",
+            overhead, repeat);
+
+     static const char* NAMES[] = { "scan/stdio", "scan/mmap", "parse", "dispatch", "fast", "reuse", "reduce", "trace" };
+     int status = EXIT_SUCCESS;
+
+     for (int i = first_input; i < argc; i++) {
+         const char* path = argv[i];
+         printf("\n%s\n", path);
+         printf("  %-12s %12s %10s %14s %9s %8s %8s %8s %9s\n", "component", "items", "ms",
+                "items/s", "ns/item", "p50", "p90", "p99", "max");
+
+         for (int c = 0; c < (int)(sizeof(NAMES) / sizeof(NAMES[0])); c++) {
+             if (only && strcmp(only, NAMES[c]) != 0) {
+                 continue;
+             }
+
+             Measure measure = { 0, 0, { NULL, 0, 0, 0 } };
+             samples_init(&measure.samples);
+             bool ok;
+             switch (c) {
+                 case 0: ok = bench_scan(path, 0, repeat, overhead, &measure); break;
+                 case 1: ok = bench_scan(path, TOKEN_STREAM_MMAP, repeat, overhead, &measure); break;
+                 case 2: ok = bench_parse(path, repeat, false, false, &measure); break;
+                 case 3: ok = bench_parse(path, repeat, true, false, &measure); break;
+                 case 4: ok = bench_parse(path, repeat, false, true, &measure); break;
+                 case 5: ok = bench_reuse(path, repeat, &measure); break;
+                 case 6: ok = bench_calls(path, repeat, false, 0, overhead, &measure); break;
+                 default: ok = bench_calls(path, repeat, true, trace_steps, overhead, &measure); break;
+             }
+
+             if (ok) {
+                 report(NAMES[c], &measure);
+             } else {
+                 printf("  %-12s failed\n", NAMES[c]);
+                 status = EXIT_FAILURE;
+             }
+             free(measure.samples.values);
+         }
+     }
+     return status;
+ }
@@ -0,0 +1,270 @@
+/**
+ * @file p3gen.c
+ * @brief Generator of synthetic .cscn inputs for the benchmarks
+ * @members: Group
+ *
+ * Writes about the requested number of bytes of tokens, eight per line
+ * (the stdio scanner reads one line at a time into a fixed buffer):
+ *
+ *     flat       NUM + NUM + ... + NUM
+ *     nested     ( ( ... ( NUM ) ... ) ), one nesting as deep as the size allows
+ *     random     well-formed expressions with + * and parentheses up to 16 deep
+ *     malformed  random, with about one token in 64 dropped, repeated or replaced
+ *
+ * Sizes take a K, M or G suffix (powers of 1024). The same kind, size and
+ * seed always produce the same file.
+ *
+ * Usage: p3gen <flat|nested|random|malformed> <size> [--seed N] [-o FILE]
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <stdint.h>
+ #include <stdbool.h>
+
+ // Tokens written on one line
+ #define GEN_TOKENS_PER_LINE 8
+
+ // Deepest parenthesis nesting of the random expressions
+ #define GEN_MAX_DEPTH 16
+
+ // One token in GEN_FAULT_RATE is broken in malformed inputs
+ #define GEN_FAULT_RATE 64
+
+ typedef enum { GEN_NUM, GEN_PLUS, GEN_STAR, GEN_LPAREN, GEN_RPAREN } GenToken;
+
+ /**
+  * Output with the byte count and line layout
+  */
+ typedef struct {
+     FILE* out;
+     uint64_t bytes;     // Bytes written so far
+     int on_line;        // Tokens on the current line
+     uint64_t random;    // xorshift64 state
+ } Generator;
+
+ /**
+  * Next pseudo-random number (xorshift64)
+  */
+ static uint64_t next_random(Generator* gen) {
+     gen->random ^= gen->random << 13;
+     gen->random ^= gen->random >> 7;
+     gen->random ^= gen->random << 17;
+     return gen->random;
+ }
+
+ /**
+  * True with a probability of 1 in n
+  */
+ static bool one_in(Generator* gen, unsigned n) {
+     return next_random(gen) % n == 0;
+ }
+
+ /**
+  * Write one token
+  */
+ static void emit(Generator* gen, GenToken token) {
+     char text[48];
+     int length;
+
+     switch (token) {
+         case GEN_NUM: {
+             // 1 to 6 digits, no leading zero
+             unsigned digits = 1 + (unsigned)(next_random(gen) % 6);
+             char number[8];
+             number[0] = (char)('1' + next_random(gen) % 9);
+             for (unsigned i = 1; i < digits; i++) {
+                 number[i] = (char)('0' + next_random(gen) % 10);
+             }
+             number[digits] = '\0';
+             length = snprintf(text, sizeof(text), "<%s, NUM>", number);
+             break;
+         }
+         case GEN_PLUS:
+             length = snprintf(text, sizeof(text), "<+, PLUS>");
+             break;
+         case GEN_STAR:
+             length = snprintf(text, sizeof(text), "<*, STAR>");
+             break;
+         case GEN_LPAREN:
+             length = snprintf(text, sizeof(text), "<(, LPAREN>");
+             break;
+         case GEN_RPAREN:
+         default:
+             length = snprintf(text, sizeof(text), "<), RPAREN>");
+             break;
+     }
+
+     if (gen->on_line > 0) {
+         fputc(' ', gen->out);
+         gen->bytes++;
+     }
+     fwrite(text, 1, (size_t)length, gen->out);
+     gen->bytes += (uint64_t)length;
+     if (++gen->on_line == GEN_TOKENS_PER_LINE) {
+         fputc('\n', gen->out);
+         gen->bytes++;
+         gen->on_line = 0;
+     }
+ }
+
+ /**
+  * Write a token of a malformed input, sometimes broken
+  */
+ static void emit_faulty(Generator* gen, GenToken token, bool faults) {
+     if (!faults || !one_in(gen, GEN_FAULT_RATE)) {
+         emit(gen, token);
+         return;
+     }
+
+     switch (next_random(gen) % 3) {
+         case 0:
+             // Dropped
+             break;
+         case 1:
+             emit(gen, token);
+             emit(gen, token);
+             break;
+         default:
+             emit(gen, (GenToken)(next_random(gen) % 5));
+             break;
+     }
+ }
+
+ /**
+  * NUM + NUM + ... + NUM
+  */
+ static void generate_flat(Generator* gen, uint64_t size) {
+     emit(gen, GEN_NUM);
+     while (gen->bytes < size) {
+         emit(gen, GEN_PLUS);
+         emit(gen, GEN_NUM);
+     }
+ }
+
+ /**
+  * One nesting, each level takes about 24 bytes
+  */
+ static void generate_nested(Generator* gen, uint64_t size) {
+     uint64_t depth = size / 24;
+     for (uint64_t i = 0; i < depth; i++) {
+         emit(gen, GEN_LPAREN);
+     }
+     emit(gen, GEN_NUM);
+     for (uint64_t i = 0; i < depth; i++) {
+         emit(gen, GEN_RPAREN);
+     }
+ }
+
+ /**
+  * Random expression, operands and operators alternate; once the size
+  * is reached the expression is ended after the next operand
+  */
+ static void generate_random(Generator* gen, uint64_t size, bool faults) {
+     int depth = 0;
+     bool want_operand = true;
+
+     for (;;) {
+         if (want_operand) {
+             if (depth < GEN_MAX_DEPTH && gen->bytes < size && one_in(gen, 4)) {
+                 emit_faulty(gen, GEN_LPAREN, faults);
+                 depth++;
+             } else {
+                 emit_faulty(gen, GEN_NUM, faults);
+                 want_operand = false;
+             }
+         } else if (gen->bytes >= size) {
+             for (; depth > 0; depth--) {
+                 emit_faulty(gen, GEN_RPAREN, faults);
+             }
+             return;
+         } else if (depth > 0 && one_in(gen, 3)) {
+             emit_faulty(gen, GEN_RPAREN, faults);
+             depth--;
+         } else {
+             emit_faulty(gen, one_in(gen, 2) ? GEN_PLUS : GEN_STAR, faults);
+             want_operand = true;
+         }
+     }
+ }
+
+ /**
+  * Parse a size with an optional K, M or G suffix, 0 if invalid
+  */
+ static uint64_t parse_size(const char* text) {
+     char* end;
+     unsigned long long value = strtoull(text, &end, 10);
+     switch (*end) {
+         case 'K': case 'k': value <<= 10; end++; break;
+         case 'M': case 'm': value <<= 20; end++; break;
+         case 'G': case 'g': value <<= 30; end++; break;
+         default: break;
+     }
+     return *end == '\0' ? (uint64_t)value : 0;
+ }
+
+ int main(int argc, char* argv[]) {
+     const char* kind = NULL;
+     uint64_t size = 0;
+     uint64_t seed = 1;
+     const char* output = NULL;
+
+     for (int i = 1; i < argc; i++) {
+         if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+             seed = strtoull(argv[++i], NULL, 10);
+         } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+             output = argv[++i];
+         } else if (!kind) {
+             kind = argv[i];
+         } else if (size == 0) {
+             size = parse_size(argv[i]);
+         } else {
+             kind = NULL;
+             break;
+         }
+     }
+     if (!kind || size == 0) {
+         fprintf(stderr, "Usage: %s <flat|nested|random|malformed> <size>[K|M|G] [--seed N] [-o FILE]\n",
+                 argv[0]);
+         return EXIT_FAILURE;
+     }
+
+     FILE* out = output ? fopen(output, "w") : stdout;
+     if (!out) {
+         fprintf(stderr, "Error: Could not create %s\n", output);
+         return EXIT_FAILURE;
+     }
+
+     // xorshift needs a non-zero state
+     Generator gen = { out, 0, 0, seed * 0x9E3779B97F4A7C15ull + 1 };
+
+     if (strcmp(kind, "flat") == 0) {
+         generate_flat(&gen, size);
+     } else if (strcmp(kind, "nested") == 0) {
+         generate_nested(&gen, size);
+     } else if (strcmp(kind, "random") == 0) {
+         generate_random(&gen, size, false);
+     } else if (strcmp(kind, "malformed") == 0) {
+         generate_random(&gen, size, true);
+     } else {
+         fprintf(stderr, "Error: Unknown input kind '%s'\n", kind);
+         if (output) {
+             fclose(out);
+         }
+         return EXIT_FAILURE;
+     }
+     if (gen.on_line > 0) {
+         fputc('\n', out);
+     }
+
+     bool ok = !ferror(out);
+     if (output && fclose(out) != 0) {
+         ok = false;
+     }
+     if (!ok) {
+         fprintf(stderr, "Error: Could not write the input\n");
+         return EXIT_FAILURE;
+     }
+     return EXIT_SUCCESS;
+ }
@@ -0,0 +1,196 @@
+/**
+ * @file p3trace.c
+ * @brief Decoder rendering a binary step trace as the text trace
+ * @members: Group
+ *
+ * Replays the records on a parser stack, reading the tokens from the
+ * traced input file again, and prints every step in the format of the
+ * _p3dbg.txt file. The tables are the built-in ones or those of the
+ * grammar file named in the trace.
+ *
+ * Usage: p3trace [--input FILE] [--grammar FILE] <trace_file>
+ */
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include "../include/trace.h"
+ #include "../include/parser.h"
+ #include "../include/automaton.h"
+ #include "../include/lalr.h"
+ #include "../include/utils.h"
+
+ static const char* OPERATION_NAMES[] = { "SHIFT", "REDUCE", "ACCEPT", "ERROR", "RECOVER" };
+
+ /**
+  * Advance the input to the token with the given index
+  */
+ static bool seek_token(TokenStream* input, uint32_t* position, uint32_t index) {
+     while (*position < index) {
+         if (!input->current || input->current->type == TOKEN_EOF) {
+             return false;
+         }
+         get_next_token(input);
+         (*position)++;
+     }
+     return *position == index;
+ }
+
+ /**
+  * Append the action column of a step
+  */
+ static void append_action(StrBuf* out, const TraceRecord* record, const ParsingTables* tables,
+                           TokenStream* input) {
+     switch (record->operation) {
+         case TRACE_SHIFT:
+             automaton_append_action(out, automaton_create_action(ACTION_SHIFT, record->param), tables);
+             break;
+         case TRACE_REDUCE:
+             automaton_append_action(out, automaton_create_action(ACTION_REDUCE, record->param), tables);
+             break;
+         case TRACE_ACCEPT:
+             strbuf_append_str(out, "Input accepted");
+             break;
+         case TRACE_ERROR:
+             strbuf_append_str(out, "Invalid syntax");
+             break;
+         default:
+             strbuf_appendf(out, "Skipped %u tokens, popped %u states, resuming at '%.*s'",
+                            record->param, record->popped,
+                            input->current ? input->current->length : 0,
+                            input->current ? input->current->lexeme : "");
+             break;
+     }
+ }
+
+ /**
+  * Print every step of a trace
+  */
+ static bool decode(TraceReader* reader, const ParsingTables* tables, TokenStream* input, FILE* out) {
+     Stack* stack = stack_create();
+     Token bottom = { TOKEN_EOF, "$", 1, false, 0, 0, NULL };
+     stack_push(stack, 0, &bottom);
+
+     uint32_t position = 0;
+     TraceRecord record;
+     bool ok = true;
+     StrBuf text;
+     strbuf_init(&text);
+
+     while (ok && trace_reader_next(reader, &record)) {
+         if (record.operation > TRACE_RECOVER || (int)record.popped >= stack_size(stack)) {
+             log_error("Step %u does not match the trace so far", record.step);
+             ok = false;
+             break;
+         }
+
+         // A recovery is recorded with its effect already applied
+         if (record.operation == TRACE_RECOVER) {
+             stack_pop_n(stack, record.popped);
+         }
+         if (!seek_token(input, &position, record.token)) {
+             log_error("Step %u refers to token %u past the end of the input", record.step, record.token);
+             ok = false;
+             break;
+         }
+
+         strbuf_clear(&text);
+         strbuf_append_str(&text, "Step ");
+         strbuf_append_int(&text, (long)record.step);
+         strbuf_append_str(&text, ":\nCurrent State: ");
+         strbuf_append_int(&text, record.state);
+         strbuf_append_str(&text, "\nStack Contents: ");
+         stack_append_string(stack, &text);
+         strbuf_append_str(&text, "\nInput Position: ");
+         token_stream_append_position(&text, input, TRACE_INPUT_TOKENS);
+         strbuf_append_str(&text, "\nOperation: ");
+         strbuf_append_str(&text, OPERATION_NAMES[record.operation]);
+         strbuf_append_str(&text, "\nAction: ");
+         append_action(&text, &record, tables, input);
+         strbuf_append(&text, "\n\n", 2);
+         fwrite(text.data, 1, text.length, out);
+
+         if (record.operation == TRACE_RECOVER) {
+             continue;
+         }
+         stack_pop_n(stack, record.popped);
+         if (record.pushed) {
+             Token* symbol = input->current;
+             if (record.operation == TRACE_REDUCE) {
+                 if (record.param < 1 || record.param > tables->num_productions) {
+                     log_error("Step %u reduces by unknown rule %u", record.step, record.param);
+                     ok = false;
+                     break;
+                 }
+                 int lhs = tables->productions[record.param].lhs;
+                 const char* name = tables->non_terminal_names ? tables->non_terminal_names[lhs]
+                                                               : get_non_terminal_name(lhs);
+                 symbol = token_stream_new_token(input, TOKEN_NON_TERMINAL, name, (int)strlen(name),
+                                                 0, 0, false);
+             }
+             stack_push(stack, record.next_state, symbol);
+         }
+     }
+
+     if (ok && reader->truncated) {
+         log_error("The trace ends inside a record, it is incomplete");
+         ok = false;
+     }
+     strbuf_free(&text);
+     stack_free(stack);
+     return ok;
+ }
+
+ int main(int argc, char* argv[]) {
+     const char* input_file = NULL;
+     const char* grammar_file = NULL;
+     const char* trace_file = NULL;
+
+     for (int i = 1; i < argc; i++) {
+         if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+             input_file = argv[++i];
+         } else if (strcmp(argv[i], "--grammar") == 0 && i + 1 < argc) {
+             grammar_file = argv[++i];
+         } else if (!trace_file && argv[i][0] != '-') {
+             trace_file = argv[i];
+         } else {
+             trace_file = NULL;
+             break;
+         }
+     }
+     if (!trace_file) {
+         fprintf(stderr, "Usage: %s [--input FILE] [--grammar FILE] <trace_file>\n", argv[0]);
+         return EXIT_FAILURE;
+     }
+
+     TraceReader* reader = trace_reader_open(trace_file);
+     if (!reader) {
+         return EXIT_FAILURE;
+     }
+
+     // The paths of the header unless overridden
+     if (!input_file) {
+         input_file = reader->input_file;
+     }
+     if (!grammar_file) {
+         grammar_file = reader->grammar_file;
+     }
+
+     const ParsingTables* tables = grammar_file ? lalr_build_from_file(grammar_file, NULL)
+                                                : automaton_builtin();
+     TokenStream* input = input_file ? token_stream_open(input_file, 0) : NULL;
+     if (!tables || !input) {
+         fprintf(stderr, "Error: Could not load %s\n", !tables ? grammar_file : input_file ? input_file : "the input");
+         token_stream_free(input);
+         free_parsing_tables(tables);
+         trace_reader_close(reader);
+         return EXIT_FAILURE;
+     }
+
+     bool ok = decode(reader, tables, input, stdout);
+
+     token_stream_free(input);
+     free_parsing_tables(tables);
+     trace_reader_close(reader);
+     return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+ }